@@ -0,0 +1,365 @@
+
+/**
+   \class benchmarkSVfitKernels benchmarkSVfitKernels.cc "TauAnalysis/SVfitStandalone/bin/benchmarkSVfitKernels.cc"
+   \brief Measure the time per call of the individual functions that the likelihood is built from
+
+   The functions are evaluated for realistic parameter values: the likelihood (transform, prob), map_xMarkovChain and
+   makeStochasticMove at the positions visited by the Markov Chain when integrating the eTau event of testSVfitStandalone,
+   the other functions for random values drawn from the ranges typical for tau decays in this event.
+   The results are printed in ns per call and can be written in JSON format (option --json),
+   so that optimisations of the individual functions can be measured in isolation.
+
+   Before the timing, the analytic gradient computed by SVfitStandaloneLikelihood::nllAndGradient (used in fit mode)
+   is compared to central finite differences of -log(prob) at random points in the e+had, had+had and mu+e channels.
+   The program exits with a non-zero status in case the relative deviation exceeds maxGradientDeviation.
+*/
+
+#include "FWCore/ParameterSet/interface/FileInPath.h"
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLikelihood.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneMarkovChainIntegrator.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneQuantities.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
+#include "TauAnalysis/SVfitStandalone/interface/LikelihoodFunctions.h"
+#include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
+
+#include "TFile.h"
+#include "TH1.h"
+#include "TRandom3.h"
+#include "TMath.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+
+using namespace svFitStandalone;
+
+namespace
+{
+  /// give access to SVfitStandaloneLikelihood::transform
+  class KernelLikelihood : public SVfitStandaloneLikelihood
+  {
+   public:
+    KernelLikelihood(const std::vector<MeasuredTauLepton>& measuredTauLeptons, const Vector& measuredMET, const TMatrixD& covMET)
+      : SVfitStandaloneLikelihood(measuredTauLeptons, measuredMET, covMET, false)
+    {}
+    using SVfitStandaloneLikelihood::transform;
+  };
+
+  /// give access to SVfitStandaloneMarkovChainIntegrator::makeStochasticMove
+  class KernelIntegrator : public SVfitStandaloneMarkovChainIntegrator
+  {
+   public:
+    KernelIntegrator(unsigned numIterBurnin, unsigned numIterSampling)
+      : SVfitStandaloneMarkovChainIntegrator("none", numIterBurnin, numIterSampling, TMath::Nint(0.2*numIterBurnin), TMath::Nint(0.6*numIterBurnin),
+					     15., 1. - 1.e+2/numIterSampling, 1, 1, 1, 1.e-2, 0.71, -1)
+    {}
+    /// perform stochastic move of the sampling stage, starting from the last position of the previous integration
+    bool makeSamplingMove()
+    {
+      bool isAccepted = false;
+      bool isValid = true;
+      makeStochasticMove(numIterBurnin_, isAccepted, isValid);
+      return isAccepted;
+    }
+  };
+
+  /// record the positions visited by the Markov Chain
+  class PositionRecorder : public ROOT::Math::Functor
+  {
+   public:
+    PositionRecorder(unsigned nDim) : nDim_(nDim) {}
+    const std::vector<double>& positions() const { return positions_; }
+    size_t numPositions() const { return positions_.size()/nDim_; }
+   private:
+    virtual double DoEval(const double* x) const
+    {
+      positions_.insert(positions_.end(), x, x + nDim_);
+      return 0.;
+    }
+    unsigned nDim_;
+    mutable std::vector<double> positions_;
+  };
+
+  /// compare analytic gradient of -log(likelihood) to central finite differences at numPoints random points in the fit parameter space,
+  /// return the largest deviation relative to max(1, |derivative|)
+  double checkGradient(const std::vector<MeasuredTauLepton>& measuredTauLeptons, const Vector& measuredMET, const TMatrixD& covMET, 
+		       bool shiftVisMassAndPt, unsigned numPoints, TRandom3& rnd)
+  {
+    SVfitStandaloneLikelihood nll(measuredTauLeptons, measuredMET, covMET, false);
+    // same configuration as in SVfitStandaloneAlgorithm::fit;
+    // the look-up tables are piecewise constant and contribute no derivative, so the shifts are checked without tables
+    nll.addDelta(false);
+    nll.addSinTheta(true);
+    nll.addPhiPenalty(true);
+    nll.requirePhysicalSolution(false);
+    nll.addLogM(true, 1.);
+    if ( shiftVisMassAndPt ) {
+      nll.shiftVisMass(true, 0, 0);
+      nll.shiftVisPt(true, 0, 0);
+    }
+    const unsigned nDim = 2*kMaxFitParams;
+    double maxDeviation = 0.;
+    for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+      double x[nDim];
+      for ( unsigned iLeg = 0; iLeg < 2; ++iLeg ) {
+	bool isHad = ( measuredTauLeptons[iLeg].type() == kTauToHadDecay );
+	// for hadronic tau decays, include the region x > 1 in which prob applies a penalty term
+	x[iLeg*kMaxFitParams + kXFrac] = ( isHad ) ? rnd.Uniform(0.05, 1.2) : rnd.Uniform(0.05, 0.95);
+	x[iLeg*kMaxFitParams + kMNuNu] = ( isHad ) ? 0. : rnd.Uniform(0., 1.5);
+	x[iLeg*kMaxFitParams + kPhi] = rnd.Uniform(-3.5, +3.5);
+	x[iLeg*kMaxFitParams + kVisMassShifted] = ( isHad && shiftVisMassAndPt ) ? rnd.Uniform(0.2, 1.6) : measuredTauLeptons[iLeg].mass();
+	x[iLeg*kMaxFitParams + kRecTauPtDivGenTauPt] = ( isHad && shiftVisMassAndPt ) ? rnd.Uniform(-0.5, +0.5) : 0.;
+      }
+      double grad[nDim];
+      double nllValue = nll.nllAndGradient(x, grad);
+      if ( !(nllValue < 1.e+30) ) continue;
+      for ( unsigned iDim = 0; iDim < nDim; ++iDim ) {
+	double h = 1.e-6*TMath::Max(1., TMath::Abs(x[iDim]));
+	double xPlus[nDim];
+	double xMinus[nDim];
+	std::copy(x, x + nDim, xPlus);
+	std::copy(x, x + nDim, xMinus);
+	xPlus[iDim] += h;
+	xMinus[iDim] -= h;
+	double probPlus = nll.prob(xPlus);
+	double probMinus = nll.prob(xMinus);
+	if ( !(probPlus > 0. && probMinus > 0.) ) continue;
+	double derivative = (-TMath::Log(probPlus) + TMath::Log(probMinus))/(2.*h);
+	maxDeviation = TMath::Max(maxDeviation, TMath::Abs(derivative - grad[iDim])/TMath::Max(1., TMath::Abs(derivative)));
+      }
+    }
+    return maxDeviation;
+  }
+
+  volatile double sink = 0.;
+
+  struct Timing
+  {
+    std::string name;
+    double nsPerCall;
+    unsigned long long numCalls;
+  };
+
+  /// call kernel(idx) for idx = 0..numInputs-1, repeatedly until at least minTime seconds have passed
+  template <typename Kernel>
+  Timing timeKernel(const std::string& name, size_t numInputs, const Kernel& kernel, double minTime)
+  {
+    double sum = 0.;
+    for ( size_t idx = 0; idx < numInputs; ++idx ) {
+      sum += kernel(idx);
+    }
+    unsigned long long numCalls = 0;
+    double time = 0.;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    do {
+      for ( size_t idx = 0; idx < numInputs; ++idx ) {
+	sum += kernel(idx);
+      }
+      numCalls += numInputs;
+      time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while ( time < minTime );
+    sink = sink + sum;
+    Timing timing;
+    timing.name = name;
+    timing.nsPerCall = 1.e+9*time/numCalls;
+    timing.numCalls = numCalls;
+    std::cout << std::setw(40) << std::left << name << std::setw(12) << std::right << std::setprecision(4) << timing.nsPerCall << " ns/call" << std::endl;
+    return timing;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // parse arguments
+  std::string jsonFileName;
+  double minTime = 0.5;
+  for ( int iArg = 1; iArg < argc; ++iArg ) {
+    std::string arg = argv[iArg];
+    if ( arg == "--json" && iArg + 1 < argc ) {
+      jsonFileName = argv[++iArg];
+    } else if ( arg == "--time" && iArg + 1 < argc ) {
+      minTime = atof(argv[++iArg]);
+    } else {
+      std::cout << "Usage : " << argv[0] << " [--json output.json] [--time seconds per kernel]" << std::endl;
+      return 1;
+    }
+  }
+  TH1::AddDirectory(false);
+
+  // eTau event of testSVfitStandalone
+  std::vector<MeasuredTauLepton> measuredTauLeptons;
+  measuredTauLeptons.push_back(MeasuredTauLepton(kTauToElecDecay, 33.7393, 0.9409, -0.541458, 0.51100e-3));
+  measuredTauLeptons.push_back(MeasuredTauLepton(kTauToHadDecay, 25.7322, 0.618228, 2.79362, 0.13957, 0));
+  Vector measuredMET(11.7491, -51.9172, 0.);
+  TMatrixD covMET(2, 2);
+  covMET[0][0] =  787.352;
+  covMET[1][0] = -178.63;
+  covMET[0][1] = -178.63;
+  covMET[1][1] =  179.545;
+  KernelLikelihood nll(measuredTauLeptons, measuredMET, covMET);
+  nll.addLogM(true, 1.);
+  nll.addDelta(false);
+  nll.addSinTheta(false);
+  nll.addPhiPenalty(false);
+  nll.requirePhysicalSolution(true);
+
+  // check analytic gradient of -log(likelihood) in the e+had, had+had (with visible mass and Pt shifts) and mu+e channels
+  const double maxGradientDeviation = 1.e-3;
+  TRandom3 rndGradient(12345);
+  std::vector<MeasuredTauLepton> measuredTauLeptons_hadhad;
+  measuredTauLeptons_hadhad.push_back(MeasuredTauLepton(kTauToHadDecay, 33.7393, 0.9409, -0.541458, 0.8, 1));
+  measuredTauLeptons_hadhad.push_back(MeasuredTauLepton(kTauToHadDecay, 25.7322, 0.618228, 2.79362, 0.13957, 0));
+  std::vector<MeasuredTauLepton> measuredTauLeptons_mue;
+  measuredTauLeptons_mue.push_back(MeasuredTauLepton(kTauToMuDecay, 33.7393, 0.9409, -0.541458, 0.10566));
+  measuredTauLeptons_mue.push_back(MeasuredTauLepton(kTauToElecDecay, 25.7322, 0.618228, 2.79362, 0.51100e-3));
+  double gradientDeviation = checkGradient(measuredTauLeptons, measuredMET, covMET, false, 200, rndGradient);
+  gradientDeviation = TMath::Max(gradientDeviation, checkGradient(measuredTauLeptons_hadhad, measuredMET, covMET, true, 200, rndGradient));
+  gradientDeviation = TMath::Max(gradientDeviation, checkGradient(measuredTauLeptons_mue, measuredMET, covMET, false, 200, rndGradient));
+  std::cout << "analytic gradient: max. relative deviation from finite differences = " << gradientDeviation << std::endl;
+  bool isGradientValid = ( gradientDeviation < maxGradientDeviation );
+  if ( !isGradientValid ) {
+    std::cerr << "Error: analytic gradient deviates from finite differences by more than " << maxGradientDeviation << " !!" << std::endl;
+  }
+
+  // run Markov Chain integration as in SVfitStandaloneAlgorithm::integrateMarkovChain to obtain a realistic sample of positions
+  const unsigned nDim = 5;
+  const double xl_array[nDim] = { 0., 0., -TMath::Pi(), 0., -TMath::Pi() };
+  const double xh_array[nDim] = { 1., tauLeptonMass, +TMath::Pi(), 1., +TMath::Pi() };
+  std::vector<double> xl(xl_array, xl_array + nDim);
+  std::vector<double> xh(xh_array, xh_array + nDim);
+  std::vector<double> x0(nDim, 0.5);
+  MCObjectiveFunctionAdapter mcObjectiveFunctionAdapter;
+  mcObjectiveFunctionAdapter.SetL1isLep(true);
+  mcObjectiveFunctionAdapter.SetL2isLep(false);
+  mcObjectiveFunctionAdapter.SetMarginalizeVisMass(false);
+  mcObjectiveFunctionAdapter.SetShiftVisMass(false);
+  mcObjectiveFunctionAdapter.SetShiftVisPt(false);
+  mcObjectiveFunctionAdapter.SetNDim(nDim);
+  PositionRecorder positionRecorder(nDim);
+  KernelIntegrator integrator(10000, 100000);
+  integrator.setIntegrand(mcObjectiveFunctionAdapter);
+  integrator.registerCallBackFunction(positionRecorder);
+  integrator.initializeStartPosition_and_Momentum(x0);
+  double integral = 0.;
+  double integralErr = 0.;
+  int errorFlag = 0;
+  integrator.integrate(xl, xh, integral, integralErr, errorFlag);
+  const std::vector<double>& positions = positionRecorder.positions();
+  size_t numPositions = positionRecorder.numPositions();
+  std::cout << "sampled " << numPositions << " positions of the Markov Chain" << std::endl;
+
+  // fit parameters at these positions, as passed to SVfitStandaloneLikelihood::prob
+  std::vector<double> xMapped(numPositions*2*kMaxFitParams);
+  for ( size_t idx = 0; idx < numPositions; ++idx ) {
+    map_xMarkovChain(&positions[idx*nDim], true, false, false, false, false, &xMapped[idx*2*kMaxFitParams]);
+  }
+
+  // random inputs of the individual likelihood terms
+  const size_t numInputs = 65536;
+  TRandom3 rnd(12345);
+  const double visMasses[] = { chargedPionMass, 0.62, 1.08 };
+  std::vector<double> x(numInputs), visMass(numInputs), nunuMass(numInputs), pVis(numInputs), enVis(numInputs), decayAngle(numInputs), gjAngle(numInputs), phi(numInputs);
+  std::vector<double> dMETx(numInputs), dMETy(numInputs), deltaVisMass(numInputs), recTauPtDivGenTauPt(numInputs);
+  std::vector<Vector> visDirection(numInputs);
+  for ( size_t idx = 0; idx < numInputs; ++idx ) {
+    x[idx] = rnd.Uniform(0.05, 1.);
+    visMass[idx] = visMasses[idx % 3];
+    nunuMass[idx] = rnd.Uniform(0., TMath::Sqrt(1. - x[idx])*tauLeptonMass);
+    pVis[idx] = rnd.Uniform(15., 80.);
+    enVis[idx] = TMath::Sqrt(pVis[idx]*pVis[idx] + visMass[idx]*visMass[idx]);
+    decayAngle[idx] = rnd.Uniform(0., TMath::Pi());
+    phi[idx] = rnd.Uniform(-TMath::Pi(), +TMath::Pi());
+    gjAngle[idx] = rnd.Uniform(0., 0.1);
+    double theta = 2.*std::atan(std::exp(-rnd.Uniform(-2.3, +2.3)));
+    double phiVis = rnd.Uniform(-TMath::Pi(), +TMath::Pi());
+    visDirection[idx] = Vector(TMath::Sin(theta)*TMath::Cos(phiVis), TMath::Sin(theta)*TMath::Sin(phiVis), TMath::Cos(theta));
+    dMETx[idx] = rnd.Gaus(0., TMath::Sqrt(covMET[0][0]));
+    dMETy[idx] = rnd.Gaus(0., TMath::Sqrt(covMET[1][1]));
+    deltaVisMass[idx] = rnd.Gaus(0., 0.1);
+    recTauPtDivGenTauPt[idx] = rnd.Gaus(1., 0.1);
+  }
+  TMatrixD invCovMET = covMET;
+  double covDet = invCovMET.Determinant();
+  invCovMET.Invert();
+
+  // look-up tables for the resolution on mass and Pt of hadronic taus, as histogram and as LookupTable
+  std::string inputFileName_visMassAndPtResolution = edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitVisMassAndPtResolutionPDF.root").fullPath();
+  TFile* inputFile_visMassAndPtResolution = new TFile(inputFileName_visMassAndPtResolution.data());
+  const TH1* lutVisMassRes_histogram = dynamic_cast<TH1*>(inputFile_visMassAndPtResolution->Get("recMinusGenTauMass_recDecayModeEq1"));
+  const LookupTable* lutVisMassRes = SVfitStandaloneLUTRegistry::instance().visMassRes(inputFile_visMassAndPtResolution, 1);
+  const LookupTable* lutVisPtRes = SVfitStandaloneLUTRegistry::instance().visPtRes(inputFile_visMassAndPtResolution, 1);
+
+  std::vector<Timing> timings;
+  timings.push_back(timeKernel("SVfitStandaloneLikelihood::transform", numPositions, [&](size_t idx) {
+    double xPrime_tmp[kMaxNLLParams + 4];
+    const double* xPrime_ptr = nll.transform(xPrime_tmp, &xMapped[idx*2*kMaxFitParams], false, -1.);
+    return ( xPrime_ptr ) ? xPrime_ptr[0] : 0.;
+  }, minTime));
+  timings.push_back(timeKernel("SVfitStandaloneLikelihood::prob", numPositions, [&](size_t idx) {
+    return nll.prob(&xMapped[idx*2*kMaxFitParams]);
+  }, minTime));
+  timings.push_back(timeKernel("SVfitStandaloneLikelihood::nllAndGradient", numPositions, [&](size_t idx) {
+    double grad[2*kMaxFitParams];
+    return nll.nllAndGradient(&xMapped[idx*2*kMaxFitParams], grad);
+  }, minTime));
+  timings.push_back(timeKernel("gjAngleLabFrameFromX", numInputs, [&](size_t idx) {
+    bool isValidSolution = true;
+    return gjAngleLabFrameFromX(x[idx], visMass[idx], 0., pVis[idx], enVis[idx], tauLeptonMass, isValidSolution);
+  }, minTime));
+  timings.push_back(timeKernel("motherDirection", numInputs, [&](size_t idx) {
+    return motherDirection(visDirection[idx], gjAngle[idx], phi[idx]).z();
+  }, minTime));
+  timings.push_back(timeKernel("rotateUz", numInputs, [&](size_t idx) {
+    ROOT::Math::DisplacementVector3D<ROOT::Math::Polar3D<double> > restFrameDirection(1., gjAngle[idx], phi[idx]);
+    return rotateUz(restFrameDirection, visDirection[idx]).z();
+  }, minTime));
+  timings.push_back(timeKernel("probMET", numInputs, [&](size_t idx) {
+    return probMET(dMETx[idx], dMETy[idx], covDet, invCovMET, 1.);
+  }, minTime));
+  timings.push_back(timeKernel("probTauToHadPhaseSpace", numInputs, [&](size_t idx) {
+    return probTauToHadPhaseSpace(decayAngle[idx], 0., visMass[idx], x[idx], false);
+  }, minTime));
+  timings.push_back(timeKernel("probTauToLepMatrixElement", numInputs, [&](size_t idx) {
+    return probTauToLepMatrixElement(decayAngle[idx], nunuMass[idx], electronMass, x[idx], false);
+  }, minTime));
+  timings.push_back(timeKernel("extractProbFromLUT (TH1)", numInputs, [&](size_t idx) {
+    return probVisMassShift(deltaVisMass[idx], lutVisMassRes_histogram);
+  }, minTime));
+  timings.push_back(timeKernel("extractProbFromLUT (LookupTable)", numInputs, [&](size_t idx) {
+    return probVisMassShift(deltaVisMass[idx], lutVisMassRes);
+  }, minTime));
+  timings.push_back(timeKernel("probVisPtShift (LookupTable)", numInputs, [&](size_t idx) {
+    return probVisPtShift(recTauPtDivGenTauPt[idx], lutVisPtRes);
+  }, minTime));
+  timings.push_back(timeKernel("map_xMarkovChain", numPositions, [&](size_t idx) {
+    double x_mapped[2*kMaxFitParams];
+    map_xMarkovChain(&positions[idx*nDim], true, false, false, false, false, x_mapped);
+    return x_mapped[0];
+  }, minTime));
+  // includes one evaluation of the likelihood per move
+  timings.push_back(timeKernel("makeStochasticMove", 1000, [&](size_t) {
+    return integrator.makeSamplingMove() ? 1. : 0.;
+  }, minTime));
+
+  if ( jsonFileName != "" ) {
+    std::ofstream jsonFile(jsonFileName.data());
+    jsonFile << "{\n  \"maxGradientDeviation\": " << std::setprecision(6) << gradientDeviation << ",\n  \"kernels\": [";
+    for ( size_t idx = 0; idx < timings.size(); ++idx ) {
+      jsonFile << ( idx == 0 ? "" : "," ) << "\n    { \"name\": \"" << timings[idx].name << "\", "
+	       << "\"nsPerCall\": " << std::setprecision(6) << timings[idx].nsPerCall << ", "
+	       << "\"numCalls\": " << timings[idx].numCalls << " }";
+    }
+    jsonFile << "\n  ]\n}\n";
+    std::cout << "wrote results to " << jsonFileName << std::endl;
+  }
+
+  delete inputFile_visMassAndPtResolution;
+  return ( isGradientValid ) ? 0 : 1;
+}
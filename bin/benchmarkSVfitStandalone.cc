@@ -0,0 +1,287 @@
+
+/**
+   \class benchmarkSVfitStandalone benchmarkSVfitStandalone.cc "TauAnalysis/SVfitStandalone/bin/benchmarkSVfitStandalone.cc"
+   \brief Measure the speed of fit, VEGAS and Markov Chain integration on a fixed sample of reference events
+
+   The reference sample contains events of the eTau, muTau, tauTau and eMu channels, with the hadronic taus reconstructed
+   in different decay modes. Each event is reconstructed in each mode (fit, VEGAS, Markov Chain) without and with the options
+   shiftVisPt, shiftVisMass and marginalizeVisMass. For each combination the number of events per second and the number of
+   likelihood evaluations per event are reported, together with the difference of the reconstructed masses to the reference
+   values stored in data/svFitStandaloneBenchmarkReference.txt. The results are written in JSON format (option --json),
+   so that they can be compared between versions of the package.
+
+   In fit mode, the built-in quasi-Newton minimizer is used instead of Minuit2 with option --minimizer bfgs.
+   The agreement of the two minimizers is checked by test/testSVfitStandaloneMinimizer.cc.
+
+   The reference sample is defined in test/SVfitStandaloneReferenceEvents.h. Whenever it is modified, kSampleVersion 
+   must be increased and the reference values must be recomputed by running with option --update-reference. Combinations without reference value are listed at the end;
+   with option --require-reference, the program exits with a non-zero status in case any reference value is missing.
+*/
+
+#include "FWCore/ParameterSet/interface/FileInPath.h"
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneAlgorithm.h"
+#include "TauAnalysis/SVfitStandalone/test/SVfitStandaloneReferenceEvents.h"
+
+#include "TFile.h"
+#include "TH1.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+  using namespace svFitStandaloneReference;
+
+  enum Mode { kFit, kIntegrateVEGAS, kIntegrateMarkovChain, kNumModes };
+  const char* modeNames[] = { "fit", "integrateVEGAS", "integrateMarkovChain" };
+
+  enum Option { kDefault, kShiftVisPt, kShiftVisMass, kMarginalizeVisMass, kNumOptions };
+  const char* optionNames[] = { "default", "shiftVisPt", "shiftVisMass", "marginalizeVisMass" };
+
+  struct Result
+  {
+    bool isValidSolution;
+    double mass;
+    double transverseMass;
+    unsigned numObjFunctionCalls;
+  };
+
+  std::string referenceKey(Option option, Mode mode, const ReferenceEvent& event)
+  {
+    return std::string(optionNames[option]) + " " + modeNames[mode] + " " + event.name;
+  }
+
+  Result runEvent(const ReferenceEvent& event, Mode mode, Option option, const std::string& inputFileName_visMassAndPtResolution, const std::string& inputFileName_genTauHadMass,
+		  bool useMinuit = true)
+  {
+    SVfitStandaloneAlgorithm algo(measuredTauLeptons(event), event.measuredMETx, event.measuredMETy, covMET(event), 0);
+    algo.addLogM(true, 1.);
+    algo.useMinuit(useMinuit);
+    if ( option == kShiftVisPt         ) algo.shiftVisPt(true, inputFileName_visMassAndPtResolution);
+    if ( option == kShiftVisMass       ) algo.shiftVisMass(true, inputFileName_visMassAndPtResolution);
+    if ( option == kMarginalizeVisMass ) algo.marginalizeVisMass(true, inputFileName_genTauHadMass);
+    Result result;
+    if ( mode == kFit ) {
+      algo.fit();
+      result.mass = algo.mass();
+      result.transverseMass = algo.transverseMass();
+    } else if ( mode == kIntegrateVEGAS ) {
+      algo.integrateVEGAS();
+      result.mass = algo.mass();
+      result.transverseMass = algo.transverseMass();
+    } else {
+      algo.integrateMarkovChain();
+      svFitStandalone::MCPtEtaPhiMassAdapter* mcQuantitiesAdapter = static_cast<svFitStandalone::MCPtEtaPhiMassAdapter*>(algo.getMCQuantitiesAdapter());
+      result.mass = mcQuantitiesAdapter->getMass();
+      result.transverseMass = mcQuantitiesAdapter->getTransverseMass();
+    }
+    result.isValidSolution = algo.isValidSolution();
+    result.numObjFunctionCalls = algo.numObjFunctionCalls();
+    return result;
+  }
+
+  /// reference values, indexed by option, mode and event name
+  typedef std::map<std::string, std::pair<double, double> > ReferenceValues;
+
+  int readReference(const std::string& fileName, ReferenceValues& referenceValues)
+  {
+    std::ifstream file(fileName.data());
+    if ( !file ) return -1;
+    int version = -1;
+    std::string line;
+    while ( std::getline(file, line) ) {
+      if ( line.empty() ) continue;
+      if ( line[0] == '#' ) {
+	if ( line.find("sampleVersion") != std::string::npos ) version = atoi(line.substr(line.find('=') + 1).data());
+	continue;
+      }
+      std::istringstream fields(line);
+      std::string option, mode, name;
+      double mass, transverseMass;
+      if ( fields >> option >> mode >> name >> mass >> transverseMass ) {
+	referenceValues[option + " " + mode + " " + name] = std::make_pair(mass, transverseMass);
+      }
+    }
+    return version;
+  }
+
+  std::string jsonNumber(double value)
+  {
+    if ( !(value == value) ) return "null";
+    std::ostringstream number;
+    number << std::setprecision(8) << value;
+    return number.str();
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  // parse arguments
+  std::string jsonFileName;
+  std::string referenceFileName;
+  bool updateReference = false;
+  bool runMode[kNumModes] = { true, true, true };
+  unsigned numRepetitions = 1;
+  bool useMinuit = true;
+  bool requireReference = false;
+  for ( int iArg = 1; iArg < argc; ++iArg ) {
+    std::string arg = argv[iArg];
+    if ( arg == "--json" && iArg + 1 < argc ) {
+      jsonFileName = argv[++iArg];
+    } else if ( arg == "--reference" && iArg + 1 < argc ) {
+      referenceFileName = argv[++iArg];
+    } else if ( arg == "--update-reference" ) {
+      updateReference = true;
+    } else if ( arg == "--mode" && iArg + 1 < argc ) {
+      std::string mode = argv[++iArg];
+      for ( int iMode = 0; iMode < kNumModes; ++iMode ) {
+	runMode[iMode] = ( mode == "all" || mode == modeNames[iMode] );
+      }
+    } else if ( arg == "--repeat" && iArg + 1 < argc ) {
+      numRepetitions = std::max(1, atoi(argv[++iArg]));
+    } else if ( arg == "--minimizer" && iArg + 1 < argc && (std::string(argv[iArg + 1]) == "minuit" || std::string(argv[iArg + 1]) == "bfgs") ) {
+      useMinuit = ( std::string(argv[++iArg]) == "minuit" );
+    } else if ( arg == "--require-reference" ) {
+      requireReference = true;
+    } else {
+      std::cout << "Usage : " << argv[0] << " [--json output.json] [--reference reference.txt] [--update-reference]"
+		<< " [--mode all|fit|integrateVEGAS|integrateMarkovChain] [--repeat N] [--minimizer minuit|bfgs]"
+		<< " [--require-reference]" << std::endl;
+      return 1;
+    }
+  }
+  if ( updateReference && !useMinuit ) {
+    std::cout << "Reference values must be computed with Minuit2 --> ABORTING !!" << std::endl;
+    return 1;
+  }
+  if ( referenceFileName == "" ) {
+    referenceFileName = edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitStandaloneBenchmarkReference.txt").fullPath();
+  }
+  std::string inputFileName_visMassAndPtResolution = edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitVisMassAndPtResolutionPDF.root").fullPath();
+  std::string inputFileName_genTauHadMass = edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitGenTauHadMassPDF.root").fullPath();
+  TH1::AddDirectory(false);
+
+  ReferenceValues referenceValues;
+  int referenceVersion = readReference(referenceFileName, referenceValues);
+  if ( !updateReference && referenceVersion != kSampleVersion ) {
+    std::cout << "Warning: reference values in file = " << referenceFileName << " are for sample version = " << referenceVersion
+	      << ", not for version = " << kSampleVersion << " --> ignoring them !!" << std::endl;
+    referenceValues.clear();
+  }
+
+  // read the look-up tables before starting the clock
+  runEvent(referenceEvents[0], kFit, kShiftVisPt, inputFileName_visMassAndPtResolution, inputFileName_genTauHadMass);
+  runEvent(referenceEvents[0], kFit, kShiftVisMass, inputFileName_visMassAndPtResolution, inputFileName_genTauHadMass);
+  runEvent(referenceEvents[0], kFit, kMarginalizeVisMass, inputFileName_visMassAndPtResolution, inputFileName_genTauHadMass);
+
+  std::ostringstream json;
+  json << "{\n  \"sampleVersion\": " << kSampleVersion << ",\n  \"numEvents\": " << numReferenceEvents << ",\n  \"numRepetitions\": " << numRepetitions << ","
+       << "\n  \"minimizer\": \"" << ( useMinuit ? "minuit" : "bfgs" ) << "\",\n  \"results\": [";
+  // reference values of modes that are not run are kept when updating the reference file
+  ReferenceValues newReferenceValues = referenceValues;
+  std::vector<std::string> missingReferenceValues;
+  bool isFirst = true;
+  for ( int iMode = 0; iMode < kNumModes; ++iMode ) {
+    if ( !runMode[iMode] ) continue;
+    Mode mode = (Mode)iMode;
+    for ( int iOption = 0; iOption < kNumOptions; ++iOption ) {
+      Option option = (Option)iOption;
+      std::vector<Result> results(numReferenceEvents);
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for ( unsigned iRepetition = 0; iRepetition < numRepetitions; ++iRepetition ) {
+	for ( size_t idx = 0; idx < numReferenceEvents; ++idx ) {
+	  results[idx] = runEvent(referenceEvents[idx], mode, option, inputFileName_visMassAndPtResolution, inputFileName_genTauHadMass, useMinuit);
+	}
+      }
+      double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      double eventsPerSecond = ( time > 0. ) ? numRepetitions*numReferenceEvents/time : 0.;
+      double numObjFunctionCallsPerEvent = 0.;
+      unsigned numValidSolutions = 0;
+      double maxDeltaMass = 0.;
+      double maxDeltaTransverseMass = 0.;
+      unsigned numReferenceValues = 0;
+      std::cout << modeNames[mode] << " (" << optionNames[option] << "):" << std::endl;
+      for ( size_t idx = 0; idx < numReferenceEvents; ++idx ) {
+	const Result& result = results[idx];
+	std::string key = referenceKey(option, mode, referenceEvents[idx]);
+	numObjFunctionCallsPerEvent += result.numObjFunctionCalls;
+	if ( result.isValidSolution ) ++numValidSolutions;
+	newReferenceValues[key] = std::make_pair(result.mass, result.transverseMass);
+	std::cout << " " << referenceEvents[idx].name << ": mass = " << result.mass << ", transverse mass = " << result.transverseMass
+		  << " (#calls = " << result.numObjFunctionCalls << ")";
+	ReferenceValues::const_iterator referenceValue = referenceValues.find(key);
+	if ( referenceValue != referenceValues.end() ) {
+	  double deltaMass = result.mass - referenceValue->second.first;
+	  double deltaTransverseMass = result.transverseMass - referenceValue->second.second;
+	  std::cout << ", delta = " << deltaMass << ", " << deltaTransverseMass;
+	  maxDeltaMass = std::max(maxDeltaMass, std::fabs(deltaMass));
+	  maxDeltaTransverseMass = std::max(maxDeltaTransverseMass, std::fabs(deltaTransverseMass));
+	  ++numReferenceValues;
+	} else {
+	  missingReferenceValues.push_back(key);
+	}
+	std::cout << std::endl;
+      }
+      numObjFunctionCallsPerEvent /= numReferenceEvents;
+      std::cout << "--> " << eventsPerSecond << " events/s, " << numObjFunctionCallsPerEvent << " likelihood calls/event" << std::endl;
+      json << ( isFirst ? "" : "," ) << "\n    {\n"
+	   << "      \"mode\": \"" << modeNames[mode] << "\",\n"
+	   << "      \"option\": \"" << optionNames[option] << "\",\n"
+	   << "      \"time\": " << jsonNumber(time) << ",\n"
+	   << "      \"eventsPerSecond\": " << jsonNumber(eventsPerSecond) << ",\n"
+	   << "      \"objFunctionCallsPerEvent\": " << jsonNumber(numObjFunctionCallsPerEvent) << ",\n"
+	   << "      \"numValidSolutions\": " << numValidSolutions << ",\n"
+	   << "      \"numReferenceValues\": " << numReferenceValues << ",\n"
+	   << "      \"maxAbsDeltaMass\": " << ( numReferenceValues > 0 ? jsonNumber(maxDeltaMass) : "null" ) << ",\n"
+	   << "      \"maxAbsDeltaTransverseMass\": " << ( numReferenceValues > 0 ? jsonNumber(maxDeltaTransverseMass) : "null" ) << ",\n"
+	   << "      \"events\": [";
+      for ( size_t idx = 0; idx < numReferenceEvents; ++idx ) {
+	const Result& result = results[idx];
+	json << ( idx == 0 ? "" : "," ) << "\n        { \"name\": \"" << referenceEvents[idx].name << "\", "
+	     << "\"isValidSolution\": " << ( result.isValidSolution ? "true" : "false" ) << ", "
+	     << "\"mass\": " << jsonNumber(result.mass) << ", "
+	     << "\"transverseMass\": " << jsonNumber(result.transverseMass) << ", "
+	     << "\"objFunctionCalls\": " << result.numObjFunctionCalls << " }";
+      }
+      json << "\n      ]\n    }";
+      isFirst = false;
+    }
+  }
+  json << "\n  ],\n  \"numMissingReferenceValues\": " << missingReferenceValues.size();
+
+  json << "\n}\n";
+
+  if ( jsonFileName != "" ) {
+    std::ofstream jsonFile(jsonFileName.data());
+    jsonFile << json.str();
+    std::cout << "wrote results to " << jsonFileName << std::endl;
+  }
+  if ( updateReference ) {
+    std::ofstream referenceFile(referenceFileName.data());
+    referenceFile << "# reference values of benchmarkSVfitStandalone: option mode event mass transverseMass\n";
+    referenceFile << "# sampleVersion = " << kSampleVersion << "\n";
+    for ( ReferenceValues::const_iterator referenceValue = newReferenceValues.begin();
+	  referenceValue != newReferenceValues.end(); ++referenceValue ) {
+      referenceFile << referenceValue->first << " " << std::setprecision(8) << referenceValue->second.first << " " << referenceValue->second.second << "\n";
+    }
+    std::cout << "wrote reference values to " << referenceFileName << std::endl;
+  } else if ( !missingReferenceValues.empty() ) {
+    std::cout << "Warning: no reference values for " << missingReferenceValues.size() << " combinations of option, mode and event:" << std::endl;
+    for ( std::vector<std::string>::const_iterator key = missingReferenceValues.begin();
+	  key != missingReferenceValues.end(); ++key ) {
+      std::cout << " " << (*key) << std::endl;
+    }
+    if ( requireReference ) return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,39 @@
+
+/**
+   \class compileSVfitLUTs compileSVfitLUTs.cc "TauAnalysis/SVfitStandalone/bin/compileSVfitLUTs.cc"
+   \brief Write the look-up tables for the resolution on Pt and mass of hadronic taus into a precompiled file
+
+   The precompiled file can be made available to all instances of SVfitStandaloneAlgorithm by calling
+   SVfitStandaloneLUTRegistry::instance().loadPrecompiled(fileName), in which case the ROOT files are not read anymore.
+   The first input file is expected to contain the resolution on Pt and mass (svFitVisMassAndPtResolutionPDF.root),
+   further input files the mass distribution of the visible decay products (svFitGenTauHadMassPDF*.root).
+*/
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
+
+#include "TH1.h"
+
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+  // parse arguments
+  if ( argc < 3 ) {
+    std::cout << "Usage : " << argv[0] << " [outputfile] [svFitVisMassAndPtResolutionPDF.root] [svFitGenTauHadMassPDF.root ...]" << std::endl;
+    return 1;
+  }
+  TH1::AddDirectory(false);
+  SVfitStandaloneLUTRegistry& registry = SVfitStandaloneLUTRegistry::instance();
+  int decayModes[] = { 0, 1, 10 };
+  for ( int idx = 0; idx < 3; ++idx ) {
+    registry.visMassRes(argv[2], decayModes[idx]);
+    registry.visPtRes(argv[2], decayModes[idx]);
+  }
+  for ( int iArg = 3; iArg < argc; ++iArg ) {
+    registry.visMassAllDMs(argv[iArg]);
+  }
+  registry.writePrecompiled(argv[1]);
+  std::cout << "wrote " << registry.size() << " look-up tables to " << argv[1] << std::endl;
+  return 0;
+}
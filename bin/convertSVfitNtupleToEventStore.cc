@@ -0,0 +1,62 @@
+
+/**
+   \class convertSVfitNtupleToEventStore convertSVfitNtupleToEventStore.cc "TauAnalysis/SVfitStandalone/bin/convertSVfitNtupleToEventStore.cc"
+   \brief Convert flat n-tuple in the format read by testSVfitStandalone into a SVfitStandaloneEventStore file
+
+   The n-tuple is read by SVfitStandaloneTreeReader. The name of the tree defines the decay types
+   of the two tau leptons (EMu, MuTau, ETau or TauTau).
+*/
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneEventStore.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneTreeIO.h"
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <assert.h>
+
+int main(int argc, char* argv[])
+{
+  // parse arguments
+  if ( argc < 4 ) {
+    std::cout << "Usage : " << argv[0] << " [inputfile.root] [tree_name] [outputfile]" << std::endl;
+    return 1;
+  }
+  svFitStandalone::kDecayType l1Type, l2Type;
+  std::string channel = argv[2];
+  if ( channel == "EMu" ) {
+    l1Type = svFitStandalone::kTauToElecDecay;
+    l2Type = svFitStandalone::kTauToMuDecay;
+  } else if ( channel == "MuTau" ) {
+    l1Type = svFitStandalone::kTauToMuDecay;
+    l2Type = svFitStandalone::kTauToHadDecay;
+  } else if ( channel == "ETau" ) {
+    l1Type = svFitStandalone::kTauToElecDecay;
+    l2Type = svFitStandalone::kTauToHadDecay;
+  } else if ( channel == "TauTau" ) {
+    l1Type = svFitStandalone::kTauToHadDecay;
+    l2Type = svFitStandalone::kTauToHadDecay;
+  } else {
+    std::cerr << "Error: Invalid channel = " << channel << " !!" << std::endl;
+    std::cerr << "(some customization of this code will be needed for your analysis)" << std::endl;
+    assert(0);
+  }
+  TFile* file = new TFile(argv[1]);
+  TTree* tree = (TTree*) file->Get(argv[2]);
+  SVfitStandaloneTreeReader reader(tree, l1Type, l2Type);
+  long nevent = reader.numEntries();
+  SVfitStandaloneEventStore store(argv[3], SVfitStandaloneEventStore::kCreate, nevent);
+  std::vector<svFitStandalone::BatchEvent> events;
+  while ( reader.nextCluster(events) ) {
+    for ( size_t idx = 0; idx < events.size(); ++idx ) {
+      store.setEvent(reader.firstEntry() + idx, events[idx]);
+    }
+  }
+  store.flush();
+  std::cout << "converted " << nevent << " events from " << argv[1] << " to " << argv[3] << std::endl;
+  delete file;
+  return 0;
+}
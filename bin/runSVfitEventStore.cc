@@ -0,0 +1,41 @@
+
+/**
+   \class runSVfitEventStore runSVfitEventStore.cc "TauAnalysis/SVfitStandalone/bin/runSVfitEventStore.cc"
+   \brief Reconstruct the di-tau mass for the events in a SVfitStandaloneEventStore file and store the results in the same file
+
+   Events are processed in blocks by SVfitStandaloneBatchAlgorithm in Markov Chain integration mode. An optional range of events
+   allows to run several jobs on disjoint ranges of the same file in parallel.
+*/
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneEventStore.h"
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char* argv[])
+{
+  // parse arguments
+  if ( argc < 2 ) {
+    std::cout << "Usage : " << argv[0] << " [eventstore] [first event] [last event]" << std::endl;
+    return 1;
+  }
+  SVfitStandaloneEventStore store(argv[1], SVfitStandaloneEventStore::kUpdate);
+  size_t first = ( argc >= 3 ) ? atol(argv[2]) : 0;
+  size_t last = ( argc >= 4 ) ? atol(argv[3]) : store.numEvents();
+  if ( last > store.numEvents() ) last = store.numEvents();
+  const size_t blockSize = 1000;
+  SVfitStandaloneBatchAlgorithm algo(SVfitStandaloneBatchAlgorithm::kIntegrateMarkovChain);
+  std::vector<svFitStandalone::BatchEvent> events;
+  svFitStandalone::BatchResults results;
+  for ( size_t block = first; block < last; block += blockSize ) {
+    size_t numEvents = std::min(blockSize, last - block);
+    store.getEvents(block, numEvents, events);
+    algo.run(events.data(), numEvents, results);
+    store.setResults(block, results);
+    std::cout << "processed events " << block << ".." << (block + numEvents) << std::endl;
+  }
+  store.flush();
+  return 0;
+}
@@ -10,6 +10,7 @@
 #include "FWCore/ParameterSet/interface/FileInPath.h"
 
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneAlgorithm.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneTreeIO.h"
 
 #include "TFile.h"
 #include "TTree.h"
@@ -156,9 +157,55 @@ void eventsFromTree(int argc, char* argv[])
   return;
 }
 
+void eventsFromTreeBatch(int argc, char* argv[]) 
+{
+  // parse arguments
+  if ( argc < 4 ) {
+    std::cout << "Usage : " << argv[0] << " [inputfile.root] [tree_name] [outputfile.root]" << std::endl;
+    return;
+  }
+  svFitStandalone::kDecayType l1Type, l2Type;
+  if ( std::string(argv[2]) == "EMu" ) {
+    l1Type = svFitStandalone::kTauToElecDecay;
+    l2Type = svFitStandalone::kTauToMuDecay;
+  } else if ( std::string(argv[2]) == "MuTau" ) {
+    l1Type = svFitStandalone::kTauToMuDecay;
+    l2Type = svFitStandalone::kTauToHadDecay;
+  } else if ( std::string(argv[2]) == "ETau" ) {
+    l1Type = svFitStandalone::kTauToElecDecay;
+    l2Type = svFitStandalone::kTauToHadDecay;
+  } else if ( std::string(argv[2]) == "TauTau" ) {
+    l1Type = svFitStandalone::kTauToHadDecay;
+    l2Type = svFitStandalone::kTauToHadDecay;
+  } else {
+    std::cerr << "Error: Invalid channel = " << std::string(argv[2]) << " !!" << std::endl;
+    std::cerr << "(some customization of this code will be needed for your analysis)" << std::endl;
+    assert(0);
+  }
+  TFile* file = new TFile(argv[1]); 
+  TTree* tree = (TTree*) file->Get(argv[2]);
+  // read the inputs cluster by cluster and reconstruct each cluster as one batch
+  SVfitStandaloneTreeReader reader(tree, l1Type, l2Type);
+  SVfitStandaloneBatchAlgorithm algo(SVfitStandaloneBatchAlgorithm::kIntegrateVEGAS);
+  algo.maxObjFunctionCalls(5000);
+  // the results are written to a friend tree with the same number of entries as the input tree;
+  // add it to the input tree by tree->AddFriend("svFit", outputfile.root)
+  SVfitStandaloneFriendTreeWriter writer(argv[3], "svFit");
+  std::vector<svFitStandalone::BatchEvent> events;
+  svFitStandalone::BatchResults results;
+  while ( reader.nextCluster(events) ) {
+    algo.run(events.data(), events.size(), results);
+    writer.fill(results);
+    std::cout << "processed entries " << reader.firstEntry() << ".." << (reader.firstEntry() + events.size()) << std::endl;
+  }
+  writer.write();
+  delete file;
+}
+
 int main(int argc, char* argv[]) 
 {
   //eventsFromTree(argc, argv);
+  //eventsFromTreeBatch(argc, argv);
   singleEvent();
   return 0;
 }
@@ -4,6 +4,11 @@
 #include "TMatrixD.h"
 #include "TH1.h"
 
+namespace svFitStandalone
+{
+  class LookupTable;
+}
+
 /**
    \class   probMET LikelihoodFunctions.h "TauAnalysis/SVfitStandalone/interface/LikelihoodFunctions.h"
    
@@ -57,9 +62,10 @@ double probTauToHadPhaseSpace(double decayAngle, double nunuMass, double visMass
 
    Likelihood for hadronic tau decay to produce visible decay products of true mass (visMass)
 
-    lutVisMass : histograms that parametrize the mass distribution of the visible decay products produced in hadronic tau decays on generator level
+    lutVisMass : histograms (or look-up tables of SVfitStandaloneLUTRegistry) that parametrize the mass distribution of the visible decay products produced in hadronic tau decays on generator level
 */
 double probVisMass(double visMass, const TH1* lutVisMass, bool verbosity = false);
+double probVisMass(double visMass, const svFitStandalone::LookupTable* lutVisMass, bool verbosity = false);
 
 /**
    \class   probVisMassShift, probVisPtShift LikelihoodFunctions.h "TauAnalysis/SVfitStandalone/interface/LikelihoodFunctions.h"
@@ -69,9 +75,11 @@ double probVisMass(double visMass, const TH1* lutVisMass, bool verbosity = false
    Likelihood for a hadronic tau of true Pt and mass (visMass, visPt)
    to be reconstructed with Pt and mass of (visMass + deltaVisMass, recTauPtDivGenTauPt*visPt)
 
-    lutVisMassRes, lutVisPtRes : histograms that parametrize the Pt and mass resolution for hadronic taus
+    lutVisMassRes, lutVisPtRes : histograms (or look-up tables of SVfitStandaloneLUTRegistry) that parametrize the Pt and mass resolution for hadronic taus
 */
 double probVisMassShift(double deltaVisMass, const TH1* lutVisMassRes, bool verbosity = false);
 double probVisPtShift(double recTauPtDivGenTauPt, const TH1* lutVisPtRes, bool verbosity = false);
+double probVisMassShift(double deltaVisMass, const svFitStandalone::LookupTable* lutVisMassRes, bool verbosity = false);
+double probVisPtShift(double recTauPtDivGenTauPt, const svFitStandalone::LookupTable* lutVisPtRes, bool verbosity = false);
 
 #endif
@@ -3,14 +3,19 @@
 
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLikelihood.h"
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneMarkovChainIntegrator.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneVEGASIntegrator.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneMinimizer.h"
 #include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneQuantities.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneSampleFile.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneOutputSink.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStatistics.h"
 
 #include <TMath.h>
 #include <TArrayF.h>
 #include <TString.h>
 #include <TH1.h>
-#include <TBenchmark.h>
 
 using svFitStandalone::Vector;
 using svFitStandalone::LorentzVector;
@@ -86,18 +91,32 @@ class SVfitStandaloneAlgorithm
   /// destructor
   ~SVfitStandaloneAlgorithm();
 
+  /// set the measurements of the next event, keeping the configuration and reusing all internal objects 
+  /// (likelihood, minimizer, integrators) of the previous event
+  void reset(const std::vector<MeasuredTauLepton>& measuredTauLeptons, double measuredMETx, double measuredMETy, const TMatrixD& covMET);
+
   /// add an additional logM(tau,tau) term to the nll to suppress tails on M(tau,tau) (default is false)
   void addLogM(bool value, double power = 1.) { nll_->addLogM(value, power); }
   /// modify the MET term in the nll by an additional power (default is 1.)
   void metPower(double value) { nll_->metPower(value); }
-  /// marginalize unknown mass of hadronic tau decay products (ATLAS case)
+  /// marginalize unknown mass of hadronic tau decay products (ATLAS case);
+  /// the look-up tables are taken from SVfitStandaloneLUTRegistry, so that they are read only once per process
   void marginalizeVisMass(bool value, TFile* inputFile);
+  void marginalizeVisMass(bool value, const std::string& inputFileName);
   void marginalizeVisMass(bool value, const TH1*);
+  void marginalizeVisMass(bool value, const svFitStandalone::LookupTable*);
   /// take resolution on energy and mass of hadronic tau decays into account
   void shiftVisMass(bool value, TFile* inputFile);
+  void shiftVisMass(bool value, const std::string& inputFileName);
   void shiftVisPt(bool value, TFile* inputFile);
+  void shiftVisPt(bool value, const std::string& inputFileName);
   /// maximum function calls after which to stop the minimization procedure (default is 5000)
   void maxObjFunctionCalls(double value) { maxObjFunctionCalls_ = value; }
+  /// provide analytic derivatives of the objective function to minuit in fit mode (default is true)
+  void useAnalyticGradient(bool value) { useAnalyticGradient_ = value; }
+  /// use Minuit2 for the minimization in fit mode (default is true); 
+  /// if false, the built-in quasi-Newton minimizer defined in interface/SVfitStandaloneMinimizer.h is used
+  void useMinuit(bool value) { useMinuit_ = value; }
 
   /// fit to be called from outside
   void fit();
@@ -105,8 +124,37 @@ class SVfitStandaloneAlgorithm
   void integrate() { return integrateVEGAS(""); }
   /// integration by VEGAS to be called from outside
   void integrateVEGAS(const std::string& likelihoodFileName = "");
+  /// treat the di-tau mass as additional integration variable in VEGAS mode, so that the mass distribution 
+  /// is obtained by a single integration instead of a scan over mass hypotheses (default is false)
+  void integrateOverMass(bool value) { integrateOverMass_ = value; }
   /// integration by Markov Chain MC to be called from outside
   void integrateMarkovChain(const std::string& likelihoodFileName = "");
+  /// seed of the random number generators used for VEGAS and Markov Chain integration (default is 12345);
+  /// the generators are reset to this seed for each integration, so that events integrated with the same seed 
+  /// use the same sequence of random numbers
+  void randomSeed(unsigned value) { randomSeed_ = value; }
+  /// scale the number of integrand evaluations in VEGAS and Markov Chain integration mode by the given factor (default is 1.)
+  void sampleFraction(double value) { sampleFraction_ = value; }
+  /// keep the positions visited by the Markov Chain, so that the results can be recomputed by reweightMarkovChain 
+  /// for a modified MET or logM term of the likelihood without running the Markov Chain again (default is false)
+  void keepMarkovChainSamples(bool value) { keepMarkovChainSamples_ = value; }
+  /// configuration of the MET and logM terms of the likelihood used by the last Markov Chain integration
+  svFitStandalone::PosteriorConfiguration posteriorConfiguration() const;
+  /// recompute the results of the last Markov Chain integration for the given configuration of the MET and logM terms of the likelihood.
+  /// The samples kept by the Markov Chain are reweighted in case the effective number of samples after reweighting is at least 
+  /// minRelEffectiveSampleSize times the number of iterations, otherwise the Markov Chain integration is run again with the likelihood
+  /// changed to the given configuration; the previous configuration is restored afterwards. Returns true if the results have been obtained by reweighting.
+  bool reweightMarkovChain(const svFitStandalone::PosteriorConfiguration& config, double minRelEffectiveSampleSize = 0.1);
+  /// write the samples of the Markov Chain integration for each event to the given file (default is none; the writer is not owned).
+  /// Call SVfitStandaloneSampleFileWriter::setEventId before integrateMarkovChain to store the event number.
+  void markovChainSampleFile(SVfitStandaloneSampleFileWriter* writer) { markovChainSampleFile_ = writer; }
+  /// append the likelihood curve (VEGAS integration) or the histograms of the quantities (Markov Chain integration) of each event 
+  /// to the given sink, in addition to or instead of writing them to a ROOT file per event (default is none; the sink is not owned)
+  void outputSink(SVfitStandaloneOutputSink* sink) { outputSink_ = sink; }
+  /// run, lumi-section and event number under which the output of the next integration is stored in the sink
+  void eventId(unsigned long long run, unsigned long long lumi, unsigned long long event) { outputEvent_.run = run; outputEvent_.lumi = lumi; outputEvent_.event = event; }
+  /// graphs and histograms last written to the sink
+  const svFitStandalone::OutputEvent& outputEvent() const { return outputEvent_; }
 
   /// return status of minuit fit
   /*
@@ -127,6 +175,15 @@ class SVfitStandaloneAlgorithm
   bool isValidFit() const { return fitStatus_ == 0; }
   /// return whether this is a valid solution or not
   bool isValidNLL() const { return nllStatus_ == 0; }
+  /// return error code of the likelihood (see SVfitStandaloneLikelihood::ErrorCodes)
+  unsigned int nllStatus() const { return nllStatus_; }
+  /// return number of evaluations of the likelihood for the current event
+  unsigned numObjFunctionCalls() const { return nll_->numObjFunctionCalls(); }
+  /// collect runtime statistics in each call to fit, integrateVEGAS and integrateMarkovChain (default is false);
+  /// the statistics are always collected and printed for verbosity >= 1
+  void collectStatistics(bool value) { collectStatistics_ = value; }
+  /// return runtime statistics of the last call to fit, integrateVEGAS or integrateMarkovChain
+  const svFitStandalone::Statistics& statistics() const { return statistics_; }
   
   // DO NOT CALL THE FOLLOWING FUNCTION AFTER MARKOV CHAIN INTEGRATION BUT USE THE QUANTITIES ADAPTER AS IN THE TEST CODE
   /// return mass of the di-tau system
@@ -157,6 +214,19 @@ class SVfitStandaloneAlgorithm
  protected:
   /// setup the starting values for the minimization (default values for the fit parameters are taken from src/SVFitParameters.cc in the same package)
   void setup();
+  /// round measured quantities to a fixed number of digits and bring the tau leptons into the order expected by the integration
+  void prepareMeasurements(const std::vector<MeasuredTauLepton>&, double, double, const TMatrixD&, 
+			   std::vector<MeasuredTauLepton>&, Vector&, TMatrixD&) const;
+  /// number of integrand evaluations scaled by sampleFraction
+  unsigned scaleNumCalls(unsigned) const;
+  /// define fit parameter for the minimizer in use
+  void setVariable(unsigned, double, double);
+  void setLimitedVariable(unsigned, double, double, double, double);
+  void setFixedVariable(unsigned, double);
+  /// start collecting runtime statistics for the given mode in case enabled, returns whether statistics are collected
+  bool beginStatistics(svFitStandalone::Statistics::Mode);
+  /// complete runtime statistics of the current call
+  void endStatistics();
 
  protected:
   /// return whether this is a valid solution or not
@@ -167,16 +237,30 @@ class SVfitStandaloneAlgorithm
   unsigned int verbosity_;
   /// stop minimization after a maximal number of function calls
   unsigned int maxObjFunctionCalls_;
+  /// provide analytic derivatives of the objective function to minuit
+  bool useAnalyticGradient_;
+  /// use Minuit2 or the built-in minimizer in fit mode
+  bool useMinuit_;
 
-  /// minuit instance
+  /// minuit instance (created on first use)
   ROOT::Math::Minimizer* minimizer_;
+  /// built-in minimizer
+  SVfitStandaloneMinimizer minimizerBFGS_;
   /// standalone combined likelihood
   svFitStandalone::SVfitStandaloneLikelihood* nll_;
   /// needed to make the fit function callable from within minuit
   svFitStandalone::ObjectiveFunctionAdapterMINUIT standaloneObjectiveFunctionAdapterMINUIT_;
+  /// measurements passed on to the likelihood (kept as data-members to reuse their memory from event to event)
+  std::vector<MeasuredTauLepton> measuredTauLeptons_rounded_;
+  Vector measuredMET_rounded_;
+  TMatrixD covMET_rounded_;
 
-  /// needed for VEGAS integration
+  /// needed for VEGAS integration (created on first use)
   svFitStandalone::ObjectiveFunctionAdapterVEGAS* standaloneObjectiveFunctionAdapterVEGAS_;
+  svFitStandalone::MassHistogramAdapterVEGAS* massHistogramAdapterVEGAS_;
+  SVfitStandaloneVEGASIntegrator* integratorVEGAS_;
+  /// integrate over mass in VEGAS mode instead of scanning mass hypotheses
+  bool integrateOverMass_;
 
   /// fitted di-tau mass
   double mass_;
@@ -203,19 +287,39 @@ class SVfitStandaloneAlgorithm
   bool isInitialized2_;
   unsigned maxObjFunctionCalls2_;
 
-  TBenchmark* clock_;
+  /// seed of random number generators and scale factor for number of integrand evaluations
+  unsigned randomSeed_;
+  double sampleFraction_;
+
+  /// keep samples of Markov Chain for reweighting
+  bool keepMarkovChainSamples_;
+
+  /// file to which samples of Markov Chain are written
+  SVfitStandaloneSampleFileWriter* markovChainSampleFile_;
+
+  /// sink to which likelihood curves and histograms are written
+  SVfitStandaloneOutputSink* outputSink_;
+  svFitStandalone::OutputEvent outputEvent_;
+
+  /// runtime statistics of the last call to fit, integrateVEGAS or integrateMarkovChain
+  bool collectStatistics_;
+  svFitStandalone::Statistics statistics_;
+  svFitStandalone::Statistics::Clock::time_point statisticsStartTime_;
+  unsigned statisticsStartNumObjFunctionCalls_;
 
   /// resolution on Pt and mass of hadronic taus
+  /// (look-up tables owned by SVfitStandaloneLUTRegistry, except for lutVisMassAllDMs_owned_ which is converted from a TH1)
   bool marginalizeVisMass_;
-  const TH1* lutVisMassAllDMs_;
+  const svFitStandalone::LookupTable* lutVisMassAllDMs_;
+  svFitStandalone::LookupTable* lutVisMassAllDMs_owned_;
   bool shiftVisMass_;
-  const TH1* lutVisMassResDM0_;
-  const TH1* lutVisMassResDM1_;
-  const TH1* lutVisMassResDM10_;
+  const svFitStandalone::LookupTable* lutVisMassResDM0_;
+  const svFitStandalone::LookupTable* lutVisMassResDM1_;
+  const svFitStandalone::LookupTable* lutVisMassResDM10_;
   bool shiftVisPt_;
-  const TH1* lutVisPtResDM0_;
-  const TH1* lutVisPtResDM1_;
-  const TH1* lutVisPtResDM10_;
+  const svFitStandalone::LookupTable* lutVisPtResDM0_;
+  const svFitStandalone::LookupTable* lutVisPtResDM1_;
+  const svFitStandalone::LookupTable* lutVisPtResDM10_;
 
   bool l1isLep_;
   int idxFitParLeg1_;
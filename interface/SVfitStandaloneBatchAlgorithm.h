@@ -0,0 +1,183 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneBatchAlgorithm_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneBatchAlgorithm_h
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneAlgorithm.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneResultCache.h"
+
+#include <vector>
+#include <unordered_map>
+
+namespace svFitStandalone
+{
+  /**
+     \struct  BatchEvent
+     \brief   measured quantities of one event, as needed as input by SVfitStandaloneBatchAlgorithm
+  */
+  struct BatchEvent
+  {
+    /// type, decay mode and four-vector of the visible decay products of the two tau leptons
+    kDecayType leg1Type;
+    int leg1DecayMode;
+    double leg1Pt;
+    double leg1Eta;
+    double leg1Phi;
+    double leg1Mass;
+    kDecayType leg2Type;
+    int leg2DecayMode;
+    double leg2Pt;
+    double leg2Eta;
+    double leg2Phi;
+    double leg2Mass;
+    /// measured MET and its covariance matrix
+    double measuredMETx;
+    double measuredMETy;
+    double covMET00;
+    double covMET01;
+    double covMET10;
+    double covMET11;
+  };
+
+  /**
+     \struct  BatchResults
+     \brief   results of SVfitStandaloneBatchAlgorithm, stored as structure-of-arrays (index = index of event in the input array)
+  */
+  struct BatchResults
+  {
+    void resize(size_t numEvents);
+    size_t size() const { return mass.size(); }
+    /// copy results of event with index idx from/to the format used by SVfitStandaloneResultCache
+    void get(size_t idx, CachedResult& result) const;
+    void set(size_t idx, const CachedResult& result);
+
+    std::vector<double> mass;
+    std::vector<double> massUncert;
+    std::vector<double> massLmax;
+    std::vector<double> transverseMass;
+    std::vector<double> transverseMassUncert;
+    std::vector<double> transverseMassLmax;
+    std::vector<int> fitStatus;
+    std::vector<unsigned int> nllStatus;
+    std::vector<char> isValidSolution;
+  };
+}
+
+/**
+   \class   SVfitStandaloneBatchAlgorithm SVfitStandaloneBatchAlgorithm.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneBatchAlgorithm.h"
+
+   \brief   Reconstruction of the di-tau mass for an array of events.
+
+   The events are grouped by channel (combination of tau decay types) and processed channel by channel. One instance of
+   SVfitStandaloneAlgorithm is kept per channel and reused for all events of this channel by means of SVfitStandaloneAlgorithm::reset,
+   so that the likelihood, minimizer and integrators (including their buffers) are set up only once. The configuration given to
+   this class is applied to each of these instances.
+
+   Optionally, a result cache (see interface/SVfitStandaloneResultCache.h) can be given. Events for which the cache contains
+   a result for the same rounded inputs and configuration are then not reconstructed again, events that appear more than once
+   within the batch are reconstructed only once, and the results of all reconstructed events are added to the cache.
+
+   Systematic variations of an event are reconstructed by runVariations. The nominal event and its variations are processed
+   by the same instance of SVfitStandaloneAlgorithm (per channel), and all of them are integrated with the same seed of the
+   random number generators and the same number of integrand evaluations (see variationSampleFraction). Using these common
+   random numbers, the statistical fluctuations of the integration are strongly correlated between the nominal event and its
+   variations and largely cancel in the shifts, so that fewer integrand evaluations may suffice for the shifts.
+   NOTE: the stages of VEGAS and Markov Chain integration depend on the number of integrand evaluations,
+         so the random numbers are common only if the nominal event is integrated with the same number as the variations.
+
+   Common usage is:
+
+   SVfitStandaloneBatchAlgorithm algo(SVfitStandaloneBatchAlgorithm::kIntegrateMarkovChain);
+   algo.addLogM(true, 1.);
+   svFitStandalone::BatchResults results;
+   algo.run(events, numEvents, results);
+   std::cout << results.mass[0];
+*/
+
+class SVfitStandaloneBatchAlgorithm
+{
+ public:
+  enum Mode { kFit, kIntegrateVEGAS, kIntegrateMarkovChain };
+
+  SVfitStandaloneBatchAlgorithm(Mode mode = kIntegrateMarkovChain, unsigned int verbosity = 0);
+  ~SVfitStandaloneBatchAlgorithm();
+
+  /// configuration, as in SVfitStandaloneAlgorithm;
+  /// the configuration may be changed between calls to run, the algorithms of all channels are then set up again
+  void addLogM(bool value, double power = 1.) { addLogM_ = value; powerLogM_ = power; isConfigurationChanged_ = true; }
+  void metPower(double value) { metPower_ = value; isConfigurationChanged_ = true; }
+  void marginalizeVisMass(bool value, const TH1* lut);
+  void marginalizeVisMass(bool value, const svFitStandalone::LookupTable* lut) { marginalizeVisMass_ = value; lutVisMassAllDMs_ = lut; isConfigurationChanged_ = true; }
+  void shiftVisMass(bool value, TFile* inputFile) { shiftVisMass_ = value; inputFileVisMassRes_ = inputFile; isConfigurationChanged_ = true; }
+  void shiftVisPt(bool value, TFile* inputFile) { shiftVisPt_ = value; inputFileVisPtRes_ = inputFile; isConfigurationChanged_ = true; }
+  void maxObjFunctionCalls(double value) { maxObjFunctionCalls_ = value; isConfigurationChanged_ = true; }
+  void integrateOverMass(bool value) { integrateOverMass_ = value; isConfigurationChanged_ = true; }
+  /// track the distributions of the reconstructed quantities by streaming quantile estimators instead of histograms 
+  /// in Markov Chain integration mode (default is false)
+  void useStreamingEstimators(bool value) { useStreamingEstimators_ = value; isConfigurationChanged_ = true; }
+  /// reuse results of previously reconstructed events with identical inputs (default is no cache);
+  /// the cache is not owned by this class and may be shared between instances with different configuration
+  void resultCache(SVfitStandaloneResultCache* cache) { resultCache_ = cache; }
+
+  /// scale the number of integrand evaluations used for the nominal event and the variations processed by runVariations (default is 1.)
+  void variationSampleFraction(double value) { variationSampleFraction_ = value; }
+
+  /// reconstruct numEvents events stored contiguously in events, the results are stored in results
+  void run(const svFitStandalone::BatchEvent* events, size_t numEvents, svFitStandalone::BatchResults& results);
+  /// reconstruct nominal event and numVariations variations of it (e.g. shifts of tau energy scale or MET);
+  /// results[0] holds the results for the nominal event, results[1 + i] the results for variation i
+  void runVariations(const svFitStandalone::BatchEvent& nominal, const svFitStandalone::BatchEvent* variations, size_t numVariations, 
+		     svFitStandalone::BatchResults& results);
+
+ protected:
+  enum { kNumDecayTypes = svFitStandalone::kPrompt + 1, kNumChannels = kNumDecayTypes*kNumDecayTypes };
+
+  /// fill measured quantities of event
+  void setMeasurements(const svFitStandalone::BatchEvent&);
+  /// apply configuration to newly created algorithm
+  void configure(SVfitStandaloneAlgorithm&) const;
+  /// store results of algorithm for event with index idx
+  void fillResults(const SVfitStandaloneAlgorithm&, size_t idx, svFitStandalone::BatchResults&) const;
+  /// compute the part of the keys in the result cache that depends on the configuration only (called once per call to run or runVariations)
+  void computeConfigurationKey();
+  /// compute key of event in result cache
+  svFitStandalone::ResultCacheKey computeKey(const svFitStandalone::BatchEvent&, double sampleFraction = 1.) const;
+  /// reconstruct event with given scale factor for the number of integrand evaluations and store results for index idx
+  void process(const svFitStandalone::BatchEvent&, double sampleFraction, size_t idx, svFitStandalone::BatchResults&);
+
+  Mode mode_;
+  unsigned int verbosity_;
+
+  /// configuration
+  bool addLogM_;
+  double powerLogM_;
+  double metPower_;
+  bool marginalizeVisMass_;
+  const svFitStandalone::LookupTable* lutVisMassAllDMs_;
+  svFitStandalone::LookupTable* lutVisMassAllDMs_owned_;
+  bool shiftVisMass_;
+  TFile* inputFileVisMassRes_;
+  bool shiftVisPt_;
+  TFile* inputFileVisPtRes_;
+  unsigned int maxObjFunctionCalls_;
+  bool integrateOverMass_;
+  bool useStreamingEstimators_;
+  double variationSampleFraction_;
+  /// flag indicating that the configuration has been changed since the algorithms have been created
+  bool isConfigurationChanged_;
+
+  /// result cache (not owned)
+  SVfitStandaloneResultCache* resultCache_;
+  svFitStandalone::ResultCacheKey configurationKey_;
+  /// one algorithm per channel, created on first use
+  SVfitStandaloneAlgorithm* algorithms_[kNumChannels];
+
+  /// buffers reused from call to call
+  std::vector<unsigned> channels_;
+  std::vector<size_t> order_;
+  std::vector<svFitStandalone::ResultCacheKey> keys_;
+  std::vector<size_t> duplicateOf_;
+  std::unordered_map<svFitStandalone::ResultCacheKey, size_t, svFitStandalone::ResultCacheKey::Hash> firstOccurrence_;
+  std::vector<MeasuredTauLepton> measuredTauLeptons_;
+  TMatrixD covMET_;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneEventStore_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneEventStore_h
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneBatchAlgorithm.h"
+
+#include <string>
+#include <vector>
+
+/**
+   \class   SVfitStandaloneEventStore SVfitStandaloneEventStore.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneEventStore.h"
+
+   \brief   Columnar file holding the inputs and outputs of SVfitStandaloneBatchAlgorithm for a fixed number of events.
+
+   The file has a fixed schema: one column per measured quantity of svFitStandalone::BatchEvent and one column per result
+   of svFitStandalone::BatchResults. Columns of type double hold 8-byte values, all other columns 4-byte integers.
+   The file starts with a header (format, number of events, number of columns), followed by a table of the columns
+   (name, type, offset) and the columns themselves, each aligned to 64 bytes. The file is memory-mapped, so that columns
+   are accessed in place without deserialisation: read-only in mode kRead, read-write in mode kUpdate
+   (e.g. to store the results of events which have been read in mode kRead before) and in mode kCreate, which creates
+   a new file for the given number of events with all columns set to 0.
+*/
+
+class SVfitStandaloneEventStore
+{
+ public:
+  enum Mode { kRead, kUpdate, kCreate };
+  enum Column {
+    kLeg1Type, kLeg1DecayMode, kLeg1Pt, kLeg1Eta, kLeg1Phi, kLeg1Mass,
+    kLeg2Type, kLeg2DecayMode, kLeg2Pt, kLeg2Eta, kLeg2Phi, kLeg2Mass,
+    kMeasuredMETx, kMeasuredMETy, kCovMET00, kCovMET01, kCovMET10, kCovMET11,
+    kMass, kMassUncert, kMassLmax, kTransverseMass, kTransverseMassUncert, kTransverseMassLmax,
+    kFitStatus, kNllStatus, kIsValidSolution,
+    kNumColumns
+  };
+  enum ColumnType { kInt, kDouble };
+
+  SVfitStandaloneEventStore(const std::string& fileName, Mode mode = kRead, size_t numEvents = 0);
+  ~SVfitStandaloneEventStore();
+
+  /// number of events stored in the file
+  size_t numEvents() const { return numEvents_; }
+
+  /// name and type of column
+  static const char* columnName(Column);
+  static ColumnType columnType(Column);
+
+  /// direct access to columns (the mutable versions require mode kUpdate or kCreate)
+  const double* doubleColumn(Column) const;
+  const int* intColumn(Column) const;
+  double* mutableDoubleColumn(Column);
+  int* mutableIntColumn(Column);
+
+  /// copy measured quantities of events from/to the file
+  void getEvent(size_t idx, svFitStandalone::BatchEvent& event) const;
+  void getEvents(size_t first, size_t numEvents, std::vector<svFitStandalone::BatchEvent>& events) const;
+  void setEvent(size_t idx, const svFitStandalone::BatchEvent& event);
+
+  /// copy results of events from/to the file (index in results = index in the file - first)
+  void getResults(size_t first, size_t numEvents, svFitStandalone::BatchResults& results) const;
+  void setResults(size_t first, const svFitStandalone::BatchResults& results);
+
+  /// write modified columns to the file
+  void flush();
+
+ protected:
+  void checkColumn(Column, ColumnType) const;
+  void checkRange(size_t, size_t) const;
+  void checkWritable() const;
+  /// access to column without checks, for internal use
+  template <typename T>
+  T* column(Column idx) const { return reinterpret_cast<T*>(columns_[idx]); }
+
+  std::string fileName_;
+  Mode mode_;
+  size_t numEvents_;
+
+  char* data_;
+  size_t size_;
+  char* columns_[kNumColumns];
+};
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneFlatHistogram_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneFlatHistogram_h
+
+#include <string>
+#include <vector>
+
+class TH1;
+
+namespace svFitStandalone
+{
+  /**
+     \class   FlatHistogram SVfitStandaloneFlatHistogram.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneFlatHistogram.h"
+
+     \brief   Lightweight one-dimensional histogram, used to accumulate the distributions of the quantities reconstructed by SVfit.
+
+     In contrast to TH1, the histogram is not registered in any ROOT directory, and the memory for the bin contents is kept
+     when the binning is changed or the histogram is reset, so that the same object can be reused from event to event.
+     The bin index is computed analytically for uniform and logarithmic binnings, the latter following the convention
+     of svFitStandalone::makeHistogram (first bin from 0 to xMin, followed by bins of logarithmic width).
+     The bin numbering (0 = underflow, numBins + 1 = overflow), the bin edges and the statistics
+     follow the conventions of TH1D, to which the histogram can be converted when it needs to be written to a file.
+  */
+  class FlatHistogram
+  {
+   public:
+    FlatHistogram();
+    ~FlatHistogram() {}
+
+    void SetName(const std::string& name) { name_ = name; }
+    const char* GetName() const { return name_.data(); }
+
+    /// numBins bins of equal width between xMin and xMax
+    void SetUniformBinning(int numBins, double xMin, double xMax);
+    /// first bin from 0 to xMin, followed by bins of logarithmic width up to xMax (same binning as svFitStandalone::makeHistogram)
+    void SetLogBinning(double xMin, double xMax, double logBinWidth);
+    /// arbitrary binning, given by numBins + 1 bin edges
+    void SetBinning(int numBins, const double* binEdges);
+
+    /// set all bin contents and statistics to zero, keeping the binning
+    void Reset();
+    /// add value x with given weight
+    void Fill(double x, double weight = 1.);
+    /// add value x numEntries times with given weight (same result as numEntries calls of Fill(x, weight))
+    void FillRepeated(double x, double numEntries, double weight = 1.);
+    /// return index of bin containing x
+    int FindBin(double x) const;
+
+    int GetNbinsX() const { return numBins_; }
+    double GetBinContent(int bin) const { return binContents_[bin]; }
+    double GetBinError(int bin) const;
+    double GetBinLowEdge(int bin) const;
+    double GetBinWidth(int bin) const;
+    double GetBinCenter(int bin) const;
+    /// mean of all values filled within the range of the histogram
+    double GetMean() const { return ( sumWeights_ != 0. ) ? (sumWeightedValues_/sumWeights_) : 0.; }
+    /// sum of bin contents, excluding underflow and overflow
+    double Integral() const;
+
+    /// create TH1D with same name, binning and content (to be deleted by the caller)
+    TH1* CreateTH1() const;
+
+   protected:
+    enum { kUniform, kLog, kVariable };
+
+    std::string name_;
+
+    int binningType_;
+    int numBins_;
+    double xMin_;
+    double xMax_;
+    /// logarithmic binning: lower edge of second bin and 1/log(logBinWidth)
+    double xMinLog_;
+    double invLogBinWidth_;
+    /// bin edges (numBins + 1 entries); for logarithmic binning the edges are rounded to float precision, as by makeHistogram
+    std::vector<double> binEdges_;
+
+    /// bin contents and sums of squared weights (numBins + 2 entries, including underflow and overflow)
+    std::vector<double> binContents_;
+    std::vector<double> binSumw2_;
+    double numEntries_;
+    double sumWeights_;
+    double sumWeights2_;
+    double sumWeightedValues_;
+    double sumWeightedValues2_;
+  };
+}
+
+#endif
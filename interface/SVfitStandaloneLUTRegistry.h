@@ -0,0 +1,123 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneLUTRegistry_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneLUTRegistry_h
+
+#include <TFile.h>
+#include <TH1.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace svFitStandalone
+{
+  /**
+     \class   LookupTable
+     \brief   read-only, piecewise constant function of one variable, as used for the resolution on Pt and mass of hadronic taus.
+
+     The bins are defined in the same way as by TAxis, the value for x outside the range of the table is taken from the first/last bin.
+     The table either owns its bin edges and contents (copied from a TH1) or refers to memory owned by someone else
+     (e.g. a memory-mapped file read by SVfitStandaloneLUTRegistry).
+  */
+  class LookupTable
+  {
+   public:
+    /// view of numBins + 1 bin edges and numBins bin contents owned by the caller
+    LookupTable(const std::string& name, int numBins, bool isUniform, const double* binEdges, const double* binContents);
+    /// copy of the binning and bin contents (excluding underflow and overflow) of the given histogram
+    LookupTable(const TH1* histogram);
+
+    const std::string& name() const { return name_; }
+    int numBins() const { return numBins_; }
+    bool isUniform() const { return isUniform_; }
+    const double* binEdges() const { return binEdges_; }
+    const double* binContents() const { return binContents_; }
+    /// 64-bit FNV-1a hash of binning and bin contents, identifying the content of the table
+    unsigned long long checksum() const;
+
+    /// same bin as returned by TH1::FindBin (0 = underflow, numBins + 1 = overflow)
+    int findBin(double x) const;
+    /// content of the bin containing x, using the first/last bin for x outside the range of the table
+    double eval(double x) const
+    {
+      int bin = findBin(x);
+      if ( bin < 1        ) bin = 1;
+      if ( bin > numBins_ ) bin = numBins_;
+      return binContents_[bin - 1];
+    }
+
+   private:
+    std::string name_;
+    int numBins_;
+    bool isUniform_;
+    const double* binEdges_;
+    const double* binContents_;
+    std::vector<double> ownedBinEdges_;
+    std::vector<double> ownedBinContents_;
+  };
+}
+
+/**
+   \class   SVfitStandaloneLUTRegistry SVfitStandaloneLUTRegistry.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
+
+   \brief   Process-wide registry of the look-up tables for the resolution on Pt and mass of hadronic taus.
+
+   Each table is read from its ROOT file (svFitVisMassAndPtResolutionPDF.root, svFitGenTauHadMassPDF*.root) only once per process
+   and kept until the end of the process, so that all instances of SVfitStandaloneAlgorithm refer to the same read-only tables.
+   Tables are identified by the full path of the file and the name of the histogram.
+   When a table is requested for a TFile opened by the caller and the registry already contains a table with the same name,
+   the histogram is read again and compared to the table in the registry; the job is aborted in case the contents differ.
+
+   Alternatively, the tables can be taken from a precompiled binary file, written by writePrecompiled (see bin/compileSVfitLUTs.cc).
+   This file is memory-mapped by loadPrecompiled, so that the tables are shared between processes running on the same machine,
+   and the ROOT files are not opened at all for the tables contained in it. The mapping is kept until the end of the process.
+   As the tables are identified by the full path, the precompiled file is only used by jobs that refer to the ROOT files
+   at the same location as compileSVfitLUTs.
+   The registry is thread-safe.
+*/
+
+class SVfitStandaloneLUTRegistry
+{
+ public:
+  static SVfitStandaloneLUTRegistry& instance();
+
+  /// mass distribution of the visible decay products of hadronic tau decays (histogram DQMData/genTauMassAnalyzer/genTauJetMass)
+  const svFitStandalone::LookupTable* visMassAllDMs(const std::string& fileName);
+  const svFitStandalone::LookupTable* visMassAllDMs(TFile* inputFile);
+  /// resolution on mass and Pt of hadronic taus reconstructed in decay mode 0, 1 or 10 (histograms recMinusGenTauMass_recDecayModeEq*, recTauPtDivGenTauPt_recDecayModeEq*)
+  const svFitStandalone::LookupTable* visMassRes(const std::string& fileName, int decayMode);
+  const svFitStandalone::LookupTable* visMassRes(TFile* inputFile, int decayMode);
+  const svFitStandalone::LookupTable* visPtRes(const std::string& fileName, int decayMode);
+  const svFitStandalone::LookupTable* visPtRes(TFile* inputFile, int decayMode);
+
+  /// table for histogram with given name in given file;
+  /// the file is opened only in case the table is neither in the registry nor in a precompiled file
+  const svFitStandalone::LookupTable* get(const std::string& fileName, const std::string& histogramName, TFile* inputFile = 0);
+
+  /// make tables in precompiled file available
+  void loadPrecompiled(const std::string& fileName);
+  /// write all tables in the registry to a precompiled file
+  void writePrecompiled(const std::string& fileName) const;
+
+  /// number of tables in the registry
+  size_t size() const;
+
+ private:
+  SVfitStandaloneLUTRegistry() {}
+  SVfitStandaloneLUTRegistry(const SVfitStandaloneLUTRegistry&);
+  SVfitStandaloneLUTRegistry& operator=(const SVfitStandaloneLUTRegistry&);
+
+  /// the histogram is rebinned by the given factor in case it has at least minNumBinsToRebin bins
+  const svFitStandalone::LookupTable* get(const std::string& fileName, const std::string& histogramName, TFile* inputFile, int rebin, int minNumBinsToRebin);
+
+  /// read histogram from file and convert it into a look-up table (owned by the caller)
+  static svFitStandalone::LookupTable* load(TFile* file, const std::string& fileName, const std::string& histogramName, int rebin, int minNumBinsToRebin);
+
+  static std::string key(const std::string& fileName, const std::string& histogramName);
+
+  std::map<std::string, std::unique_ptr<svFitStandalone::LookupTable> > tables_;
+  mutable std::mutex mutex_;
+};
+
+#endif
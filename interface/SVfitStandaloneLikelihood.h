@@ -2,6 +2,7 @@
 #define TauAnalysis_SVfitStandalone_SVfitStandaloneLikelihood_h
 
 #include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
 
 #include "TMath.h"
 #include "TMatrixD.h"
@@ -204,6 +205,26 @@ namespace svFitStandalone
     int decayMode_;
   };
 
+  /**
+     \class   FittedKinematics SVfitStandaloneLikelihood.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLikelihood.h"
+
+     \brief   Kinematics of the fitted tau leptons for one point in the space of fit/integration parameters.
+
+     The record is filled by the SVfitStandaloneLikelihood class whenever the likelihood is evaluated, so that the
+     four-vectors of the fitted tau leptons do not need to be recomputed when the same point is passed on to the
+     SVfitQuantity classes defined in interface/SVfitStandaloneQuantities.h of this package.
+  */
+  struct FittedKinematics
+  {
+    FittedKinematics()
+      : fittedTauLeptons(2)
+    {}
+    /// four-vectors of the fitted tau leptons in the labframe
+    std::vector<svFitStandalone::LorentzVector> fittedTauLeptons;
+    /// four-vector of the fitted di-tau system in the labframe
+    svFitStandalone::LorentzVector fittedDiTauSystem;
+  };
+
   /**
    \class   SVfitStandaloneLikelihood SVfitStandaloneLikelihood.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLikelihood.h"
        
@@ -245,6 +266,8 @@ namespace svFitStandalone
     SVfitStandaloneLikelihood(const std::vector<svFitStandalone::MeasuredTauLepton>& measuredTauLeptons, const svFitStandalone::Vector& measuredMET, const TMatrixD& covMET, bool verbosity);
     /// default destructor
     ~SVfitStandaloneLikelihood() {}
+    /// set new measurements, keeping the configuration (metPower, addLogM, resolution look-up tables, ...) 
+    void reset(const std::vector<svFitStandalone::MeasuredTauLepton>& measuredTauLeptons, const svFitStandalone::Vector& measuredMET, const TMatrixD& covMET);
     /// static pointer to this (needed for the minuit function calls)
     static const SVfitStandaloneLikelihood* gSVfitStandaloneLikelihood;
 
@@ -260,13 +283,16 @@ namespace svFitStandalone
     /// WARNING: to be used when SVfit is run in "fit" mode only
     void addSinTheta(bool value) { addSinTheta_ = value; }  
     /// marginalize unknown mass of hadronic tau decay products (ATLAS case)
-    void marginalizeVisMass(bool value, const TH1* l1lutVisMass, const TH1* l2lutVisMass);  
+    void marginalizeVisMass(bool value, const LookupTable* l1lutVisMass, const LookupTable* l2lutVisMass);  
     /// take resolution on energy and mass of hadronic tau decays into account
-    void shiftVisMass(bool value, const TH1* l1lutVisMassRes, const TH1* l2lutVisMassRes);
-    void shiftVisPt(bool value, const TH1* l1lutVisPtRes, const TH1* l2lutVisPtRes);
+    void shiftVisMass(bool value, const LookupTable* l1lutVisMassRes, const LookupTable* l2lutVisMassRes);
+    void shiftVisPt(bool value, const LookupTable* l1lutVisPtRes, const LookupTable* l2lutVisPtRes);
     /// add a penalty term in case phi runs outside of interval 
     /// modify the MET term in the nll by an additional power (default is 1.)
     void metPower(double value) { metPower_=value; };    
+    /// return additional power of the MET term and power of the logM term (0 in case the logM term is not added)
+    double metPower() const { return metPower_; }
+    double powerLogM() const { return ( addLogM_ && powerLogM_ > 0. ) ? powerLogM_ : 0.; }
 
     /// flag to force prob to be zero in case of unphysical solutions
     /// (to be used in integration, but not in fit mode, as MINUIT will get confused otherwise)
@@ -275,8 +301,17 @@ namespace svFitStandalone
     /// fit function to be called from outside. Has to be const to be usable by minuit. This function will call the actual 
     /// functions transform and prob internally 
     double prob(const double* x, bool fixToMtest = false, double mtest = -1.) const;
+    /// evaluate prob for a batch of numPoints points. The fit parameters of point iPoint are stored at x[iPoint*2*kMaxFitParams], 
+    /// the mass hypothesis for this point is mtest[iPoint] (only used in case fixToMtest is true). The results are stored in probs.
+    void probBatch(const double* x, unsigned numPoints, double* probs, bool fixToMtest = false, const double* mtest = 0) const;
+    /// return -log(prob) for fit parameters x and fill its derivatives with respect to the fit parameters into grad. 
+    /// The derivatives are computed analytically, for the configuration used in fit mode (no fixed test mass);
+    /// the piecewise constant look-up tables for the resolution on the visible tau decay products do not contribute to the derivatives.
+    double nllAndGradient(const double* x, double* grad) const;
     /// read out potential likelihood errors
     unsigned error() const { return errorCode_; }
+    /// number of evaluations of the likelihood since the last call to reset
+    unsigned numObjFunctionCalls() const { return idxObjFunctionCall_; }
 
     /// return vector of measured MET
     const svFitStandalone::Vector& measuredMET() const { return measuredMET_; }
@@ -286,6 +321,9 @@ namespace svFitStandalone
     /// It needs to be factored out though as transform has to be const to be usable by minuit and therefore is not allowed 
     /// change the class members.  
     void results(std::vector<svFitStandalone::LorentzVector>& fittedTauLeptons, const double* x) const;
+    /// return kinematics of the fitted tau leptons for fit parameters x. In case x is the point for which the likelihood
+    /// has been evaluated last, the four-vectors built by transform are returned without recomputing them.
+    const FittedKinematics& kinematics(const double* x) const;
 
    protected:
     /// transformation from x to xPrime, x are the actual fit parameters, xPrime are the transformed parameters that go into 
@@ -314,6 +352,11 @@ namespace svFitStandalone
     /// monitor the number of function calls
     mutable unsigned int idxObjFunctionCall_;
 
+    /// kinematics of the fitted tau leptons for the point xKinematics_ last passed to transform or kinematics
+    mutable FittedKinematics kinematics_;
+    mutable double xKinematics_[2*kMaxFitParams];
+    mutable bool isValidKinematics_;
+
     /// measured tau leptons
     std::vector<svFitStandalone::MeasuredTauLepton> measuredTauLeptons_;
     /// measured MET
@@ -331,14 +374,14 @@ namespace svFitStandalone
 
     /// resolution on transverse momentum and mass of hadronic taus
     bool marginalizeVisMass_;
-    const TH1* l1lutVisMass_;
-    const TH1* l2lutVisMass_;
+    const LookupTable* l1lutVisMass_;
+    const LookupTable* l2lutVisMass_;
     bool shiftVisMass_;
-    const TH1* l1lutVisMassRes_;
-    const TH1* l2lutVisMassRes_;
+    const LookupTable* l1lutVisMassRes_;
+    const LookupTable* l2lutVisMassRes_;
     bool shiftVisPt_;
-    const TH1* l1lutVisPtRes_;
-    const TH1* l2lutVisPtRes_;
+    const LookupTable* l1lutVisPtRes_;
+    const LookupTable* l2lutVisPtRes_;
   };
 }
 
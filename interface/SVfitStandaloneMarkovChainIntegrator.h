@@ -19,6 +19,8 @@
  *
  */
 
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStatistics.h"
+
 #include <Math/Functor.h>
 #include <TRandom3.h>
 #include <TFile.h>
@@ -28,6 +30,43 @@
 #include <string>
 #include <iostream>
 
+/** \class SVfitStandaloneMarkovChainCallBackFunction
+ *
+ * "Call-back" function which, in addition to the current position q of the Markov Chain,
+ * is told whether the chain moved to a new position in the last "stochastic move".
+ *
+ * Rejected moves leave the Markov Chain at the same position, so a call-back function
+ * may cache whatever it computed for the current position and account for repeated
+ * visits of the same position by a weight. The Flush function is called after
+ * the last "stochastic move" of each Markov Chain.
+ *
+ * The default implementations fall back to the plain ROOT::Math::Functor interface,
+ * i.e. to an evaluation of operator(x) in every iteration.
+ *
+ */
+
+class SVfitStandaloneMarkovChainCallBackFunction : public ROOT::Math::Functor
+{
+ public:
+  virtual void EvalCallBack(const double* x, bool isNewState) const { (*this)(x); }
+  virtual void Flush() const {}
+};
+
+/** \class SVfitStandaloneMarkovChainSampleCallBackFunction
+ *
+ * "Call-back" function which is told about every "stochastic move" of the sampling stage: 
+ * index of the Markov Chain, whether the move has been accepted, probability P(q) 
+ * and current position q of the Markov Chain (the same argument x as passed to the other call-back functions).
+ *
+ */
+
+class SVfitStandaloneMarkovChainSampleCallBackFunction
+{
+ public:
+  virtual ~SVfitStandaloneMarkovChainSampleCallBackFunction() {}
+  virtual void EvalSample(unsigned chain, bool isAccepted, double prob, const double* x) = 0;
+};
+
 class SVfitStandaloneMarkovChainIntegrator
 {
  public:
@@ -38,6 +77,18 @@ class SVfitStandaloneMarkovChainIntegrator
 //    in order to start path of chain transitions from non-random point
   void initializeStartPosition_and_Momentum(const std::vector<double>&);
 
+//--- set seed of random number generator (default is 12345);
+//    the generator is reset to this seed at the beginning of each integration
+  void setSeed(unsigned seed) { seed_ = seed; }
+
+//--- change number of "stochastic moves" performed per integration
+//    (same meaning as the corresponding parameters given to the constructor)
+  void setNumIterations(unsigned, unsigned, unsigned, unsigned);
+
+//--- change speed parameter with which the temperature decreases during the second phase of simulated annealing
+//    (same meaning as the corresponding parameter given to the constructor)
+  void setSimAnnealingAlpha(double);
+
 //--- set function to evaluate the probability P(q)
 //    at every point q in the N-dimensional space in which the integration is performed.
 //   (eq. (11) in [2])
@@ -57,6 +108,18 @@ class SVfitStandaloneMarkovChainIntegrator
 //    represent the current position q of the Markov Chain in the
 //    N-dimensional space in which the integration is performed.
   void registerCallBackFunction(const ROOT::Math::Functor&);
+//    Call-back functions of type SVfitStandaloneMarkovChainCallBackFunction
+//    are additionally told whether the last "stochastic move" has been accepted,
+//    so that they can skip the re-evaluation of observables in case the Markov Chain did not move.
+  void registerCallBackFunction(const SVfitStandaloneMarkovChainCallBackFunction&);
+
+//--- set function which is told about every "stochastic move" of the sampling stage,
+//    e.g. for writing the samples to a file (0 = none)
+  void setSampleCallBackFunction(SVfitStandaloneMarkovChainSampleCallBackFunction* function) { sampleCallBackFunction_ = function; }
+
+//--- set statistics to which the number of start-position tries, the accepted and rejected moves 
+//    and the wall time per phase of each integration are added (0 = none)
+  void setStatistics(svFitStandalone::Statistics* statistics) { statistics_ = statistics; }
 
   void integrate(const std::vector<double>&, const std::vector<double>&, double&, double&, int&);
 
@@ -67,6 +130,7 @@ class SVfitStandaloneMarkovChainIntegrator
   void initializeStartPosition_and_Momentum();
 
   void makeStochasticMove(unsigned, bool&, bool&);
+  svFitStandalone::Statistics::Phase burninPhase(unsigned) const;
   void makeDynamicMoves(const std::vector<double>&);
   
   void sampleSphericallyRandom();
@@ -86,6 +150,10 @@ class SVfitStandaloneMarkovChainIntegrator
   const ROOT::Math::Functor* startPosition_and_MomentumFinder_;
 
   std::vector<const ROOT::Math::Functor*> callBackFunctions_;
+  std::vector<const SVfitStandaloneMarkovChainCallBackFunction*> stateCallBackFunctions_;
+  SVfitStandaloneMarkovChainSampleCallBackFunction* sampleCallBackFunction_;
+
+  svFitStandalone::Statistics* statistics_;
     
   // parameter defining whether to run integration in "Metropolis" or "Hybrid" mode
   int moveMode_;
@@ -149,6 +217,7 @@ class SVfitStandaloneMarkovChainIntegrator
 
   // random number generator
   TRandom3 rnd_;
+  unsigned seed_;
 
   // internal variables storing current state of Markov Chain
   vdouble p_;
@@ -0,0 +1,111 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneMinimizer_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneMinimizer_h
+
+/** \class SVfitStandaloneMinimizer
+ *
+ * Minimization of smooth functions of few parameters by the quasi-Newton (BFGS) method,
+ * as lightweight alternative to Minuit2 for the "fit" mode of SVfitStandaloneAlgorithm.
+ *
+ * Bounded parameters are transformed to unbounded internal parameters
+ * in the same way as in Minuit, i.e. x = lower + (upper - lower)*(sin(u) + 1)/2.
+ * The uncertainties on the parameters are obtained from the inverse of the Hessian matrix at the minimum,
+ * which is computed by finite differences of the gradient.
+ * The derivatives of the function are taken from the IMultiGradFunction interface if available,
+ * otherwise they are computed numerically.
+ *
+ * All state is kept in arrays of fixed size, so that no memory is allocated during the minimization.
+ *
+ * The status codes follow the convention of ROOT::Math::Minimizer (Minuit2):
+ *   0: Valid solution
+ *   1: Covariance matrix was made positive definite
+ *   2: Hesse matrix is invalid (the uncertainties on the parameters are set to zero)
+ *   4: Reached maximum number of function calls before reaching convergence
+ *   5: Any other failure
+ *
+ */
+
+#include "Math/IFunction.h"
+
+class SVfitStandaloneMinimizer
+{
+ public:
+  enum { kMaxDim = 10 };
+
+  SVfitStandaloneMinimizer();
+  ~SVfitStandaloneMinimizer() {}
+
+  /// remove all parameters
+  void clear();
+  /// maximum number of function calls after which to stop the minimization
+  void setMaxFunctionCalls(unsigned maxFunctionCalls) { maxFunctionCalls_ = maxFunctionCalls; }
+  /// change in function value corresponding to one standard deviation (0.5 for -log(likelihood))
+  void setErrorDef(double errorDef) { errorDef_ = errorDef; }
+
+  /// define parameters
+  void setVariable(unsigned idx, double value, double step);
+  void setLimitedVariable(unsigned idx, double value, double step, double lower, double upper);
+  void setFixedVariable(unsigned idx, double value);
+
+  /// run the minimization, return true in case of success
+  bool minimize(const ROOT::Math::IMultiGenFunction&);
+
+  /// status of last minimization
+  int status() const { return status_; }
+  /// parameter values and uncertainties at the minimum
+  const double* X() const { return x_; }
+  const double* Errors() const { return errors_; }
+  /// function value at the minimum
+  double minValue() const { return fMin_; }
+  /// estimated distance to minimum
+  double edm() const { return edm_; }
+  /// number of function calls performed
+  unsigned nCalls() const { return numCalls_; }
+
+ protected:
+  enum { kUndefined, kFree, kLimited, kFixed };
+
+  /// transformation between internal and external parameters
+  double int2ext(unsigned, double) const;
+  double ext2int(unsigned, double) const;
+  double dInt2Ext(unsigned, double) const;
+  double int2extError(unsigned, double, double) const;
+
+  /// evaluate function and gradient with respect to the internal parameters
+  double eval(const double*, double*);
+
+  /// compute covariance matrix of internal parameters;
+  /// returns 0 in case the Hessian matrix is positive definite, 1 in case it has been made positive definite
+  /// and 2 in case it could not be inverted (the covariance matrix is not computed in the latter case)
+  int compCovariance(const double*, double*);
+
+  const ROOT::Math::IMultiGenFunction* function_;
+  const ROOT::Math::IMultiGradFunction* gradFunction_;
+
+  unsigned numDimensions_;
+  int type_[kMaxDim];
+  double value_[kMaxDim];
+  double step_[kMaxDim];
+  double lower_[kMaxDim];
+  double upper_[kMaxDim];
+
+  // free parameters
+  unsigned numFree_;
+  unsigned idxFree_[kMaxDim];
+
+  unsigned maxFunctionCalls_;
+  double errorDef_;
+
+  // result of minimization
+  int status_;
+  double x_[kMaxDim];
+  double errors_[kMaxDim];
+  double fMin_;
+  double edm_;
+  unsigned numCalls_;
+
+  // temporary variables
+  double xExt_[kMaxDim];
+  double gradExt_[kMaxDim];
+};
+
+#endif
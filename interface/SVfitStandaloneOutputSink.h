@@ -0,0 +1,165 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneOutputSink_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneOutputSink_h
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneFlatHistogram.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace svFitStandalone
+{
+  /**
+     \struct  OutputGraph
+     \brief   likelihood curve (e.g. likelihood as function of the di-tau mass in VEGAS integration mode)
+  */
+  struct OutputGraph
+  {
+    std::string name;
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> xErr;
+    std::vector<float> yErr;
+  };
+
+  /**
+     \struct  OutputHistogram
+     \brief   histogram of a quantity (e.g. posterior distribution of the di-tau mass in Markov Chain integration mode);
+              binContents and binErrors include underflow and overflow (numBins + 2 entries), binEdges has numBins + 1 entries
+  */
+  struct OutputHistogram
+  {
+    std::string name;
+    std::vector<float> binEdges;
+    std::vector<float> binContents;
+    std::vector<float> binErrors;
+  };
+
+  /**
+     \struct  OutputEvent
+     \brief   graphs and histograms of one event, as stored in SVfitStandaloneOutputSink
+  */
+  struct OutputEvent
+  {
+    OutputEvent() : run(0), lumi(0), event(0) {}
+    void clear();
+    void addGraph(const std::string& name, size_t numPoints, const double* x, const double* y, const double* xErr, const double* yErr);
+    void addHistogram(const FlatHistogram& histogram);
+
+    unsigned long long run;
+    unsigned long long lumi;
+    unsigned long long event;
+    std::vector<OutputGraph> graphs;
+    std::vector<OutputHistogram> histograms;
+  };
+}
+
+/**
+   \class   SVfitStandaloneOutputSink SVfitStandaloneOutputSink.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneOutputSink.h"
+
+   \brief   Collects the likelihood curves and histograms of many events in one file, as an alternative to writing one ROOT file per event.
+
+   Each event is encoded as a block of 4-byte words (graphs and histograms, values stored as float) and appended to the data file
+   fileName; an index entry (run, lumi-section, event number, offset and size of the block) is appended to fileName + ".idx".
+   Only the non-empty bins of histograms are stored. The bin edges are stored once for each histogram name and referred to
+   by subsequent events, until a histogram of the same name with a different binning is written.
+   The encoding is done by the thread calling write, the file I/O by a separate thread, so that writing does not block
+   the reconstruction unless more than maxBufferedBytes are waiting to be written. The sink may be shared by several threads;
+   to avoid contention, use one sink (file) per worker. The files are recreated when the sink is constructed.
+   In case writing fails (e.g. because the disk is full), an error message is printed and all subsequent events are discarded,
+   so that the index refers to complete events only.
+*/
+
+class SVfitStandaloneOutputSink
+{
+ public:
+  SVfitStandaloneOutputSink(const std::string& fileName, size_t maxBufferedBytes = 64*1024*1024);
+  ~SVfitStandaloneOutputSink();
+
+  /// queue event for writing
+  void write(const svFitStandalone::OutputEvent& event);
+  /// wait until all queued events have been written and flush the files
+  void flush();
+
+  /// number of events queued so far
+  unsigned long long numEvents() const { return numEvents_; }
+  /// true in case writing to the files has failed
+  bool failed() const { std::lock_guard<std::mutex> lock(mutex_); return isFailed_; }
+
+ protected:
+  struct Block
+  {
+    unsigned long long run;
+    unsigned long long lumi;
+    unsigned long long event;
+    std::vector<char> data;
+  };
+
+  void writeBlocks();
+  /// flush the files, return false in case of write errors
+  bool flushFiles();
+  void reportFailure() const;
+
+  std::string fileName_;
+  FILE* dataFile_;
+  FILE* indexFile_;
+  unsigned long long dataFileSize_;
+  unsigned long long numEvents_;
+  size_t maxBufferedBytes_;
+
+  /// size of the data file once all queued events have been written, protected by mutex_
+  unsigned long long queuedDataFileSize_;
+  /// last binning written for each histogram name and its position in the data file, protected by mutex_
+  std::map<std::string, std::pair<std::vector<float>, unsigned long long> > binnings_;
+
+  /// events waiting to be written, protected by mutex_
+  std::deque<Block> queue_;
+  size_t bufferedBytes_;
+  bool isWriting_;
+  bool isStopped_;
+  bool isFailed_;
+  mutable std::mutex mutex_;
+  std::condition_variable queueChanged_;
+  std::thread writer_;
+};
+
+/**
+   \class   SVfitStandaloneOutputReader SVfitStandaloneOutputSink.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneOutputSink.h"
+
+   \brief   Read events from a file written by SVfitStandaloneOutputSink, without ROOT. The files are memory-mapped.
+*/
+
+class SVfitStandaloneOutputReader
+{
+ public:
+  SVfitStandaloneOutputReader(const std::string& fileName);
+  ~SVfitStandaloneOutputReader();
+
+  /// number of events stored in the file
+  size_t numEvents() const { return numEvents_; }
+  /// index of event with given run, lumi-section and event number (-1 if not found)
+  long find(unsigned long long run, unsigned long long lumi, unsigned long long event) const;
+  /// decode event with given index
+  void read(size_t idx, svFitStandalone::OutputEvent& event) const;
+
+ protected:
+  const char* mapFile(const std::string&, size_t&);
+
+  std::string fileName_;
+  const char* data_;
+  size_t dataSize_;
+  const char* index_;
+  size_t indexSize_;
+  size_t numEvents_;
+
+  /// lookup table for find, filled on first call
+  mutable std::map<std::tuple<unsigned long long, unsigned long long, unsigned long long>, size_t> eventIndex_;
+};
+
+#endif
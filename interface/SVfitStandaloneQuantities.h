@@ -3,13 +3,20 @@
 
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLikelihood.h"
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneMarkovChainIntegrator.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneVEGASIntegrator.h"
 #include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStreamingQuantiles.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneFlatHistogram.h"
 
 #include <TMath.h>
 #include <TArrayF.h>
 #include <TString.h>
 #include <TH1.h>
 #include <TBenchmark.h>
+#include "Math/IFunction.h"
+
+#include <algorithm>
+#include <limits>
 
 using svFitStandalone::Vector;
 using svFitStandalone::LorentzVector;
@@ -30,6 +37,8 @@ using svFitStandalone::MeasuredTauLepton;
 
 namespace svFitStandalone
 {
+  struct OutputEvent;
+
   TH1* makeHistogram(const std::string&, double, double, double);
   TH1* compHistogramDensity(const TH1*);
   double extractValue(const TH1*);
@@ -49,18 +58,77 @@ namespace svFitStandalone
       return nll;
     }
   };
+  // for "fit" (MINUIT) mode, with analytic derivatives of -log(likelihood)
+  class ObjectiveFunctionAdapterMINUITGradient : public ROOT::Math::IMultiGradFunction
+  {
+  public:
+    ObjectiveFunctionAdapterMINUITGradient(unsigned int nDim) 
+      : nDim_(nDim), 
+        isValid_(false) 
+    {}
+    ROOT::Math::IMultiGradFunction* Clone() const { return new ObjectiveFunctionAdapterMINUITGradient(*this); }
+    unsigned int NDim() const { return nDim_; }
+    void Gradient(const double* x, double* grad) const
+    {
+      update(x);
+      std::copy(grad_, grad_ + nDim_, grad);
+    }
+    void FdF(const double* x, double& f, double* df) const
+    {
+      update(x);
+      f = nll_;
+      std::copy(grad_, grad_ + nDim_, df);
+    }
+  private:
+    double DoEval(const double* x) const // NOTE: return value = -log(likelihood)
+    {
+      double prob = SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood->prob(x);
+      double nll;
+      if ( prob > 0. ) nll = -TMath::Log(prob);
+      else nll = std::numeric_limits<float>::max();
+      return nll;
+    }
+    double DoDerivative(const double* x, unsigned int icoord) const
+    {
+      update(x);
+      return grad_[icoord];
+    }
+    /// compute -log(likelihood) and its derivatives, unless already computed for the same point 
+    /// (MINUIT requests the derivatives one coordinate at a time via DoDerivative)
+    void update(const double* x) const
+    {
+      if ( isValid_ && std::equal(x, x + nDim_, x_) ) return;
+      nll_ = SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood->nllAndGradient(x, grad_);
+      std::copy(x, x + nDim_, x_);
+      isValid_ = true;
+    }
+    unsigned int nDim_;
+    mutable double x_[2*kMaxFitParams];
+    mutable double nll_;
+    mutable double grad_[2*kMaxFitParams];
+    mutable bool isValid_;
+  };
   // for VEGAS integration
   void map_xVEGAS(const double*, bool, bool, bool, bool, bool, double, double, double*);
-  class ObjectiveFunctionAdapterVEGAS
+  class ObjectiveFunctionAdapterVEGAS : public SVfitStandaloneVEGASIntegrand
   {
   public:
+    ObjectiveFunctionAdapterVEGAS() : nll_(0), nDim_(0), integrateOverMass_(false) {}
     double Eval(const double* x) const // NOTE: return value = likelihood, **not** -log(likelihood)
     {
-      map_xVEGAS(x, l1isLep_, l2isLep_, marginalizeVisMass_, shiftVisMass_, shiftVisPt_, mvis_, mtest_, x_mapped_);
-      double prob = SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood->prob(x_mapped_, true, mtest_);
+      double mtest = ( integrateOverMass_ ) ? TMath::Exp(x[nDim_ - 1]) : mtest_;
+      map_xVEGAS(x, l1isLep_, l2isLep_, marginalizeVisMass_, shiftVisMass_, shiftVisPt_, mvis_, mtest, x_mapped_);
+      double prob = likelihood()->prob(x_mapped_, true, mtest);
       if ( TMath::IsNaN(prob) ) prob = 0.;
+      if ( integrateOverMass_ ) prob *= mtest; // Jacobi factor for integration over log(mtest)
       return prob;
     }
+    /// evaluate likelihood for a batch of points (used by SVfitStandaloneVEGASIntegrator)
+    void EvalBatch(const double* x, unsigned numPoints, double* f) const;
+    unsigned int NDim() const { return nDim_; }
+    void SetNDim(int nDim) { nDim_ = nDim; }
+    /// likelihood to be integrated (default is SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood)
+    void SetLikelihood(const SVfitStandaloneLikelihood* nll) { nll_ = nll; }
     void SetL1isLep(bool l1isLep) { l1isLep_ = l1isLep; }
     void SetL2isLep(bool l2isLep) { l2isLep_ = l2isLep; }
     void SetMarginalizeVisMass(bool marginalizeVisMass) { marginalizeVisMass_ = marginalizeVisMass; }
@@ -68,6 +136,8 @@ namespace svFitStandalone
     void SetShiftVisPt(bool shiftVisPt) { shiftVisPt_ = shiftVisPt; }
     void SetMvis(double mvis) { mvis_ = mvis; }
     void SetMtest(double mtest) { mtest_ = mtest; }
+    /// treat log(mtest) as additional (last) integration variable instead of fixing mtest to the value given by SetMtest
+    void SetIntegrateOverMass(bool integrateOverMass) { integrateOverMass_ = integrateOverMass; }
   private:
     mutable double x_mapped_[10];
     bool l1isLep_;
@@ -77,6 +147,31 @@ namespace svFitStandalone
     bool shiftVisPt_;
     double mvis_;  // mass of visible tau decay products
     double mtest_; // current mass hypothesis
+    const SVfitStandaloneLikelihood* likelihood() const { return ( nll_ ) ? nll_ : SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood; }
+    const SVfitStandaloneLikelihood* nll_;
+    unsigned nDim_;
+    mutable std::vector<double> xBatch_mapped_; // index = point*2*kMaxFitParams + parameter
+    mutable std::vector<double> mtestBatch_;
+    bool integrateOverMass_;
+  };
+  // for filling the di-tau mass distribution in case the mass is integrated over in VEGAS mode
+  class MassHistogramAdapterVEGAS : public SVfitStandaloneVEGASCallBackFunction
+  {
+  public:
+    MassHistogramAdapterVEGAS() : histogram_(0), nDim_(0) {}
+    void EvalCallBack(const double* x, unsigned numPoints, const double* weights) const
+    {
+      if ( !histogram_ ) return;
+      for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+        histogram_->Fill(TMath::Exp(x[iPoint*nDim_ + nDim_ - 1]), weights[iPoint]);
+      }
+    }
+    void SetNDim(int nDim) { nDim_ = nDim; }
+    /// histogram to be filled, set to zero to disable filling
+    void SetHistogram(TH1* histogram) { histogram_ = histogram; }
+  private:
+    TH1* histogram_;
+    unsigned nDim_;
   };
   // for Markov Chain integration
   void map_xMarkovChain(const double*, bool, bool, bool, bool, bool, double*);
@@ -113,12 +208,32 @@ namespace svFitStandalone
     SVfitQuantity();
     virtual ~SVfitQuantity();
 
+    /// create TH1 defining name and binning of the histogram (owned by the caller)
     virtual TH1* CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const = 0;
+    /// set name and binning of the histogram used to accumulate the distribution of the quantity;
+    /// the default implementation takes them from the TH1 returned by CreateHistogram,
+    /// quantities overriding it avoid the allocation of a TH1 for each event
+    virtual void SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
     virtual double FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const = 0;
 
     void SetHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET);
     void Reset();
     void WriteHistograms() const;
+    /// add histogram to event written by SVfitStandaloneOutputSink
+    void WriteHistograms(svFitStandalone::OutputEvent& event) const;
+    /// distribution of the quantity as TH1D, for code that used to access the TH1 histogram_ member;
+    /// the histogram is owned by the caller (0 in case the streaming estimator is used)
+    TH1* GetHistogram() const;
+
+    /// track the distribution of the quantity by streaming quantile estimators instead of a histogram (default is false);
+    /// in this case the histogram is not filled and WriteHistograms does nothing
+    void SetUseStreamingEstimator(bool value) { useStreamingEstimator_ = value; }
+    bool UseStreamingEstimator() const { return useStreamingEstimator_; }
+    /// add value of quantity with given weight to histogram or streaming estimator
+    void Fill(double value, double weight = 1.) const;
+    /// add value of quantity numEntries times with given weight, e.g. for a Markov Chain staying at the same position;
+    /// in contrast to Fill(value, numEntries*weight), the bin errors of the histogram are the same as for numEntries separate entries
+    void FillRepeated(double value, double numEntries, double weight = 1.) const;
 
     double Eval(
         std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons,
@@ -126,47 +241,105 @@ namespace svFitStandalone
         svFitStandalone::Vector const& measuredMET
     ) const;
 
+    /// evaluate quantity for the kinematics record produced by the likelihood (default: FitFunction of the fitted tau leptons)
+    virtual double EvalKinematics(
+        svFitStandalone::FittedKinematics const& kinematics,
+        std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons,
+        svFitStandalone::Vector const& measuredMET
+    ) const;
+    /// evaluate quantity for a batch of numSamples buffered kinematics records
+    virtual void EvalBatch(
+        svFitStandalone::FittedKinematics const* kinematics, size_t numSamples,
+        std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons,
+        svFitStandalone::Vector const& measuredMET,
+        double* values
+    ) const;
+
+    /// summary of the histogram (value, uncertainty, Lmax, quantiles), computed once after the histogram has been filled
+    const svFitStandalone::HistogramSummary& ExtractSummary() const;
     double ExtractValue() const;
     double ExtractUncertainty() const;
     double ExtractLmax() const;
 
     bool isValidSolution() const;
 
-    mutable TH1* histogram_ = nullptr;
+    /// needs to be called whenever the content of the histogram changes
+    void InvalidateSummary() const { isValidSummary_ = false; }
+
+    /// distribution of the quantity, allocated once and reset in place for each event
+    mutable svFitStandalone::FlatHistogram histogram_;
+
+   protected:
+    /// create TH1 with name and binning set by SetupHistogram, for quantities that override SetupHistogram
+    TH1* CreateHistogramFromSetup(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+
+    mutable svFitStandalone::HistogramSummary summary_;
+    mutable bool isValidSummary_ = false;
+
+    bool useStreamingEstimator_ = false;
+    mutable svFitStandalone::StreamingQuantileEstimator estimator_;
   };
 
   class HiggsPtSVfitQuantity : public SVfitQuantity
   {
    public:
     virtual TH1* CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual void SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
     virtual double FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual double EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
   };
   class HiggsEtaSVfitQuantity : public SVfitQuantity
   {
    public:
     virtual TH1* CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual void SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
     virtual double FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual double EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
   };
   class HiggsPhiSVfitQuantity : public SVfitQuantity
   {
    public:
     virtual TH1* CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual void SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
     virtual double FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual double EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
   };
   class HiggsMassSVfitQuantity : public SVfitQuantity
   {
    public:
     virtual TH1* CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual void SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
     virtual double FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual double EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
   };
   class TransverseMassSVfitQuantity : public SVfitQuantity
   {
    public:
     virtual TH1* CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual void SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
     virtual double FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+    virtual double EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const;
+  };
+
+  /**
+     \struct  PosteriorConfiguration
+     \brief   terms of the likelihood that can be modified when reweighting the samples kept by MCQuantitiesAdapter:
+              additional power of the MET term, power of the logM term (0 = no logM term), measured MET and its covariance matrix
+  */
+  struct PosteriorConfiguration
+  {
+    PosteriorConfiguration() 
+      : metPower(1.), 
+        powerLogM(0.), 
+        covMET(2,2) 
+    {}
+    double metPower;
+    double powerLogM;
+    svFitStandalone::Vector measuredMET;
+    TMatrixD covMET;
   };
 
-  class MCQuantitiesAdapter : public ROOT::Math::Functor
+  class MCQuantitiesAdapter : public SVfitStandaloneMarkovChainCallBackFunction
   {
    public:
     MCQuantitiesAdapter(std::vector<SVfitQuantity*> const& quantities = std::vector<SVfitQuantity*>());
@@ -176,6 +349,10 @@ namespace svFitStandalone
     void SetHistograms(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET);
     void Reset();
     void WriteHistograms() const;
+    void WriteHistograms(svFitStandalone::OutputEvent& event) const;
+
+    /// use streaming quantile estimators instead of histograms for all quantities (needs to be called before SetHistograms)
+    void SetUseStreamingEstimators(bool value);
 
     inline void SetL1isLep(bool l1isLep) { l1isLep_ = l1isLep; }
     inline void SetL2isLep(bool l2isLep) { l2isLep_ = l2isLep; }
@@ -197,10 +374,38 @@ namespace svFitStandalone
 
     bool isValidSolution() const;
 
+    /// keep the positions visited by the Markov Chain (values of all quantities, difference between measured and fitted MET,
+    /// di-tau mass and number of iterations spent at each position), so that the distributions of the quantities can be recomputed 
+    /// for a modified configuration of the MET and logM terms of the likelihood by Reweight (default is false)
+    void SetKeepSamples(bool value) { keepSamples_ = value; }
+    /// configuration of the likelihood with which the Markov Chain is run
+    void SetPosteriorConfiguration(const PosteriorConfiguration& config) { posteriorConfiguration_ = config; }
+    const PosteriorConfiguration& GetPosteriorConfiguration() const { return posteriorConfiguration_; }
+    size_t GetNSamples() const { return sampleWeights_.size(); }
+    /// refill the histograms with the kept samples, weighted by the ratio of the likelihood for the given configuration 
+    /// to the likelihood with which the Markov Chain has been run. In case the effective number of samples after reweighting 
+    /// is below minRelEffectiveSampleSize times the number of iterations, the histograms are left unchanged and false is returned.
+    /// The original distributions are restored by calling Reweight with the configuration given to SetPosteriorConfiguration.
+    bool Reweight(const PosteriorConfiguration& config, double minRelEffectiveSampleSize = 0.1);
+
+    /// evaluate quantities only in case the Markov Chain moved to a new position,
+    /// otherwise increase the weight with which the cached values get filled into the histograms
+    virtual void EvalCallBack(const double* x, bool isNewState) const;
+    virtual void Flush() const;
+
    protected:
     std::vector<SVfitQuantity*> quantities_;
 
-    mutable std::vector<svFitStandalone::LorentzVector> fittedTauLeptons_;
+    /// evaluate all quantities for the buffered positions of the Markov Chain and fill the histograms
+    void ProcessBuffer() const;
+
+    /// kinematics of the positions visited by the Markov Chain, buffered for the batch evaluation of the quantities,
+    /// and number of iterations the chain stayed at each position. The last buffered entry is the current position.
+    mutable std::vector<svFitStandalone::FittedKinematics> bufferedKinematics_;
+    mutable std::vector<double> bufferedWeights_;
+    mutable size_t numBuffered_;
+    mutable std::vector<double> values_;
+
     mutable double x_mapped_[10];
     bool l1isLep_;
     bool l2isLep_;
@@ -212,6 +417,17 @@ namespace svFitStandalone
     std::vector<svFitStandalone::LorentzVector> measuredTauLeptons_;
     svFitStandalone::Vector measuredMET_;
 
+    /// samples kept for reweighting: values of the quantities (index = sample*numQuantities + quantity), number of iterations,
+    /// difference between measured and fitted MET and fitted di-tau mass
+    bool keepSamples_;
+    PosteriorConfiguration posteriorConfiguration_;
+    mutable std::vector<double> sampleValues_;
+    mutable std::vector<double> sampleWeights_;
+    mutable std::vector<double> sampleDMETx_;
+    mutable std::vector<double> sampleDMETy_;
+    mutable std::vector<double> sampleMass_;
+    std::vector<double> reweightedWeights_;
+
    private:
     virtual double DoEval(const double* x) const;
   };
@@ -0,0 +1,117 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneResultCache_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneResultCache_h
+
+#include <string>
+#include <cstdio>
+#include <unordered_map>
+
+namespace svFitStandalone
+{
+  /**
+     \struct  CachedResult
+     \brief   results of SVfitStandaloneAlgorithm for one event, as stored in SVfitStandaloneResultCache
+  */
+  struct CachedResult
+  {
+    double mass;
+    double massUncert;
+    double massLmax;
+    double transverseMass;
+    double transverseMassUncert;
+    double transverseMassLmax;
+    int fitStatus;
+    unsigned int nllStatus;
+    int isValidSolution;
+  };
+
+  /**
+     \class   ResultCacheKey SVfitStandaloneResultCache.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneResultCache.h"
+     \brief   inputs and configuration of SVfitStandaloneAlgorithm in serialized form, used as key of SVfitStandaloneResultCache.
+
+     Keys are compared by their complete content; the 64-bit FNV-1a hash of the content is computed while the key is built
+     and used to look up the key in hash tables only.
+  */
+  class ResultCacheKey
+  {
+   public:
+    ResultCacheKey() : value_(14695981039346656037ULL) {}
+
+    void add(const void* data, size_t size);
+    void add(double value);
+    void add(int value) { add(&value, sizeof(value)); }
+    void add(unsigned long long value) { add(&value, sizeof(value)); }
+    void add(const std::string& value) { add(value.data(), value.size()); add((int)value.size()); }
+
+    /// hash of the content
+    unsigned long long value() const { return value_; }
+    /// serialized inputs and configuration
+    const std::string& data() const { return data_; }
+
+    bool operator==(const ResultCacheKey& other) const { return value_ == other.value_ && data_ == other.data_; }
+
+    struct Hash
+    {
+      size_t operator()(const ResultCacheKey& key) const { return key.value(); }
+    };
+
+   private:
+    std::string data_;
+    unsigned long long value_;
+  };
+}
+
+/**
+   \class   SVfitStandaloneResultCache SVfitStandaloneResultCache.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneResultCache.h"
+
+   \brief   Cache of SVfit results, keyed by the rounded measured quantities, the decay types and modes of the tau leptons
+            and the configuration of the algorithm.
+
+   As SVfitStandaloneAlgorithm rounds all its inputs to 3 significant digits, the results for events with identical rounded inputs
+   and identical configuration are the same. If a file name is given, the cache is read from this file when it is constructed, and
+   each new result is appended to the file, so that the results are reused when the same events are processed again in a later job.
+   If the file name is empty, the cache is kept in memory only. The file is a binary file, consisting of a header, which identifies
+   the format, and a sequence of records (size of key, key, CachedResult). The complete key is stored with each result and
+   compared when a result is retrieved, so that two events whose keys have the same hash never share a result.
+   A record which has been only partially written (e.g. because the job that wrote it was killed) is ignored and overwritten;
+   an empty file or a file with incomplete header (left behind by a job killed right after creating the file) is initialized again.
+
+   The cache is used by SVfitStandaloneBatchAlgorithm, which also uses it to process events that appear more than once within
+   the same batch only once.
+*/
+
+class SVfitStandaloneResultCache
+{
+ public:
+  SVfitStandaloneResultCache(const std::string& fileName = "");
+  ~SVfitStandaloneResultCache();
+
+  /// retrieve result for given key, returns false if no result is stored for this key
+  bool find(const svFitStandalone::ResultCacheKey& key, svFitStandalone::CachedResult& result) const;
+  /// store result for given key (and append it to the file)
+  void insert(const svFitStandalone::ResultCacheKey& key, const svFitStandalone::CachedResult& result);
+  /// write all results stored so far to the file
+  void flush();
+
+  /// number of results stored in the cache
+  size_t size() const { return results_.size(); }
+  /// number of calls to find that did/did not return a result
+  unsigned long numHits() const { return numHits_; }
+  unsigned long numMisses() const { return numMisses_; }
+
+ protected:
+  /// read records from file, returns the number of bytes occupied by the header and complete records
+  /// (-1 in case the header is incomplete)
+  long readFile();
+  /// write header to empty file
+  void writeHeader();
+
+  std::string fileName_;
+  FILE* file_;
+
+  std::unordered_map<svFitStandalone::ResultCacheKey, svFitStandalone::CachedResult, svFitStandalone::ResultCacheKey::Hash> results_;
+
+  mutable unsigned long numHits_;
+  mutable unsigned long numMisses_;
+};
+
+#endif
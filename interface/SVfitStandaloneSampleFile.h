@@ -0,0 +1,151 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneSampleFile_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneSampleFile_h
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneMarkovChainIntegrator.h"
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+namespace svFitStandalone
+{
+  /**
+     \struct  SampleRecord
+     \brief   header of one sample in a SVfitStandaloneSampleFile, followed by numDimensions doubles holding the position x of the Markov Chain.
+              Consecutive iterations of the same chain which stay at the same position (rejected moves) are stored as a single sample:
+              isAccepted refers to the move by which the position was reached, numIterations to the number of iterations spent at it.
+  */
+  struct SampleRecord
+  {
+    unsigned chain;
+    unsigned numIterations;
+    unsigned isAccepted;
+    unsigned reserved;
+    double prob;
+  };
+
+  /**
+     \struct  SampleIndexEntry
+     \brief   entry of the event index of a SVfitStandaloneSampleFile; offset (in bytes) refers to the first sample of the event in the data file
+  */
+  struct SampleIndexEntry
+  {
+    unsigned long long run;
+    unsigned long long lumi;
+    unsigned long long event;
+    unsigned long long offset;
+    unsigned long long numSamples;
+    unsigned numDimensions;
+    unsigned reserved;
+  };
+
+  /**
+     \class   SampleView
+     \brief   zero-copy view of the samples of one event in a mapped SVfitStandaloneSampleFile
+  */
+  class SampleView
+  {
+   public:
+    SampleView(const SampleIndexEntry* entry, const char* data)
+      : entry_(entry),
+        data_(data),
+        recordSize_(sizeof(SampleRecord) + entry->numDimensions*sizeof(double))
+    {}
+
+    unsigned long long run() const { return entry_->run; }
+    unsigned long long lumi() const { return entry_->lumi; }
+    unsigned long long event() const { return entry_->event; }
+    unsigned numDimensions() const { return entry_->numDimensions; }
+    size_t numSamples() const { return entry_->numSamples; }
+
+    const SampleRecord& sample(size_t idx) const { return *reinterpret_cast<const SampleRecord*>(data_ + idx*recordSize_); }
+    const double* x(size_t idx) const { return reinterpret_cast<const double*>(data_ + idx*recordSize_ + sizeof(SampleRecord)); }
+
+   private:
+    const SampleIndexEntry* entry_;
+    const char* data_;
+    size_t recordSize_;
+  };
+}
+
+/**
+   \class   SVfitStandaloneSampleFileWriter SVfitStandaloneSampleFile.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneSampleFile.h"
+
+   \brief   Append-only binary file holding the samples of the Markov Chain integration for many events.
+
+   The samples are written to the data file fileName, the event index to fileName + ".idx". Both files start with a header
+   identifying the format. The data file contains, for each event, a contiguous block of fixed-size samples (SampleRecord followed
+   by the position x of the Markov Chain), the index file one SampleIndexEntry per event. The index entry of an event is written
+   after all its samples have been written, so that events which have been only partially written (e.g. because the job that
+   wrote them was killed) are ignored when reading the file, and overwritten when more events are appended to it.
+   The writer is passed to SVfitStandaloneAlgorithm::markovChainSampleFile and is called by the Markov Chain integrator
+   for every iteration of the sampling stage.
+*/
+
+class SVfitStandaloneSampleFileWriter : public SVfitStandaloneMarkovChainSampleCallBackFunction
+{
+ public:
+  SVfitStandaloneSampleFileWriter(const std::string& fileName);
+  ~SVfitStandaloneSampleFileWriter();
+
+  /// set run, lumi-section and event number of the next event (default is the index of the event in the file)
+  void setEventId(unsigned long long run, unsigned long long lumi, unsigned long long event);
+
+  /// start and finish the samples of one event
+  void beginEvent(unsigned numDimensions);
+  void EvalSample(unsigned chain, bool isAccepted, double prob, const double* x);
+  void endEvent();
+
+  /// number of events stored in the file
+  unsigned long long numEvents() const { return numEvents_; }
+
+ protected:
+  FILE* openFile(const std::string&, const char*, size_t, long&);
+  void writeSample();
+
+  std::string fileName_;
+  FILE* dataFile_;
+  FILE* indexFile_;
+  long dataFileSize_;
+  unsigned long long numEvents_;
+
+  bool hasEventId_;
+  svFitStandalone::SampleIndexEntry entry_;
+  bool isInEvent_;
+
+  /// sample to which rejected moves are added
+  bool hasSample_;
+  svFitStandalone::SampleRecord sample_;
+  std::vector<double> x_;
+};
+
+/**
+   \class   SVfitStandaloneSampleFileReader SVfitStandaloneSampleFile.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneSampleFile.h"
+
+   \brief   Read-only access to a file written by SVfitStandaloneSampleFileWriter, without ROOT.
+            The data and index file are memory-mapped, the samples are accessed in place through SampleView.
+*/
+
+class SVfitStandaloneSampleFileReader
+{
+ public:
+  SVfitStandaloneSampleFileReader(const std::string& fileName);
+  ~SVfitStandaloneSampleFileReader();
+
+  /// number of events stored in the file
+  size_t numEvents() const { return numEvents_; }
+  /// samples of event with given index
+  svFitStandalone::SampleView event(size_t idx) const;
+
+ protected:
+  const char* mapFile(const std::string&, size_t&);
+
+  std::string fileName_;
+  const char* data_;
+  size_t dataSize_;
+  const char* index_;
+  size_t indexSize_;
+  size_t numEvents_;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneStatistics_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneStatistics_h
+
+#include <iostream>
+#include <chrono>
+
+namespace svFitStandalone
+{
+  /**
+     \class   Statistics SVfitStandaloneStatistics.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStatistics.h"
+
+     \brief   Runtime statistics of the last call to SVfitStandaloneAlgorithm::fit, integrateVEGAS or integrateMarkovChain.
+
+     The statistics are collected only if enabled by SVfitStandaloneAlgorithm::collectStatistics (or for verbosity >= 1),
+     otherwise the counters are not touched and no clock is read. Wall times are given in seconds.
+     The moves of the Markov Chain are counted separately for the two phases of simulated annealing,
+     the remainder of the burn-in stage and the sampling stage, summed over all chains.
+  */
+  struct Statistics
+  {
+    enum Mode { kNone, kFit, kIntegrateVEGAS, kIntegrateMarkovChain };
+    enum Phase { kSimAnnealingPhase1, kSimAnnealingPhase2, kBurnin, kSampling, kNumPhases };
+
+    typedef std::chrono::steady_clock Clock;
+
+    Statistics() { clear(); }
+
+    void clear();
+    void print(std::ostream&) const;
+
+    /// wall time in seconds since start, start is set to the current time
+    static double elapsed(Clock::time_point& start)
+    {
+      Clock::time_point now = Clock::now();
+      double seconds = std::chrono::duration<double>(now - start).count();
+      start = now;
+      return seconds;
+    }
+
+    /// algorithm run (kNone in case no statistics have been collected for the current event)
+    int mode;
+    /// number of evaluations of the likelihood
+    unsigned long numIntegrandCalls;
+
+    /// Markov Chain: number of chains run and attempts to find a start-position of non-zero probability, summed over all chains
+    unsigned numChains;
+    unsigned numChainsRun;
+    unsigned long numStartPositionTries;
+    double timeStartPosition;
+    /// Markov Chain: accepted and rejected moves and wall time per phase
+    unsigned long numMovesAccepted[kNumPhases];
+    unsigned long numMovesRejected[kNumPhases];
+    double timePhase[kNumPhases];
+
+    /// VEGAS: number of mass hypotheses integrated in the coarse pass of the scan, number of mass hypotheses of the main pass 
+    /// integrated with the full and with the reduced number of integrand evaluations and number of points at which the integrand has been evaluated
+    unsigned numMassPointsCoarse;
+    unsigned numMassPointsFine;
+    unsigned numMassPointsReduced;
+    unsigned long numVEGASPoints;
+    double timeVEGASCoarse;
+    double timeVEGASFine;
+
+    /// total wall time
+    double timeTotal;
+    /// final status of the fit or integration (same convention as SVfitStandaloneAlgorithm::fitStatus) and of the likelihood
+    int fitStatus;
+    unsigned nllStatus;
+  };
+}
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneStreamingQuantiles_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneStreamingQuantiles_h
+
+#include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
+
+namespace svFitStandalone
+{
+  /**
+     \class   StreamingQuantileEstimator SVfitStandaloneStreamingQuantiles.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStreamingQuantiles.h"
+
+     \brief   Estimation of the distribution of a quantity without storing the individual values or filling a histogram.
+
+     The distribution is tracked by kNumMarkers markers, placed at equidistant quantiles of the distribution, which are updated
+     for each new value by the P^2 algorithm [1], extended to weighted values and to an arbitrary number of markers [2].
+     Quantiles are obtained by linear interpolation between the markers, the mode of the distribution by the position of the
+     marker with the highest density (weight per unit of the quantity) in its vicinity.
+     Filling is done in constant time and the memory used is independent of the number of values.
+
+     [1] R. Jain and I. Chlamtac, "The P^2 algorithm for dynamic calculation of quantiles and histograms without storing observations",
+         Communications of the ACM 28 (1985) 1076
+     [2] K.E.E. Raatikainen, "Simultaneous estimation of several percentiles", Simulation 49 (1987) 159
+  */
+  class StreamingQuantileEstimator
+  {
+   public:
+    enum { kNumMarkers = 41 };
+
+    StreamingQuantileEstimator();
+    ~StreamingQuantileEstimator() {}
+
+    /// remove all values
+    void Reset();
+    /// add value with given weight (weight must be positive)
+    void Fill(double value, double weight = 1.);
+
+    /// sum of weights of all values
+    double GetSumOfWeights() const { return sumWeights_; }
+    /// return estimate for quantile p (0 <= p <= 1)
+    double GetQuantile(double p) const;
+
+    /// fill value, uncertainty, Lmax and quantiles in the same way as extractHistogramSummary does for histograms
+    /// (mean3sigmaWithinMax and mean5sigmaWithinMax are set to the mode of the distribution)
+    void ExtractSummary(HistogramSummary&) const;
+
+   protected:
+    /// copy heights and positions of the markers; until kNumMarkers values have been filled, 
+    /// the markers are given by the values filled so far, sorted in ascending order
+    unsigned getMarkers(double* heights, double* positions) const;
+
+    /// number of values filled
+    unsigned numValues_;
+    double sumWeights_;
+    double sumWeightedValues_;
+
+    /// heights and positions (in units of cumulative weight) of the markers
+    double heights_[kNumMarkers];
+    double positions_[kNumMarkers];
+    /// weights of the first kNumMarkers values (needed for initialization of the marker positions)
+    double weights_[kNumMarkers];
+  };
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneTreeIO_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneTreeIO_h
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneBatchAlgorithm.h"
+
+#include <TFile.h>
+#include <TTree.h>
+
+#include <string>
+#include <vector>
+
+/**
+   \class   SVfitStandaloneTreeReader SVfitStandaloneTreeIO.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneTreeIO.h"
+
+   \brief   Read the inputs of SVfitStandaloneBatchAlgorithm from a flat n-tuple, one cluster of entries at a time.
+
+   The n-tuple is expected to contain the float branches met, mphi, mcov_11, mcov_12, mcov_21, mcov_22,
+   l1_Pt, l1_Eta, l1_Phi, l1_M, l2_Pt, l2_Eta, l2_Phi and l2_M (the format read by bin/testSVfitStandalone.cc);
+   the decay types of the two tau leptons are the same for all entries. Only these branches are read, through a TTreeCache
+   which prefetches the baskets of a whole cluster. Each branch is decoded separately for all entries of the cluster
+   into a contiguous array, from which the events are then assembled.
+   The tree must be a TTree (not a TChain), as entries are read directly from the branches.
+*/
+
+class SVfitStandaloneTreeReader
+{
+ public:
+  SVfitStandaloneTreeReader(TTree* tree, svFitStandalone::kDecayType leg1Type, svFitStandalone::kDecayType leg2Type, long cacheSize = 30000000);
+
+  /// read entries of the next cluster into events, returns false if all entries have been read
+  bool nextCluster(std::vector<svFitStandalone::BatchEvent>& events);
+
+  /// number of entries in the tree and first entry of the cluster read by the last call to nextCluster
+  long numEntries() const { return numEntries_; }
+  long firstEntry() const { return firstEntry_; }
+
+ protected:
+  enum { kMET, kMETPhi, kCovMET11, kCovMET12, kCovMET21, kCovMET22,
+	 kLeg1Pt, kLeg1Eta, kLeg1Phi, kLeg1Mass, kLeg2Pt, kLeg2Eta, kLeg2Phi, kLeg2Mass,
+	 kNumBranches };
+
+  TTree* tree_;
+  svFitStandalone::kDecayType leg1Type_;
+  svFitStandalone::kDecayType leg2Type_;
+  long numEntries_;
+  long firstEntry_;
+  TTree::TClusterIterator clusterIterator_;
+
+  TBranch* branches_[kNumBranches];
+  float values_[kNumBranches];
+  std::vector<float> columns_[kNumBranches];
+};
+
+/**
+   \class   SVfitStandaloneFriendTreeWriter SVfitStandaloneTreeIO.h "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneTreeIO.h"
+
+   \brief   Write results of SVfitStandaloneBatchAlgorithm to a tree with one entry per event, in a separate file.
+
+   The results have to be filled in the order of the entries of the input tree, so that entry i of the written tree
+   holds the results for entry i of the input tree and can be attached to it by TTree::AddFriend, without copying the input tree.
+*/
+
+class SVfitStandaloneFriendTreeWriter
+{
+ public:
+  SVfitStandaloneFriendTreeWriter(const std::string& fileName, const std::string& treeName = "svFit");
+  ~SVfitStandaloneFriendTreeWriter();
+
+  /// append one entry per event in results
+  void fill(const svFitStandalone::BatchResults& results);
+  /// write tree to file
+  void write();
+
+  long numEntries() const { return numEntries_; }
+
+ protected:
+  TFile* file_;
+  TTree* tree_;
+  long numEntries_;
+  bool isWritten_;
+
+  double mass_;
+  double massUncert_;
+  double massLmax_;
+  double transverseMass_;
+  double transverseMassUncert_;
+  double transverseMassLmax_;
+  int fitStatus_;
+  int nllStatus_;
+  int isValidSolution_;
+};
+
+#endif
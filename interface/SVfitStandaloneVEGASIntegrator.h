@@ -0,0 +1,169 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneVEGASIntegrator_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneVEGASIntegrator_h
+
+/** \class SVfitStandaloneVEGASIntegrator
+ *
+ * Adaptive Monte Carlo integration in N-dimensional space
+ * by importance sampling according to the VEGAS algorithm.
+ *
+ * The code is implemented following the description in:
+ *  [1] "A New Algorithm for Adaptive Multidimensional Integration",
+ *      G.P. Lepage, J. Comput. Phys. 27 (1978) 192.
+ *
+ * The integrand is evaluated for batches of points,
+ * in order to reduce the overhead of calling the likelihood function point by point.
+ * In contrast to the GSL implementation, the importance grid is kept
+ * after each integration and may be reused for the next integration of a similar integrand.
+ * The random number generator is reset at the beginning of each integration,
+ * in order to make integration results independent of processing history.
+ *
+ * NOTE: the importance sampling is performed without stratification,
+ *       i.e. the integration corresponds to the "importance" mode of the GSL implementation.
+ *
+ */
+
+#include <TRandom3.h>
+
+#include <vector>
+#include <iostream>
+
+/** \class SVfitStandaloneVEGASIntegrand
+ *
+ * Integrand that can be evaluated for a batch of points.
+ * The points are stored consecutively, i.e. coordinate iDimension of point iPoint is x[iPoint*NDim() + iDimension].
+ *
+ */
+
+class SVfitStandaloneVEGASIntegrand
+{
+ public:
+  virtual ~SVfitStandaloneVEGASIntegrand() {}
+  virtual unsigned int NDim() const = 0;
+  virtual void EvalBatch(const double* x, unsigned numPoints, double* f) const = 0;
+};
+
+/** \class SVfitStandaloneVEGASCallBackFunction
+ *
+ * Function called for the points evaluated in the last iteration of each integration, 
+ * i.e. with the final importance grid. The weight of each point is its contribution to the integral, 
+ * so that filling the weights into a histogram yields the distribution of the integrand projected on the histogrammed variable.
+ *
+ */
+
+class SVfitStandaloneVEGASCallBackFunction
+{
+ public:
+  virtual ~SVfitStandaloneVEGASCallBackFunction() {}
+  virtual void EvalCallBack(const double* x, unsigned numPoints, const double* weights) const = 0;
+};
+
+class SVfitStandaloneVEGASIntegrator
+{
+ public:
+  SVfitStandaloneVEGASIntegrator(unsigned numCallsPerIteration, unsigned numIterations, unsigned numBins = 50, double alpha = 1.5, int verbose = -1);
+  ~SVfitStandaloneVEGASIntegrator();
+
+//--- set function to be integrated
+  void setIntegrand(const SVfitStandaloneVEGASIntegrand&);
+
+//--- register function called for the points evaluated in the last iteration;
+//    NOTE: the integration is not stopped early in case call-back functions are registered
+  void registerCallBackFunction(const SVfitStandaloneVEGASCallBackFunction&);
+//--- remove previously registered function
+  void unregisterCallBackFunction(const SVfitStandaloneVEGASCallBackFunction&);
+
+//--- set seed of random number generator
+  void setSeed(unsigned seed) { seed_ = seed; }
+
+//--- set number of integrand evaluations per iteration and number of iterations
+  void setNumCalls(unsigned numCallsPerIteration, unsigned numIterations);
+
+//--- set relative uncertainty at which the integration is stopped in case it starts from an already adapted importance grid;
+//    at least minIterations iterations are performed in this case (maxRelErr <= 0 disables early stopping)
+  void setTargetRelErr(double maxRelErr, unsigned minIterations = 2) 
+  { 
+    maxRelErr_ = maxRelErr; 
+    minIterations_ = minIterations; 
+  }
+
+//--- compute integral of integrand within integration region given by lower boundaries xMin and upper boundaries xMax.
+//    The importance grid is adapted starting from a uniform grid in case resetGrid is true,
+//    otherwise the grid adapted during the previous integration is used as starting point
+//    and the integration stops as soon as the target relative uncertainty is reached.
+  void integrate(const double* xMin, const double* xMax, double& integral, double& integralErr, bool resetGrid = true);
+
+  /// number of iterations performed in last integration
+  unsigned numIterationsDone() const { return numIterationsDone_; }
+  /// number of points at which the integrand has been evaluated, summed over all integrations
+  long numIntegrandCalls() const { return numIntegrandCalls_; }
+
+  void print(std::ostream&) const;
+
+ protected:
+
+  void initializeGrid();
+  void refineGrid();
+
+  double runIteration(unsigned, double&, bool);
+
+  const SVfitStandaloneVEGASIntegrand* integrand_;
+
+  // parameters defining integration region
+  //  numDimensions: dimensionality of integration region (Hypercube)
+  //  xMin:          lower boundaries of integration region
+  //  xMax:          upper boundaries of integration region
+  unsigned numDimensions_;
+  std::vector<double> xMin_; // index = dimension
+  std::vector<double> xMax_; // index = dimension
+  double volume_;
+
+  // parameters defining number of integrand evaluations performed per integration
+  //  numCallsPerIteration: number of integrand evaluations per iteration
+  //                        (same convention as for the "calls" parameter of the GSL implementation)
+  //  numIterations:        number of iterations; the importance grid is refined after each iteration
+  unsigned numCallsPerIteration_;
+  unsigned numIterations_;
+  double maxRelErr_;
+  unsigned minIterations_;
+
+  // parameters of the importance grid
+  //  numBins: number of bins per dimension
+  //  alpha:   stiffness parameter with which the grid is refined
+  //          (alpha = 0 corresponds to no refinement, GSL default is alpha = 1.5)
+  unsigned numBins_;
+  double alpha_;
+
+  // importance grid: bin boundaries in interval [0..1] and sum of squared integrand values per bin
+  typedef std::vector<double> vdouble;
+  vdouble grid_;      // index = dimension*(numBins + 1) + bin
+  vdouble gridSum2_;  // index = dimension*numBins + bin
+  bool isGridInitialized_;
+
+  // temporary variables used to evaluate integrand for batch of points
+  unsigned batchSize_;
+  vdouble x_;         // index = point*numDimensions + dimension
+  vdouble f_;         // index = point
+  vdouble jacobi_;    // index = point
+  std::vector<unsigned> bin_; // index = point*numDimensions + dimension
+  vdouble r_;
+  vdouble weights_;   // index = point
+
+  std::vector<const SVfitStandaloneVEGASCallBackFunction*> callBackFunctions_;
+
+  // random number generator
+  TRandom3 rnd_;
+  unsigned seed_;
+
+  // results of last integration
+  double integral_;
+  double integralErr_;
+  double chi2PerIter_;
+  unsigned numIterationsDone_;
+
+  long numIntegrationCalls_;
+  long numIntegrandCalls_;
+
+  int verbose_; // flag to enable/disable debug output
+};
+
+#endif
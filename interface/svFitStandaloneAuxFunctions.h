@@ -69,11 +69,39 @@ namespace svFitStandalone
   /// Determine the tau direction given our parameterization
   Vector motherDirection(const Vector&, double, double); 
 
+  /// Rotate vector given in a coordinate system with z-axis along the unit vector newUzVector into the lab frame (used by motherDirection)
+  Vector rotateUz(const ROOT::Math::DisplacementVector3D<ROOT::Math::Polar3D<double> >&, const Vector&);
+
   /// Compute the tau four vector given the tau direction and momentum
   LorentzVector motherP4(const Vector&, double, double);
 
   /// Extract maximum, mean and { 0.84, 0.50, 0.16 } quantiles of distribution
   void extractHistogramProperties(const TH1*, const TH1*, double&, double&, double&, double&, double&, double&, double&, double&, int = 0);
+
+  /// Summary of distribution, as used to determine value, uncertainty and maximum likelihood of reconstructed quantities.
+  /// The maximum and Lmax refer to the histogram content divided by the bin width (probability density).
+  struct HistogramSummary
+  {
+    HistogramSummary();
+    /// value and uncertainty of reconstructed quantity
+    double value() const { return maximum; }
+    double uncertainty() const;
+
+    double maximum;
+    double maximum_interpol;
+    double mean;
+    double quantile016;
+    double quantile050;
+    double quantile084;
+    double mean3sigmaWithinMax;
+    double mean5sigmaWithinMax;
+    double Lmax;
+  };
+  /// Compute all properties of distribution in two passes over the bins of the histogram, 
+  /// with the same results as extractHistogramProperties, but without the need to clone the histogram for computing the probability density
+  void extractHistogramSummary(const TH1*, HistogramSummary&, int = 0);
+  class FlatHistogram;
+  void extractHistogramSummary(const FlatHistogram&, HistogramSummary&, int = 0);
 }
 
 #endif
@@ -1,6 +1,7 @@
 #include "TauAnalysis/SVfitStandalone/interface/LikelihoodFunctions.h"
 
 #include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
 
 #include <TMath.h>
 
@@ -119,62 +120,103 @@ namespace
     //std::cout << "bin = " << bin << " (numBins = " << numBins << ")" << std::endl;
     return lut->GetBinContent(bin);
   }
-}
 
-double 
-probVisMass(double visMass, const TH1* lutVisMass, bool verbosity)
-{
+  double extractProbFromLUT(double x, const LookupTable* lut)
+  {
+    return lut->eval(x);
+  }
+
+  template <typename T>
+  double probVisMass_impl(double visMass, const T* lutVisMass, bool verbosity)
+  {
 #ifdef SVFIT_DEBUG 
-  if ( verbosity ) {
-    std::cout << "<probVisMass>:" << std::endl;
-    std::cout << " visMass = " << visMass << std::endl;
+    if ( verbosity ) {
+      std::cout << "<probVisMass>:" << std::endl;
+      std::cout << " visMass = " << visMass << std::endl;
+    }
+#endif
+    double prob = ( lutVisMass ) ? extractProbFromLUT(visMass, lutVisMass) : 1.0;
+#ifdef SVFIT_DEBUG 
+    if ( verbosity ) {
+      std::cout << "--> prob = " << prob << std::endl;
+    }
+#endif
+    return prob;
   }
+
+  template <typename T>
+  double probVisMassShift_impl(double deltaVisMass, const T* lutVisMassRes, bool verbosity)
+  {
+#ifdef SVFIT_DEBUG 
+    if ( verbosity ) {
+      std::cout << "<probVisMassShift>:" << std::endl;
+      std::cout << " deltaVisMass = " << deltaVisMass << std::endl;
+    }
 #endif
-  double prob = ( lutVisMass ) ? extractProbFromLUT(visMass, lutVisMass) : 1.0;
+    double prob = ( lutVisMassRes ) ? extractProbFromLUT(deltaVisMass, lutVisMassRes) : 1.0;
 #ifdef SVFIT_DEBUG 
-  if ( verbosity ) {
-    std::cout << "--> prob = " << prob << std::endl;
+    if ( verbosity ) {
+      std::cout << "--> prob = " << prob << std::endl;
+    }
+#endif
+    return prob;
   }
+
+  template <typename T>
+  double probVisPtShift_impl(double recTauPtDivGenTauPt, const T* lutVisPtRes, bool verbosity)
+  {
+#ifdef SVFIT_DEBUG 
+    if ( verbosity ) {
+      std::cout << "<probVisPtShift>:" << std::endl;
+      std::cout << " recTauPtDivGenTauPt = " << recTauPtDivGenTauPt << std::endl;
+    }
 #endif
-  return prob;
+    double prob = ( lutVisPtRes ) ? extractProbFromLUT(recTauPtDivGenTauPt, lutVisPtRes) : 1.0;
+    // CV: account for Jacobi factor 
+    double genTauPtDivRecTauPt = ( recTauPtDivGenTauPt > 0. ) ? 
+      (1./recTauPtDivGenTauPt) : 1.e+1;
+    prob *= genTauPtDivRecTauPt;
+#ifdef SVFIT_DEBUG 
+    if ( verbosity ) {
+      std::cout << "--> prob = " << prob << std::endl;
+    }
+#endif
+    return prob;
+  }
+}
+
+double 
+probVisMass(double visMass, const TH1* lutVisMass, bool verbosity)
+{
+  return probVisMass_impl(visMass, lutVisMass, verbosity);
+}
+
+double 
+probVisMass(double visMass, const LookupTable* lutVisMass, bool verbosity)
+{
+  return probVisMass_impl(visMass, lutVisMass, verbosity);
 }
 
 double 
 probVisMassShift(double deltaVisMass, const TH1* lutVisMassRes, bool verbosity)
 {
-#ifdef SVFIT_DEBUG 
-  if ( verbosity ) {
-    std::cout << "<probVisMassShift>:" << std::endl;
-    std::cout << " deltaVisMass = " << deltaVisMass << std::endl;
-  }
-#endif
-  double prob = ( lutVisMassRes ) ? extractProbFromLUT(deltaVisMass, lutVisMassRes) : 1.0;
-#ifdef SVFIT_DEBUG 
-  if ( verbosity ) {
-    std::cout << "--> prob = " << prob << std::endl;
-  }
-#endif
-  return prob;
+  return probVisMassShift_impl(deltaVisMass, lutVisMassRes, verbosity);
+}
+
+double 
+probVisMassShift(double deltaVisMass, const LookupTable* lutVisMassRes, bool verbosity)
+{
+  return probVisMassShift_impl(deltaVisMass, lutVisMassRes, verbosity);
 }
 
 double 
 probVisPtShift(double recTauPtDivGenTauPt, const TH1* lutVisPtRes, bool verbosity)
 {
-#ifdef SVFIT_DEBUG 
-  if ( verbosity ) {
-    std::cout << "<probVisPtShift>:" << std::endl;
-    std::cout << " recTauPtDivGenTauPt = " << recTauPtDivGenTauPt << std::endl;
-  }
-#endif
-  double prob = ( lutVisPtRes ) ? extractProbFromLUT(recTauPtDivGenTauPt, lutVisPtRes) : 1.0;
-  // CV: account for Jacobi factor 
-  double genTauPtDivRecTauPt = ( recTauPtDivGenTauPt > 0. ) ? 
-    (1./recTauPtDivGenTauPt) : 1.e+1;
-  prob *= genTauPtDivRecTauPt;
-#ifdef SVFIT_DEBUG 
-  if ( verbosity ) {
-    std::cout << "--> prob = " << prob << std::endl;
-  }
-#endif
-  return prob;
+  return probVisPtShift_impl(recTauPtDivGenTauPt, lutVisPtRes, verbosity);
+}
+
+double 
+probVisPtShift(double recTauPtDivGenTauPt, const LookupTable* lutVisPtRes, bool verbosity)
+{
+  return probVisPtShift_impl(recTauPtDivGenTauPt, lutVisPtRes, verbosity);
 }
@@ -2,7 +2,6 @@
 
 #include "Math/Factory.h"
 #include "Math/Functor.h"
-#include "Math/GSLMCIntegrator.h"
 #include "Math/LorentzVector.h"
 #include "Math/PtEtaPhiM4D.h"
 
@@ -37,15 +36,30 @@ SVfitStandaloneAlgorithm::SVfitStandaloneAlgorithm(const std::vector<svFitStanda
   : fitStatus_(-1),
     verbosity_(verbosity),
     maxObjFunctionCalls_(10000),
+    useAnalyticGradient_(true),
+    useMinuit_(true),
+    minimizer_(0),
+    covMET_rounded_(2,2),
     standaloneObjectiveFunctionAdapterVEGAS_(0),
+    massHistogramAdapterVEGAS_(0),
+    integratorVEGAS_(0),
+    integrateOverMass_(false),
     mcObjectiveFunctionAdapter_(0),
     mcQuantitiesAdapter_(0),
     integrator2_(0),
     integrator2_nDim_(0),
     isInitialized2_(false),
     maxObjFunctionCalls2_(100000),
+    randomSeed_(12345),
+    sampleFraction_(1.),
+    keepMarkovChainSamples_(false),
+    markovChainSampleFile_(0),
+    outputSink_(0),
+    collectStatistics_(false),
+    statisticsStartNumObjFunctionCalls_(0),
     marginalizeVisMass_(false),
     lutVisMassAllDMs_(0),
+    lutVisMassAllDMs_owned_(0),
     shiftVisMass_(false),
     lutVisMassResDM0_(0),
     lutVisMassResDM1_(0),
@@ -55,10 +69,21 @@ SVfitStandaloneAlgorithm::SVfitStandaloneAlgorithm(const std::vector<svFitStanda
     lutVisPtResDM1_(0),
     lutVisPtResDM10_(0)
 {
-  // instantiate minuit, the arguments might turn into configurables once
-  minimizer_ = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
+  prepareMeasurements(measuredTauLeptons, measuredMETx, measuredMETy, covMET, measuredTauLeptons_rounded_, measuredMET_rounded_, covMET_rounded_);
 
-  std::vector<svFitStandalone::MeasuredTauLepton> measuredTauLeptons_rounded;
+  // instantiate the combined likelihood
+  nll_ = new svFitStandalone::SVfitStandaloneLikelihood(measuredTauLeptons_rounded_, measuredMET_rounded_, covMET_rounded_, (verbosity_ >= 2));
+  nllStatus_ = nll_->error();
+
+  // the minimizer and the objects needed for the VEGAS and Markov Chain integration 
+  // are created when the respective mode is used for the first time
+}
+
+void
+SVfitStandaloneAlgorithm::prepareMeasurements(const std::vector<svFitStandalone::MeasuredTauLepton>& measuredTauLeptons, double measuredMETx, double measuredMETy, const TMatrixD& covMET,
+					      std::vector<svFitStandalone::MeasuredTauLepton>& measuredTauLeptons_rounded, svFitStandalone::Vector& measuredMET_rounded, TMatrixD& covMET_rounded) const
+{
+  measuredTauLeptons_rounded.clear();
   for ( std::vector<svFitStandalone::MeasuredTauLepton>::const_iterator measuredTauLepton = measuredTauLeptons.begin();
         measuredTauLepton != measuredTauLeptons.end(); ++measuredTauLepton ) {
     svFitStandalone::MeasuredTauLepton measuredTauLepton_rounded(
@@ -86,8 +111,7 @@ SVfitStandaloneAlgorithm::SVfitStandaloneAlgorithm(const std::vector<svFitStanda
   }
   double measuredMETx_rounded = svFitStandalone::roundToNdigits(measuredMETx);
   double measuredMETy_rounded = svFitStandalone::roundToNdigits(measuredMETy);
-  svFitStandalone::Vector measuredMET_rounded(measuredMETx_rounded, measuredMETy_rounded, 0.);
-  TMatrixD covMET_rounded(2,2);
+  measuredMET_rounded = svFitStandalone::Vector(measuredMETx_rounded, measuredMETy_rounded, 0.);
   covMET_rounded[0][0] = svFitStandalone::roundToNdigits(covMET[0][0]);
   covMET_rounded[1][0] = svFitStandalone::roundToNdigits(covMET[1][0]);
   covMET_rounded[0][1] = svFitStandalone::roundToNdigits(covMET[0][1]);
@@ -111,14 +135,29 @@ SVfitStandaloneAlgorithm::SVfitStandaloneAlgorithm(const std::vector<svFitStanda
     EigenValues(1) = TMath::Sqrt(EigenValues(1));
     std::cout << "Eigenvalues = " << EigenValues(0) << ", " << EigenValues(1) << std::endl;
   }
+}
 
-  // instantiate the combined likelihood
-  nll_ = new svFitStandalone::SVfitStandaloneLikelihood(measuredTauLeptons_rounded, measuredMET_rounded, covMET_rounded, (verbosity_ >= 2));
-  nllStatus_ = nll_->error();
+void
+SVfitStandaloneAlgorithm::reset(const std::vector<svFitStandalone::MeasuredTauLepton>& measuredTauLeptons, double measuredMETx, double measuredMETy, const TMatrixD& covMET)
+{
+  prepareMeasurements(measuredTauLeptons, measuredMETx, measuredMETy, covMET, measuredTauLeptons_rounded_, measuredMET_rounded_, covMET_rounded_);
 
-  standaloneObjectiveFunctionAdapterVEGAS_ = new svFitStandalone::ObjectiveFunctionAdapterVEGAS();
+  // set new measurements in the combined likelihood, keeping its configuration
+  nll_->reset(measuredTauLeptons_rounded_, measuredMET_rounded_, covMET_rounded_);
+  nllStatus_ = nll_->error();
 
-  clock_ = new TBenchmark();
+  // reset results of previous event
+  fitStatus_ = -1;
+  mass_ = 0.;
+  massUncert_ = 0.;
+  massLmax_ = 0.;
+  transverseMass_ = 0.;
+  transverseMassUncert_ = 0.;
+  transverseMassLmax_ = 0.;
+  fittedTauLeptons_.clear();
+  fittedDiTauSystem_ = svFitStandalone::LorentzVector();
+  statistics_.clear();
+  if ( isInitialized2_ ) mcQuantitiesAdapter_->Reset();
 }
 
 SVfitStandaloneAlgorithm::~SVfitStandaloneAlgorithm()
@@ -128,45 +167,44 @@ SVfitStandaloneAlgorithm::~SVfitStandaloneAlgorithm()
   delete standaloneObjectiveFunctionAdapterVEGAS_;
   delete mcObjectiveFunctionAdapter_;
   delete mcQuantitiesAdapter_;
+  delete integratorVEGAS_;
+  delete massHistogramAdapterVEGAS_;
   delete integrator2_;
-  //delete lutVisMassAllDMs_;
-  //delete lutVisMassResDM0_;
-  //delete lutVisMassResDM1_;
-  //delete lutVisMassResDM10_;
-  //delete lutVisPtResDM0_;
-  //delete lutVisPtResDM1_;
-  //delete lutVisPtResDM10_;
-
-  delete clock_;
+  delete lutVisMassAllDMs_owned_;
+
 }
 
-namespace
+void
+SVfitStandaloneAlgorithm::marginalizeVisMass(bool value, TFile* inputFile)
 {
-  TH1* readHistogram(TFile* inputFile, const std::string& histogramName)
-  {
-    TH1* histogram = dynamic_cast<TH1*>(inputFile->Get(histogramName.data()));
-    if ( !histogram ) {
-      std::cerr << "<readHistogram>: Failed to load histogram = " << histogramName << " from file = " << inputFile->GetName() << " !!" << std::endl;
-      assert(0);
-    }
-    return histogram;
+  marginalizeVisMass_ = value;
+  if ( marginalizeVisMass_ ) {
+    lutVisMassAllDMs_ = SVfitStandaloneLUTRegistry::instance().visMassAllDMs(inputFile);
   }
 }
 
 void
-SVfitStandaloneAlgorithm::marginalizeVisMass(bool value, TFile* inputFile)
+SVfitStandaloneAlgorithm::marginalizeVisMass(bool value, const std::string& inputFileName)
 {
   marginalizeVisMass_ = value;
   if ( marginalizeVisMass_ ) {
-    delete lutVisMassAllDMs_;
-    TH1* lutVisMassAllDMs_tmp = readHistogram(inputFile, "DQMData/genTauMassAnalyzer/genTauJetMass");
-    if ( lutVisMassAllDMs_tmp->GetNbinsX() >= 1000 ) lutVisMassAllDMs_tmp->Rebin(100);
-    lutVisMassAllDMs_ = lutVisMassAllDMs_tmp;
+    lutVisMassAllDMs_ = SVfitStandaloneLUTRegistry::instance().visMassAllDMs(inputFileName);
   }
 }
 
 void
 SVfitStandaloneAlgorithm::marginalizeVisMass(bool value, const TH1* lut)
+{
+  marginalizeVisMass_ = value;
+  if ( marginalizeVisMass_ ) {
+    delete lutVisMassAllDMs_owned_;
+    lutVisMassAllDMs_owned_ = new svFitStandalone::LookupTable(lut);
+    lutVisMassAllDMs_ = lutVisMassAllDMs_owned_;
+  }
+}
+
+void
+SVfitStandaloneAlgorithm::marginalizeVisMass(bool value, const svFitStandalone::LookupTable* lut)
 {
   marginalizeVisMass_ = value;
   if ( marginalizeVisMass_ ) {
@@ -179,12 +217,22 @@ SVfitStandaloneAlgorithm::shiftVisMass(bool value, TFile* inputFile)
 {
   shiftVisMass_ = value;
   if ( shiftVisMass_ ) {
-    delete lutVisMassResDM0_;
-    lutVisMassResDM0_ = readHistogram(inputFile, "recMinusGenTauMass_recDecayModeEq0");
-    delete lutVisMassResDM1_;
-    lutVisMassResDM1_ = readHistogram(inputFile, "recMinusGenTauMass_recDecayModeEq1");
-    delete lutVisMassResDM10_;
-    lutVisMassResDM10_ = readHistogram(inputFile, "recMinusGenTauMass_recDecayModeEq10");
+    SVfitStandaloneLUTRegistry& registry = SVfitStandaloneLUTRegistry::instance();
+    lutVisMassResDM0_ = registry.visMassRes(inputFile, 0);
+    lutVisMassResDM1_ = registry.visMassRes(inputFile, 1);
+    lutVisMassResDM10_ = registry.visMassRes(inputFile, 10);
+  }
+}
+
+void
+SVfitStandaloneAlgorithm::shiftVisMass(bool value, const std::string& inputFileName)
+{
+  shiftVisMass_ = value;
+  if ( shiftVisMass_ ) {
+    SVfitStandaloneLUTRegistry& registry = SVfitStandaloneLUTRegistry::instance();
+    lutVisMassResDM0_ = registry.visMassRes(inputFileName, 0);
+    lutVisMassResDM1_ = registry.visMassRes(inputFileName, 1);
+    lutVisMassResDM10_ = registry.visMassRes(inputFileName, 10);
   }
 }
 
@@ -193,78 +241,111 @@ SVfitStandaloneAlgorithm::shiftVisPt(bool value, TFile* inputFile)
 {
   shiftVisPt_ = value;
   if ( shiftVisPt_ ) {
-    delete lutVisPtResDM0_;
-    lutVisPtResDM0_ = readHistogram(inputFile, "recTauPtDivGenTauPt_recDecayModeEq0");
-    delete lutVisPtResDM1_;
-    lutVisPtResDM1_ = readHistogram(inputFile, "recTauPtDivGenTauPt_recDecayModeEq1");
-    delete lutVisPtResDM10_;
-    lutVisPtResDM10_ = readHistogram(inputFile, "recTauPtDivGenTauPt_recDecayModeEq10");
+    SVfitStandaloneLUTRegistry& registry = SVfitStandaloneLUTRegistry::instance();
+    lutVisPtResDM0_ = registry.visPtRes(inputFile, 0);
+    lutVisPtResDM1_ = registry.visPtRes(inputFile, 1);
+    lutVisPtResDM10_ = registry.visPtRes(inputFile, 10);
   }
 }
 
+void
+SVfitStandaloneAlgorithm::shiftVisPt(bool value, const std::string& inputFileName)
+{
+  shiftVisPt_ = value;
+  if ( shiftVisPt_ ) {
+    SVfitStandaloneLUTRegistry& registry = SVfitStandaloneLUTRegistry::instance();
+    lutVisPtResDM0_ = registry.visPtRes(inputFileName, 0);
+    lutVisPtResDM1_ = registry.visPtRes(inputFileName, 1);
+    lutVisPtResDM10_ = registry.visPtRes(inputFileName, 10);
+  }
+}
+
+namespace
+{
+  // names of fit parameters, precomputed to avoid string formatting for each event
+  const char* fitParameterNames[2][svFitStandalone::kMaxFitParams] = {
+    { "leg1::xFrac", "leg1::mNuNu", "leg1::phi", "leg1::mVisShift", "leg1::tauPtDivGenVisPt" },
+    { "leg2::xFrac", "leg2::mNuNu", "leg2::phi", "leg2::mVisShift", "leg2::tauPtDivGenVisPt" }
+  };
+}
+
+unsigned
+SVfitStandaloneAlgorithm::scaleNumCalls(unsigned numCalls) const
+{
+  // keep a minimum of 100 evaluations, in order to avoid degenerate integrations
+  return TMath::Max(100, TMath::Nint(sampleFraction_*numCalls));
+}
+
+void
+SVfitStandaloneAlgorithm::setVariable(unsigned idx, double value, double step)
+{
+  if ( useMinuit_ ) minimizer_->SetVariable(idx, fitParameterNames[idx/svFitStandalone::kMaxFitParams][idx%svFitStandalone::kMaxFitParams], value, step);
+  else minimizerBFGS_.setVariable(idx, value, step);
+}
+
+void
+SVfitStandaloneAlgorithm::setLimitedVariable(unsigned idx, double value, double step, double lower, double upper)
+{
+  if ( useMinuit_ ) minimizer_->SetLimitedVariable(idx, fitParameterNames[idx/svFitStandalone::kMaxFitParams][idx%svFitStandalone::kMaxFitParams], value, step, lower, upper);
+  else minimizerBFGS_.setLimitedVariable(idx, value, step, lower, upper);
+}
+
+void
+SVfitStandaloneAlgorithm::setFixedVariable(unsigned idx, double value)
+{
+  if ( useMinuit_ ) minimizer_->SetFixedVariable(idx, fitParameterNames[idx/svFitStandalone::kMaxFitParams][idx%svFitStandalone::kMaxFitParams], value);
+  else minimizerBFGS_.setFixedVariable(idx, value);
+}
+
+bool
+SVfitStandaloneAlgorithm::beginStatistics(svFitStandalone::Statistics::Mode mode)
+{
+  statistics_.clear();
+  if ( !(collectStatistics_ || verbosity_ >= 1) ) return false;
+  statistics_.mode = mode;
+  statisticsStartTime_ = svFitStandalone::Statistics::Clock::now();
+  statisticsStartNumObjFunctionCalls_ = nll_->numObjFunctionCalls();
+  return true;
+}
+
+void
+SVfitStandaloneAlgorithm::endStatistics()
+{
+  if ( statistics_.mode == svFitStandalone::Statistics::kNone ) return;
+  statistics_.numIntegrandCalls = nll_->numObjFunctionCalls() - statisticsStartNumObjFunctionCalls_;
+  statistics_.timeTotal = svFitStandalone::Statistics::elapsed(statisticsStartTime_);
+  statistics_.fitStatus = fitStatus_;
+  statistics_.nllStatus = nllStatus_;
+  if ( verbosity_ >= 1 ) statistics_.print(std::cout);
+}
+
 void
 SVfitStandaloneAlgorithm::setup()
 {
   using namespace svFitStandalone;
 
-  //if ( verbosity_ >= 1 ) {
-  //  std::cout << "<SVfitStandaloneAlgorithm::setup()>:" << std::endl;
-  //}
   for ( size_t idx = 0; idx < nll_->measuredTauLeptons().size(); ++idx ) {
     const MeasuredTauLepton& measuredTauLepton = nll_->measuredTauLeptons()[idx];
-    //if ( verbosity_ >= 1 ) {
-    //  std::cout << " --> upper limit of leg1::mNuNu will be set to ";
-    //  if ( measuredTauLepton.type() == kTauToHadDecay ) {
-    //    std::cout << "0";
-    //  } else {
-    //    std::cout << (svFitStandalone::tauLeptonMass - TMath::Min(measuredTauLepton.mass(), 1.5));
-    //  }
-    //  std::cout << std::endl;
-    //}
     // start values for xFrac
-    minimizer_->SetLimitedVariable(
-      idx*kMaxFitParams + kXFrac,
-      std::string(TString::Format("leg%i::xFrac", (int)idx + 1)).c_str(),
-      0.5, 0.1, 0., 1.);
+    setLimitedVariable(idx*kMaxFitParams + kXFrac, 0.5, 0.1, 0., 1.);
     // start values for nunuMass (leptonic tau decays only)
     if ( measuredTauLepton.type() == kTauToHadDecay ) {
-      minimizer_->SetFixedVariable(
-        idx*kMaxFitParams + kMNuNu,
-        std::string(TString::Format("leg%i::mNuNu", (int)idx + 1)).c_str(),
-        0.);
+      setFixedVariable(idx*kMaxFitParams + kMNuNu, 0.);
     } else {
-      minimizer_->SetLimitedVariable(
-        idx*kMaxFitParams + kMNuNu,
-        std::string(TString::Format("leg%i::mNuNu", (int)idx + 1)).c_str(),
-        0.8, 0.10, 0., svFitStandalone::tauLeptonMass - TMath::Min(measuredTauLepton.mass(), 1.5));
+      setLimitedVariable(idx*kMaxFitParams + kMNuNu, 0.8, 0.10, 0., svFitStandalone::tauLeptonMass - TMath::Min(measuredTauLepton.mass(), 1.5));
     }
     // start values for phi
-    minimizer_->SetVariable(
-      idx*kMaxFitParams + kPhi,
-      std::string(TString::Format("leg%i::phi", (int)idx + 1)).c_str(),
-      0.0, 0.25);
+    setVariable(idx*kMaxFitParams + kPhi, 0.0, 0.25);
     // start values for Pt and mass of visible tau decay products (hadronic tau decays only)
     if ( measuredTauLepton.type() == kTauToHadDecay && (marginalizeVisMass_ || shiftVisMass_) ) {
-      minimizer_->SetLimitedVariable(
-        idx*kMaxFitParams + kVisMassShifted,
-        std::string(TString::Format("leg%i::mVisShift", (int)idx + 1)).c_str(),
-        0.8, 0.10, svFitStandalone::chargedPionMass, svFitStandalone::tauLeptonMass);
+      setLimitedVariable(idx*kMaxFitParams + kVisMassShifted, 0.8, 0.10, svFitStandalone::chargedPionMass, svFitStandalone::tauLeptonMass);
     } else {
-      minimizer_->SetFixedVariable(
-        idx*kMaxFitParams + kVisMassShifted,
-        std::string(TString::Format("leg%i::mVisShift", (int)idx + 1)).c_str(),
-        measuredTauLepton.mass());
+      setFixedVariable(idx*kMaxFitParams + kVisMassShifted, measuredTauLepton.mass());
     }
     if ( measuredTauLepton.type() == kTauToHadDecay && shiftVisPt_ ) {
-      minimizer_->SetLimitedVariable(
-        idx*kMaxFitParams + kRecTauPtDivGenTauPt,
-        std::string(TString::Format("leg%i::tauPtDivGenVisPt", (int)idx + 1)).c_str(),
-        0., 0.10, -1., +1.5);
+      setLimitedVariable(idx*kMaxFitParams + kRecTauPtDivGenTauPt, 0., 0.10, -1., +1.5);
     } else {
-      minimizer_->SetFixedVariable(
-        idx*kMaxFitParams + kRecTauPtDivGenTauPt,
-        std::string(TString::Format("leg%i::tauPtDivGenVisPt", (int)idx + 1)).c_str(),
-        0.);
+      setFixedVariable(idx*kMaxFitParams + kRecTauPtDivGenTauPt, 0.);
     }
   }
 }
@@ -275,43 +356,69 @@ SVfitStandaloneAlgorithm::fit()
   if ( verbosity_ >= 1 ) {
     std::cout << "<SVfitStandaloneAlgorithm::fit>:" << std::endl;
   }
-
-  // clear minimizer
-  minimizer_->Clear();
-
-  // set verbosity level of minimizer
-  minimizer_->SetPrintLevel(-1);
+  beginStatistics(svFitStandalone::Statistics::kFit);
 
   // setup the function to be called and the dimension of the fit
-  ROOT::Math::Functor toMinimize(standaloneObjectiveFunctionAdapterMINUIT_, nll_->measuredTauLeptons().size()*svFitStandalone::kMaxFitParams);
-  minimizer_->SetFunction(toMinimize);
-  setup();
-  minimizer_->SetMaxFunctionCalls(maxObjFunctionCalls_);
-
-  // set Minuit strategy = 2, in order to get reliable error estimates:
-  // http://www-cdf.fnal.gov/physics/statistics/recommendations/minuit.html
-  minimizer_->SetStrategy(2);
+  unsigned int nDim = nll_->measuredTauLeptons().size()*svFitStandalone::kMaxFitParams;
+  svFitStandalone::ObjectiveFunctionAdapterMINUITGradient toMinimizeWithGradient(nDim);
+  ROOT::Math::Functor toMinimizeWithoutGradient(standaloneObjectiveFunctionAdapterMINUIT_, nDim);
+  const ROOT::Math::IMultiGenFunction& toMinimize = ( useAnalyticGradient_ ) ?
+    static_cast<const ROOT::Math::IMultiGenFunction&>(toMinimizeWithGradient) : static_cast<const ROOT::Math::IMultiGenFunction&>(toMinimizeWithoutGradient);
 
-  // compute uncertainties for increase of objective function by 0.5 wrt.
-  // minimum (objective function is log-likelihood function)
-  minimizer_->SetErrorDef(0.5);
-
-  // do the minimization
   nll_->addDelta(false);
   nll_->addSinTheta(true);
   nll_->requirePhysicalSolution(false);
-  minimizer_->Minimize();
 
-  /* get Minimizer status code, check if solution is valid:
+  const double* x = 0;
+  const double* xErr = 0;
+  if ( useMinuit_ ) {
+    // instantiate minuit on first use, the arguments might turn into configurables once
+    if ( !minimizer_ ) minimizer_ = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
 
-     0: Valid solution
-     1: Covariance matrix was made positive definite
-     2: Hesse matrix is invalid
-     3: Estimated distance to minimum (EDM) is above maximum
-     4: Reached maximum number of function calls before reaching convergence
-     5: Any other failure
-  */
-  fitStatus_ = minimizer_->Status();
+    // clear minimizer
+    minimizer_->Clear();
+
+    // set verbosity level of minimizer
+    minimizer_->SetPrintLevel(-1);
+
+    minimizer_->SetFunction(toMinimize);
+    setup();
+    minimizer_->SetMaxFunctionCalls(maxObjFunctionCalls_);
+
+    // set Minuit strategy = 2, in order to get reliable error estimates:
+    // http://www-cdf.fnal.gov/physics/statistics/recommendations/minuit.html
+    minimizer_->SetStrategy(2);
+
+    // compute uncertainties for increase of objective function by 0.5 wrt.
+    // minimum (objective function is log-likelihood function)
+    minimizer_->SetErrorDef(0.5);
+
+    // do the minimization
+    minimizer_->Minimize();
+
+    /* get Minimizer status code, check if solution is valid:
+
+       0: Valid solution
+       1: Covariance matrix was made positive definite
+       2: Hesse matrix is invalid
+       3: Estimated distance to minimum (EDM) is above maximum
+       4: Reached maximum number of function calls before reaching convergence
+       5: Any other failure
+    */
+    fitStatus_ = minimizer_->Status();
+    x = minimizer_->X();
+    xErr = minimizer_->Errors();
+  } else {
+    minimizerBFGS_.clear();
+    setup();
+    minimizerBFGS_.setMaxFunctionCalls(maxObjFunctionCalls_);
+    minimizerBFGS_.setErrorDef(0.5);
+    minimizerBFGS_.minimize(toMinimize);
+    // status codes follow the same convention as for Minuit
+    fitStatus_ = minimizerBFGS_.status();
+    x = minimizerBFGS_.X();
+    xErr = minimizerBFGS_.Errors();
+  }
 
   // and write out the result
   using svFitStandalone::kXFrac;
@@ -319,14 +426,16 @@ SVfitStandaloneAlgorithm::fit()
   using svFitStandalone::kPhi;
   using svFitStandalone::kMaxFitParams;
   // update di-tau system with final fit results
-  nll_->results(fittedTauLeptons_, minimizer_->X());
+  nll_->results(fittedTauLeptons_, x);
   // determine uncertainty of the fitted di-tau mass
-  double x1RelErr = minimizer_->Errors()[kXFrac]/minimizer_->X()[kXFrac];
-  double x2RelErr = minimizer_->Errors()[kMaxFitParams + kXFrac]/minimizer_->X()[kMaxFitParams + kXFrac];
+  double x1RelErr = xErr[kXFrac]/x[kXFrac];
+  double x2RelErr = xErr[kMaxFitParams + kXFrac]/x[kMaxFitParams + kXFrac];
   // this gives a unified treatment for retrieving the result for integration mode and fit mode
   fittedDiTauSystem_ = fittedTauLeptons_[0] + fittedTauLeptons_[1];
   mass_ = fittedDiTauSystem_.mass();
   massUncert_ = TMath::Sqrt(0.25*x1RelErr*x1RelErr + 0.25*x2RelErr*x2RelErr)*mass_;
+
+  endStatistics();
 }
 
 void
@@ -336,19 +445,19 @@ SVfitStandaloneAlgorithm::integrateVEGAS(const std::string& likelihoodFileName)
 
   if ( verbosity_ >= 1 ) {
     std::cout << "<SVfitStandaloneAlgorithm::integrateVEGAS>:" << std::endl;
-    clock_->Start("<SVfitStandaloneAlgorithm::integrateVEGAS>");
   }
+  bool isStatistics = beginStatistics(Statistics::kIntegrateVEGAS);
 
   // number of parameters for fit
   int nDim = 0;
   l1isLep_ = false;
   l2isLep_ = false;
-  const TH1* l1lutVisMass = 0;
-  const TH1* l1lutVisMassRes = 0;
-  const TH1* l1lutVisPtRes = 0;
-  const TH1* l2lutVisMass = 0;
-  const TH1* l2lutVisMassRes = 0;
-  const TH1* l2lutVisPtRes = 0;
+  const svFitStandalone::LookupTable* l1lutVisMass = 0;
+  const svFitStandalone::LookupTable* l1lutVisMassRes = 0;
+  const svFitStandalone::LookupTable* l1lutVisPtRes = 0;
+  const svFitStandalone::LookupTable* l2lutVisMass = 0;
+  const svFitStandalone::LookupTable* l2lutVisMassRes = 0;
+  const svFitStandalone::LookupTable* l2lutVisPtRes = 0;
   for ( size_t idx = 0; idx < nll_->measuredTauLeptons().size(); ++idx ) {
     const MeasuredTauLepton& measuredTauLepton = nll_->measuredTauLeptons()[idx];
     if ( idx == 0 ) {
@@ -454,9 +563,9 @@ SVfitStandaloneAlgorithm::integrateVEGAS(const std::string& likelihoodFileName)
      the reason why the measuredLeptons are eventually re-ordered in the constructor of
      this class before passing them on to SVfitStandaloneLikelihood.
   */
-  double* x0 = new double[nDim];
-  double* xl = new double[nDim];
-  double* xh = new double[nDim];
+  double* x0 = new double[nDim + 1]; // NOTE: last element used for log(mtest) in case of integrateOverMass_
+  double* xl = new double[nDim + 1];
+  double* xh = new double[nDim + 1];
   if ( l1isLep_ ) {
     x0[idxFitParLeg1_ + 0] = 0.5;
     xl[idxFitParLeg1_ + 0] = 0.0;
@@ -530,9 +639,15 @@ SVfitStandaloneAlgorithm::integrateVEGAS(const std::string& likelihoodFileName)
   std::vector<double> yErrGraph;
 
   // integrator instance
-  ROOT::Math::GSLMCIntegrator ig2("vegas", 0., 1.e-6, 10000);
-  //ROOT::Math::GSLMCIntegrator ig2("vegas", 0., 1.e-6, 2000);
-  ROOT::Math::Functor toIntegrate(standaloneObjectiveFunctionAdapterVEGAS_, &ObjectiveFunctionAdapterVEGAS::Eval, nDim);
+  //   5 iterations with 10000 integrand evaluations each, 
+  //   corresponding to the previously used ROOT::Math::GSLMCIntegrator("vegas", 0., 1.e-6, 10000)
+  if ( !integratorVEGAS_ ) {
+    standaloneObjectiveFunctionAdapterVEGAS_ = new svFitStandalone::ObjectiveFunctionAdapterVEGAS();
+    massHistogramAdapterVEGAS_ = new svFitStandalone::MassHistogramAdapterVEGAS();
+    integratorVEGAS_ = new SVfitStandaloneVEGASIntegrator(10000, 5, 50, 1.5, verbosity_);
+  }
+  integratorVEGAS_->setSeed(randomSeed_);
+  standaloneObjectiveFunctionAdapterVEGAS_->SetLikelihood(nll_);
   standaloneObjectiveFunctionAdapterVEGAS_->SetL1isLep(l1isLep_);
   standaloneObjectiveFunctionAdapterVEGAS_->SetL2isLep(l2isLep_);
   if ( marginalizeVisMass_ && shiftVisMass_ ) {
@@ -542,7 +657,6 @@ SVfitStandaloneAlgorithm::integrateVEGAS(const std::string& likelihoodFileName)
   standaloneObjectiveFunctionAdapterVEGAS_->SetMarginalizeVisMass(marginalizeVisMass_ && (l1lutVisMass || l2lutVisMass));
   standaloneObjectiveFunctionAdapterVEGAS_->SetShiftVisMass(shiftVisMass_ && (l1lutVisMassRes || l2lutVisMassRes));
   standaloneObjectiveFunctionAdapterVEGAS_->SetShiftVisPt(shiftVisPt_ && (l1lutVisPtRes || l2lutVisPtRes));
-  ig2.SetFunction(toIntegrate);
   nll_->addDelta(true);
   nll_->addSinTheta(false);
   nll_->addPhiPenalty(false);
@@ -550,52 +664,184 @@ SVfitStandaloneAlgorithm::integrateVEGAS(const std::string& likelihoodFileName)
   nll_->shiftVisMass(shiftVisMass_ && (l1lutVisMassRes || l2lutVisMassRes), l1lutVisMassRes, l2lutVisMassRes);
   nll_->shiftVisPt(shiftVisPt_ && (l1lutVisPtRes || l2lutVisPtRes), l1lutVisPtRes, l2lutVisPtRes);
   nll_->requirePhysicalSolution(true);
+  double mvis = measuredDiTauSystem().mass();
+  standaloneObjectiveFunctionAdapterVEGAS_->SetMvis(mvis);
+  // in case integrateOverMass_ is enabled, log(mtest) is treated as additional integration variable 
+  // and the mass distribution is filled during the last VEGAS iteration, replacing the scan over mass hypotheses
+  int nDimIntegration = nDim;
+  if ( integrateOverMass_ ) {
+    x0[nDim] = TMath::Log(mvis);
+    xl[nDim] = TMath::Log(mvis);
+    xh[nDim] = TMath::Log(maxMass);
+    ++nDimIntegration;
+  }
+  standaloneObjectiveFunctionAdapterVEGAS_->SetNDim(nDimIntegration);
+  standaloneObjectiveFunctionAdapterVEGAS_->SetIntegrateOverMass(integrateOverMass_);
+  massHistogramAdapterVEGAS_->SetNDim(nDimIntegration);
+  integratorVEGAS_->setIntegrand(*standaloneObjectiveFunctionAdapterVEGAS_);
+  long numVEGASPoints = integratorVEGAS_->numIntegrandCalls();
   int count = 0;
   double pMax = 0.;
-  double mvis = measuredDiTauSystem().mass();
-  double mtest = mvis*1.0125;
-  bool skiphighmasstail = false;
-  for ( int i = 0; i < 100 && (!skiphighmasstail); ++i ) {
-  //-----------------------------------------------------------------------------
-  // !!! ONLY FOR TESTING
-  //for ( int i = 0; i < 1 && (!skiphighmasstail); ++i ) {
-  //  mtest = 3200.;
-  //     FOR TESTING ONLY !!!
-  //-----------------------------------------------------------------------------
-    standaloneObjectiveFunctionAdapterVEGAS_->SetMvis(mvis);
-    standaloneObjectiveFunctionAdapterVEGAS_->SetMtest(mtest);
-    double p = ig2.Integral(xl, xh);
-    double pErr = ig2.Error();
+  if ( integrateOverMass_ ) {
+    // 5 iterations with 20000 integrand evaluations each, the last of which is used to fill the mass distribution
+    // the call-back function is registered for this integration only,
+    // as it disables the early stopping of the integrations in the scan over mass hypotheses
+    massHistogramAdapterVEGAS_->SetHistogram(histogramMass);
+    integratorVEGAS_->registerCallBackFunction(*massHistogramAdapterVEGAS_);
+    integratorVEGAS_->setNumCalls(scaleNumCalls(20000), 5);
+    integratorVEGAS_->setTargetRelErr(-1.);
+    double pErr = 0.;
+    integratorVEGAS_->integrate(xl, xh, pMax, pErr);
+    integratorVEGAS_->unregisterCallBackFunction(*massHistogramAdapterVEGAS_);
+    massHistogramAdapterVEGAS_->SetHistogram(0);
     if ( verbosity_ >= 2 ) {
-      std::cout << "--> scan idx = " << i << ": mtest = " << mtest << ", p = " << p << " +/- " << pErr << " (pMax = " << pMax << ")" << std::endl;
+      std::cout << "--> integral over mass = " << pMax << " +/- " << pErr << std::endl;
     }
-    if ( p > pMax ) {
-      mass_ = mtest;
-      pMax  = p;
-      count = 0;
-    } else {
-      if ( p < (1.e-3*pMax) ) {
-        ++count;
-        if ( count>= 5 ) {
-          skiphighmasstail = true;
+    int numBins = histogramMass->GetNbinsX();
+    for ( int iBin = 1; iBin <= numBins; ++iBin ) {
+      double binContent = histogramMass->GetBinContent(iBin);
+      if ( !(binContent > 0.) ) continue;
+      double binWidth = histogramMass->GetBinWidth(iBin);
+      xGraph.push_back(histogramMass->GetBinCenter(iBin));
+      xErrGraph.push_back(0.5*binWidth);
+      yGraph.push_back(binContent/binWidth);
+      yErrGraph.push_back(histogramMass->GetBinError(iBin)/binWidth);
+    }
+  } else {
+    // mass hypotheses are scanned in steps of 2.5%, starting at the visible mass
+    const int numMassPoints = 100;
+    std::vector<double> mtests(numMassPoints);
+    double mtest = mvis*1.0125;
+    for ( int i = 0; i < numMassPoints; ++i ) {
+      mtests[i] = mtest;
+      mtest += 0.025*mtest;
+    }
+    // coarse pass: integrate every 4th mass hypothesis with a reduced number of integrand evaluations, 
+    // in order to find the mass range in which the likelihood is non-negligible. 
+    // The coarse pass stops once the likelihood drops below 1.e-3 of its maximum for 2 consecutive points.
+    // The last mass hypothesis is always included in the coarse pass
+    const int coarseStep = 4;
+    const unsigned numCallsCoarse = scaleNumCalls(2000);
+    const unsigned numIterationsCoarse = 3;
+    std::vector<int> coarsePoints;
+    for ( int i = 0; i < numMassPoints - 1; i += coarseStep ) {
+      coarsePoints.push_back(i);
+    }
+    coarsePoints.push_back(numMassPoints - 1);
+    std::vector<double> pCoarse(numMassPoints, 0.);
+    std::vector<double> pErrCoarse(numMassPoints, 0.);
+    std::vector<bool> isCoarse(numMassPoints, false);
+    double pMaxCoarse = 0.;
+    bool isWarmGrid = false;
+    Statistics::Clock::time_point time;
+    if ( isStatistics ) time = Statistics::Clock::now();
+    integratorVEGAS_->setNumCalls(numCallsCoarse, numIterationsCoarse);
+    integratorVEGAS_->setTargetRelErr(-1.);
+    for ( size_t iCoarse = 0; iCoarse < coarsePoints.size(); ++iCoarse ) {
+      int i = coarsePoints[iCoarse];
+      standaloneObjectiveFunctionAdapterVEGAS_->SetMtest(mtests[i]);
+      integratorVEGAS_->integrate(xl, xh, pCoarse[i], pErrCoarse[i], !isWarmGrid);
+      isCoarse[i] = true;
+      if ( isStatistics ) ++statistics_.numMassPointsCoarse;
+      if ( pCoarse[i] > 0. ) isWarmGrid = true;
+      if ( verbosity_ >= 2 ) {
+        std::cout << "--> coarse scan idx = " << i << ": mtest = " << mtests[i] << ", p = " << pCoarse[i] << " +/- " << pErrCoarse[i] 
+  		<< " (pMax = " << pMaxCoarse << ")" << std::endl;
+      }
+      if ( pCoarse[i] > pMaxCoarse ) {
+        pMaxCoarse = pCoarse[i];
+        count = 0;
+      } else {
+        if ( pCoarse[i] < (1.e-3*pMaxCoarse) ) {
+          ++count;
+          if ( count >= 2 ) break;
+        } else {
+          count = 0;
         }
+      }
+    }
+    if ( isStatistics ) statistics_.timeVEGASCoarse = Statistics::elapsed(time);
+    // main pass: every mass hypothesis is integrated, with the full number of integrand evaluations in case the likelihood of 
+    // one of the neighbouring coarse points exceeds 1.e-2 of the maximum and with the reduced number of integrand evaluations otherwise 
+    // (the result of the coarse pass is used for coarse points). The scan stops once the likelihood drops below 1.e-3 of its maximum 
+    // for 5 consecutive mass hypotheses, as in the scan without coarse pass.
+    // Consecutive mass hypotheses differ by 2.5% only, so the importance grid adapted for one mass hypothesis is a good starting point 
+    // for the next one. The first mass hypothesis with non-zero likelihood that is integrated with the full number of integrand evaluations
+    // starts from a uniform grid and is integrated with the full number of iterations; the relative uncertainty reached for this mass hypothesis 
+    // is used as target for all subsequent ones
+    std::vector<double> ps(numMassPoints, 0.);
+    std::vector<double> pErrs(numMassPoints, 0.);
+    bool hasTargetRelErr = false;
+    double targetRelErr = -1.;
+    isWarmGrid = false;
+    count = 0;
+    for ( int i = 0; i < numMassPoints; ++i ) {
+      int iCoarseLow = (i/coarseStep)*coarseStep;
+      int iCoarseHigh = TMath::Min(iCoarseLow + coarseStep, numMassPoints - 1);
+      bool isRefined = ( pMaxCoarse > 0. && TMath::Max(pCoarse[iCoarseLow], pCoarse[iCoarseHigh]) >= (1.e-2*pMaxCoarse) );
+      if ( !isRefined && isCoarse[i] ) {
+        ps[i] = pCoarse[i];
+        pErrs[i] = pErrCoarse[i];
+        isWarmGrid = false;
+        if ( isStatistics ) ++statistics_.numMassPointsReduced;
       } else {
+        standaloneObjectiveFunctionAdapterVEGAS_->SetMtest(mtests[i]);
+        if ( isRefined ) {
+          integratorVEGAS_->setNumCalls(scaleNumCalls(10000), 5);
+          integratorVEGAS_->setTargetRelErr(( hasTargetRelErr ) ? targetRelErr : -1., 2);
+          integratorVEGAS_->integrate(xl, xh, ps[i], pErrs[i], !(isWarmGrid && hasTargetRelErr));
+          if ( ps[i] > 0. && !hasTargetRelErr ) {
+            targetRelErr = pErrs[i]/ps[i];
+            hasTargetRelErr = true;
+          }
+          if ( isStatistics ) ++statistics_.numMassPointsFine;
+        } else {
+          integratorVEGAS_->setNumCalls(numCallsCoarse, numIterationsCoarse);
+          integratorVEGAS_->setTargetRelErr(-1.);
+          integratorVEGAS_->integrate(xl, xh, ps[i], pErrs[i], !isWarmGrid);
+          if ( isStatistics ) ++statistics_.numMassPointsReduced;
+        }
+        isWarmGrid = ( ps[i] > 0. );
+      }
+      if ( verbosity_ >= 2 ) {
+        std::cout << "--> scan idx = " << i << ": mtest = " << mtests[i] << ", p = " << ps[i] << " +/- " << pErrs[i] << " (pMax = " << pMax << ",";
+        if ( isRefined ) std::cout << " #iterations = " << integratorVEGAS_->numIterationsDone() << ")" << std::endl;
+        else std::cout << " reduced number of integrand evaluations)" << std::endl;
+      }
+      bool skiphighmasstail = false;
+      if ( ps[i] > pMax ) {
+        mass_ = mtests[i];
+        pMax  = ps[i];
         count = 0;
+      } else {
+        if ( ps[i] < (1.e-3*pMax) ) {
+          ++count;
+          if ( count >= 5 ) {
+            skiphighmasstail = true;
+          }
+        } else {
+          count = 0;
+        }
       }
+      double mtest_step = 0.025*mtests[i];
+      int bin = histogramMass->FindBin(mtests[i]);
+      histogramMass->SetBinContent(bin, ps[i]*mtest_step);
+      histogramMass->SetBinError(bin, pErrs[i]*mtest_step);
+      xGraph.push_back(mtests[i]);
+      xErrGraph.push_back(0.5*mtest_step);
+      yGraph.push_back(ps[i]);
+      yErrGraph.push_back(pErrs[i]);
+      if ( skiphighmasstail ) break;
     }
-    double mtest_step = 0.025*mtest;
-    int bin = histogramMass->FindBin(mtest);
-    histogramMass->SetBinContent(bin, p*mtest_step);
-    histogramMass->SetBinError(bin, pErr*mtest_step);
-    xGraph.push_back(mtest);
-    xErrGraph.push_back(0.5*mtest_step);
-    yGraph.push_back(p);
-    yErrGraph.push_back(pErr);
-    mtest += mtest_step;
-  }
-  //mass_ = extractValue(histogramMass);
-  massUncert_ = extractUncertainty(histogramMass);
-  massLmax_ = extractLmax(histogramMass);
+    if ( isStatistics ) statistics_.timeVEGASFine = Statistics::elapsed(time);
+  }
+  if ( isStatistics ) statistics_.numVEGASPoints = integratorVEGAS_->numIntegrandCalls() - numVEGASPoints;
+  HistogramSummary histogramMassSummary;
+  extractHistogramSummary(histogramMass, histogramMassSummary);
+  if ( integrateOverMass_ ) mass_ = ( pMax > 0. ) ? histogramMassSummary.value() : 0.;
+  //else mass_ = histogramMassSummary.value();
+  massUncert_ = histogramMassSummary.uncertainty();
+  massLmax_ = histogramMassSummary.Lmax;
   fitStatus_ = ( massLmax_ > 0. ) ? 0 : 1;
   if ( verbosity_ >= 1 ) {
     std::cout << "--> mass  = " << mass_  << " +/- " << massUncert_ << std::endl;
@@ -616,14 +862,17 @@ SVfitStandaloneAlgorithm::integrateVEGAS(const std::string& likelihoodFileName)
     delete likelihoodFile;
     delete likelihoodGraph;
   }
+  if ( outputSink_ ) {
+    outputEvent_.clear();
+    outputEvent_.addGraph("svFitLikelihoodGraph", xGraph.size(), xGraph.data(), yGraph.data(), xErrGraph.data(), yErrGraph.data());
+    outputSink_->write(outputEvent_);
+  }
 
   delete[] x0;
   delete[] xl;
   delete[] xh;
 
-  if ( verbosity_ >= 1 ) {
-    clock_->Show("<SVfitStandaloneAlgorithm::integrateVEGAS>");
-  }
+  endStatistics();
 }
 
 void
@@ -633,8 +882,8 @@ SVfitStandaloneAlgorithm::integrateMarkovChain(const std::string& likelihoodFile
 
   if ( verbosity_ >= 1 ) {
     std::cout << "<SVfitStandaloneAlgorithm::integrateMarkovChain>:" << std::endl;
-    clock_->Start("<SVfitStandaloneAlgorithm::integrateMarkovChain>");
   }
+  bool isStatistics = beginStatistics(Statistics::kIntegrateMarkovChain);
   if ( isInitialized2_ ) {
     mcQuantitiesAdapter_->Reset();
   } else {
@@ -665,20 +914,28 @@ SVfitStandaloneAlgorithm::integrateMarkovChain(const std::string& likelihoodFile
     integrator2_->registerCallBackFunction(*mcQuantitiesAdapter_);
     isInitialized2_ = true;
   }
+  unsigned numIterSampling = scaleNumCalls(maxObjFunctionCalls2_);
+  integrator2_->setNumIterations(TMath::Nint(0.10*numIterSampling), numIterSampling, TMath::Nint(0.02*numIterSampling), TMath::Nint(0.06*numIterSampling));
+  // scale alpha together with the length of the simulated annealing stage, 
+  // so that the temperature decreases by the same factor during the second phase for any number of iterations
+  integrator2_->setSimAnnealingAlpha(1.0 - 1.e+2/TMath::Max(numIterSampling, 200u));
+  integrator2_->setSeed(randomSeed_);
 
   mcQuantitiesAdapter_->SetMeasurements(measuredTauLeptons(), measuredMET());
   mcQuantitiesAdapter_->SetHistograms(measuredTauLeptons(), measuredMET());
+  mcQuantitiesAdapter_->SetKeepSamples(keepMarkovChainSamples_);
+  if ( keepMarkovChainSamples_ ) mcQuantitiesAdapter_->SetPosteriorConfiguration(posteriorConfiguration());
 
   // number of parameters for fit
   int nDim = 0;
   l1isLep_ = false;
   l2isLep_ = false;
-  const TH1* l1lutVisMass = 0;
-  const TH1* l1lutVisMassRes = 0;
-  const TH1* l1lutVisPtRes = 0;
-  const TH1* l2lutVisMass = 0;
-  const TH1* l2lutVisMassRes = 0;
-  const TH1* l2lutVisPtRes = 0;
+  const svFitStandalone::LookupTable* l1lutVisMass = 0;
+  const svFitStandalone::LookupTable* l1lutVisMassRes = 0;
+  const svFitStandalone::LookupTable* l1lutVisPtRes = 0;
+  const svFitStandalone::LookupTable* l2lutVisMass = 0;
+  const svFitStandalone::LookupTable* l2lutVisMassRes = 0;
+  const svFitStandalone::LookupTable* l2lutVisPtRes = 0;
   for ( size_t idx = 0; idx < nll_->measuredTauLeptons().size(); ++idx ) {
     const MeasuredTauLepton& measuredTauLepton = nll_->measuredTauLeptons()[idx];
     if ( idx == 0 ) {
@@ -887,7 +1144,11 @@ SVfitStandaloneAlgorithm::integrateMarkovChain(const std::string& likelihoodFile
   double integral = 0.;
   double integralErr = 0.;
   int errorFlag = 0;
+  integrator2_->setSampleCallBackFunction(markovChainSampleFile_);
+  integrator2_->setStatistics(( isStatistics ) ? &statistics_ : 0);
+  if ( markovChainSampleFile_ ) markovChainSampleFile_->beginEvent(nDim);
   integrator2_->integrate(xl, xh, integral, integralErr, errorFlag);
+  if ( markovChainSampleFile_ ) markovChainSampleFile_->endEvent();
   fitStatus_ = errorFlag;
   /* Not any longer defined in this general way; access your fit results directly from the mcQuantitiesAdapter_
   mass_ = mcQuantitiesAdapter_->getMass();
@@ -897,16 +1158,25 @@ SVfitStandaloneAlgorithm::integrateMarkovChain(const std::string& likelihoodFile
   transverseMassUncert_ = mcQuantitiesAdapter_->getTransverseMassUncert();
   transverseMassLmax_ = mcQuantitiesAdapter_->getTransverseMassLmax();
   */
-  if ( !(massLmax_ > 0.) ) fitStatus_ = 1;
+  // the maximum of the mass distribution is available only in case the default adapter is used,
+  // which provides the mass of the di-tau system as one of its quantities
+  const MCPtEtaPhiMassAdapter* mcPtEtaPhiMassAdapter = dynamic_cast<const MCPtEtaPhiMassAdapter*>(mcQuantitiesAdapter_);
+  if ( mcPtEtaPhiMassAdapter ) {
+    massLmax_ = mcPtEtaPhiMassAdapter->getMassLmax();
+    if ( !(massLmax_ > 0.) ) fitStatus_ = 1;
+  }
   if ( likelihoodFileName != "" ) {
     TFile* likelihoodFile = new TFile(likelihoodFileName.data(), "RECREATE");
     mcQuantitiesAdapter_->WriteHistograms();
     delete likelihoodFile;
   }
-
-  if ( verbosity_ >= 1 ) {
-    clock_->Show("<SVfitStandaloneAlgorithm::integrateMarkovChain>");
+  if ( outputSink_ ) {
+    outputEvent_.clear();
+    mcQuantitiesAdapter_->WriteHistograms(outputEvent_);
+    outputSink_->write(outputEvent_);
   }
+
+  endStatistics();
 }
 void SVfitStandaloneAlgorithm::setMCQuantitiesAdapter(svFitStandalone::MCQuantitiesAdapter* mcQuantitiesAdapter)
 {
@@ -917,3 +1187,40 @@ svFitStandalone::MCQuantitiesAdapter* SVfitStandaloneAlgorithm::getMCQuantitiesA
 {
   return mcQuantitiesAdapter_;
 }
+
+svFitStandalone::PosteriorConfiguration
+SVfitStandaloneAlgorithm::posteriorConfiguration() const
+{
+  svFitStandalone::PosteriorConfiguration config;
+  config.metPower = nll_->metPower();
+  config.powerLogM = nll_->powerLogM();
+  config.measuredMET = measuredMET_rounded_;
+  config.covMET = covMET_rounded_;
+  return config;
+}
+
+bool
+SVfitStandaloneAlgorithm::reweightMarkovChain(const svFitStandalone::PosteriorConfiguration& config, double minRelEffectiveSampleSize)
+{
+  if ( mcQuantitiesAdapter_ && mcQuantitiesAdapter_->GetNSamples() > 0 ) {
+    if ( mcQuantitiesAdapter_->Reweight(config, minRelEffectiveSampleSize) ) return true;
+    if ( verbosity_ >= 1 ) {
+      std::cout << "<SVfitStandaloneAlgorithm::reweightMarkovChain>: effective sample size too small, running Markov Chain again." << std::endl;
+    }
+  }
+  // changes of the configuration that cannot be handled by reweighting (or reweighting without kept samples) 
+  // require to run the Markov Chain integration with the modified likelihood.
+  // The configuration of the likelihood is restored afterwards, so that the next event is processed as before
+  svFitStandalone::PosteriorConfiguration previousConfig = posteriorConfiguration();
+  nll_->metPower(config.metPower);
+  nll_->addLogM(config.powerLogM > 0., config.powerLogM);
+  std::vector<MeasuredTauLepton> measuredTauLeptons = measuredTauLeptons_rounded_;
+  reset(measuredTauLeptons, config.measuredMET.x(), config.measuredMET.y(), config.covMET);
+  integrateMarkovChain();
+  nll_->metPower(previousConfig.metPower);
+  nll_->addLogM(previousConfig.powerLogM > 0., previousConfig.powerLogM);
+  measuredMET_rounded_ = previousConfig.measuredMET;
+  covMET_rounded_ = previousConfig.covMET;
+  nll_->reset(measuredTauLeptons_rounded_, measuredMET_rounded_, covMET_rounded_);
+  return false;
+}
@@ -0,0 +1,379 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneBatchAlgorithm.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
+
+#include <TMath.h>
+#include <TFile.h>
+
+#include <algorithm>
+
+void
+svFitStandalone::BatchResults::resize(size_t numEvents)
+{
+  mass.resize(numEvents);
+  massUncert.resize(numEvents);
+  massLmax.resize(numEvents);
+  transverseMass.resize(numEvents);
+  transverseMassUncert.resize(numEvents);
+  transverseMassLmax.resize(numEvents);
+  fitStatus.resize(numEvents);
+  nllStatus.resize(numEvents);
+  isValidSolution.resize(numEvents);
+}
+
+void
+svFitStandalone::BatchResults::get(size_t idx, CachedResult& result) const
+{
+  result.mass = mass[idx];
+  result.massUncert = massUncert[idx];
+  result.massLmax = massLmax[idx];
+  result.transverseMass = transverseMass[idx];
+  result.transverseMassUncert = transverseMassUncert[idx];
+  result.transverseMassLmax = transverseMassLmax[idx];
+  result.fitStatus = fitStatus[idx];
+  result.nllStatus = nllStatus[idx];
+  result.isValidSolution = isValidSolution[idx];
+}
+
+void
+svFitStandalone::BatchResults::set(size_t idx, const CachedResult& result)
+{
+  mass[idx] = result.mass;
+  massUncert[idx] = result.massUncert;
+  massLmax[idx] = result.massLmax;
+  transverseMass[idx] = result.transverseMass;
+  transverseMassUncert[idx] = result.transverseMassUncert;
+  transverseMassLmax[idx] = result.transverseMassLmax;
+  fitStatus[idx] = result.fitStatus;
+  nllStatus[idx] = result.nllStatus;
+  isValidSolution[idx] = result.isValidSolution;
+}
+
+SVfitStandaloneBatchAlgorithm::SVfitStandaloneBatchAlgorithm(Mode mode, unsigned int verbosity)
+  : mode_(mode),
+    verbosity_(verbosity),
+    addLogM_(false),
+    powerLogM_(1.),
+    metPower_(1.),
+    marginalizeVisMass_(false),
+    lutVisMassAllDMs_(0),
+    lutVisMassAllDMs_owned_(0),
+    shiftVisMass_(false),
+    inputFileVisMassRes_(0),
+    shiftVisPt_(false),
+    inputFileVisPtRes_(0),
+    maxObjFunctionCalls_(10000),
+    integrateOverMass_(false),
+    useStreamingEstimators_(false),
+    variationSampleFraction_(1.),
+    isConfigurationChanged_(false),
+    resultCache_(0),
+    measuredTauLeptons_(2),
+    covMET_(2,2)
+{
+  for ( unsigned iChannel = 0; iChannel < kNumChannels; ++iChannel ) {
+    algorithms_[iChannel] = 0;
+  }
+}
+
+SVfitStandaloneBatchAlgorithm::~SVfitStandaloneBatchAlgorithm()
+{
+  for ( unsigned iChannel = 0; iChannel < kNumChannels; ++iChannel ) {
+    delete algorithms_[iChannel];
+  }
+  delete lutVisMassAllDMs_owned_;
+}
+
+void
+SVfitStandaloneBatchAlgorithm::marginalizeVisMass(bool value, const TH1* lut)
+{
+  marginalizeVisMass_ = value;
+  // convert the histogram once, instead of once per event in SVfitStandaloneAlgorithm::marginalizeVisMass
+  delete lutVisMassAllDMs_owned_;
+  lutVisMassAllDMs_owned_ = ( lut ) ? new svFitStandalone::LookupTable(lut) : 0;
+  lutVisMassAllDMs_ = lutVisMassAllDMs_owned_;
+  isConfigurationChanged_ = true;
+}
+
+void
+SVfitStandaloneBatchAlgorithm::setMeasurements(const svFitStandalone::BatchEvent& event)
+{
+  measuredTauLeptons_[0] = MeasuredTauLepton(event.leg1Type, event.leg1Pt, event.leg1Eta, event.leg1Phi, event.leg1Mass, event.leg1DecayMode);
+  measuredTauLeptons_[1] = MeasuredTauLepton(event.leg2Type, event.leg2Pt, event.leg2Eta, event.leg2Phi, event.leg2Mass, event.leg2DecayMode);
+  covMET_[0][0] = event.covMET00;
+  covMET_[0][1] = event.covMET01;
+  covMET_[1][0] = event.covMET10;
+  covMET_[1][1] = event.covMET11;
+}
+
+void
+SVfitStandaloneBatchAlgorithm::configure(SVfitStandaloneAlgorithm& algorithm) const
+{
+  algorithm.addLogM(addLogM_, powerLogM_);
+  algorithm.metPower(metPower_);
+  if ( marginalizeVisMass_ ) algorithm.marginalizeVisMass(true, lutVisMassAllDMs_);
+  if ( shiftVisMass_ ) algorithm.shiftVisMass(true, inputFileVisMassRes_);
+  if ( shiftVisPt_ ) algorithm.shiftVisPt(true, inputFileVisPtRes_);
+  algorithm.maxObjFunctionCalls(maxObjFunctionCalls_);
+  algorithm.integrateOverMass(integrateOverMass_);
+  if ( mode_ == kIntegrateMarkovChain && useStreamingEstimators_ ) {
+    svFitStandalone::MCPtEtaPhiMassAdapter* mcQuantitiesAdapter = new svFitStandalone::MCPtEtaPhiMassAdapter();
+    mcQuantitiesAdapter->SetUseStreamingEstimators(true);
+    algorithm.setMCQuantitiesAdapter(mcQuantitiesAdapter);
+  }
+}
+
+void
+SVfitStandaloneBatchAlgorithm::fillResults(const SVfitStandaloneAlgorithm& algorithm, size_t idx, svFitStandalone::BatchResults& results) const
+{
+  if ( mode_ == kIntegrateMarkovChain ) {
+    const svFitStandalone::MCPtEtaPhiMassAdapter* mcQuantitiesAdapter = static_cast<const svFitStandalone::MCPtEtaPhiMassAdapter*>(algorithm.getMCQuantitiesAdapter());
+    results.mass[idx] = mcQuantitiesAdapter->getMass();
+    results.massUncert[idx] = mcQuantitiesAdapter->getMassUncert();
+    results.massLmax[idx] = mcQuantitiesAdapter->getMassLmax();
+    results.transverseMass[idx] = mcQuantitiesAdapter->getTransverseMass();
+    results.transverseMassUncert[idx] = mcQuantitiesAdapter->getTransverseMassUncert();
+    results.transverseMassLmax[idx] = mcQuantitiesAdapter->getTransverseMassLmax();
+  } else {
+    results.mass[idx] = algorithm.mass();
+    results.massUncert[idx] = algorithm.massUncert();
+    results.massLmax[idx] = algorithm.massLmax();
+    results.transverseMass[idx] = algorithm.transverseMass();
+    results.transverseMassUncert[idx] = algorithm.transverseMassUncert();
+    results.transverseMassLmax[idx] = algorithm.transverseMassLmax();
+  }
+  results.fitStatus[idx] = algorithm.fitStatus();
+  results.nllStatus[idx] = algorithm.nllStatus();
+  results.isValidSolution[idx] = algorithm.isValidSolution();
+}
+
+namespace
+{
+  // increment whenever a change of the algorithm modifies its results, to invalidate results stored in existing cache files
+  const int resultCacheVersion = 1;
+
+  void addLeg(svFitStandalone::ResultCacheKey& key, const double* leg)
+  {
+    for ( int idx = 0; idx < 6; ++idx ) {
+      key.add(leg[idx]);
+    }
+  }
+}
+
+void
+SVfitStandaloneBatchAlgorithm::computeConfigurationKey()
+{
+  svFitStandalone::ResultCacheKey key;
+  key.add(resultCacheVersion);
+
+//--- configuration and mode;
+//    the look-up tables enter by their content, so that tables of the same name but different content give different keys
+  SVfitStandaloneLUTRegistry& registry = SVfitStandaloneLUTRegistry::instance();
+  const int decayModes[] = { 0, 1, 10 };
+  key.add((int)mode_);
+  key.add((int)addLogM_);
+  key.add(powerLogM_);
+  key.add(metPower_);
+  key.add((int)marginalizeVisMass_);
+  if ( marginalizeVisMass_ && lutVisMassAllDMs_ ) key.add(lutVisMassAllDMs_->checksum());
+  key.add((int)shiftVisMass_);
+  if ( shiftVisMass_ && inputFileVisMassRes_ ) {
+    for ( int iDecayMode = 0; iDecayMode < 3; ++iDecayMode ) {
+      key.add(registry.visMassRes(inputFileVisMassRes_, decayModes[iDecayMode])->checksum());
+    }
+  }
+  key.add((int)shiftVisPt_);
+  if ( shiftVisPt_ && inputFileVisPtRes_ ) {
+    for ( int iDecayMode = 0; iDecayMode < 3; ++iDecayMode ) {
+      key.add(registry.visPtRes(inputFileVisPtRes_, decayModes[iDecayMode])->checksum());
+    }
+  }
+  key.add((int)maxObjFunctionCalls_);
+  key.add((int)integrateOverMass_);
+  key.add((int)useStreamingEstimators_);
+  configurationKey_ = key;
+}
+
+svFitStandalone::ResultCacheKey
+SVfitStandaloneBatchAlgorithm::computeKey(const svFitStandalone::BatchEvent& event, double sampleFraction) const
+{
+  svFitStandalone::ResultCacheKey key = configurationKey_;
+  if ( sampleFraction != 1. ) key.add(sampleFraction);
+
+//--- measured quantities, rounded in the same way as by SVfitStandaloneAlgorithm;
+//    SVfitStandaloneAlgorithm sorts the two legs, so their order must not change the key
+  double leg1[6] = { (double)event.leg1Type, (double)event.leg1DecayMode, 
+		     svFitStandalone::roundToNdigits(event.leg1Pt), svFitStandalone::roundToNdigits(event.leg1Eta), 
+		     svFitStandalone::roundToNdigits(event.leg1Phi), svFitStandalone::roundToNdigits(event.leg1Mass) };
+  double leg2[6] = { (double)event.leg2Type, (double)event.leg2DecayMode, 
+		     svFitStandalone::roundToNdigits(event.leg2Pt), svFitStandalone::roundToNdigits(event.leg2Eta), 
+		     svFitStandalone::roundToNdigits(event.leg2Phi), svFitStandalone::roundToNdigits(event.leg2Mass) };
+  if ( std::lexicographical_compare(leg2, leg2 + 6, leg1, leg1 + 6) ) {
+    addLeg(key, leg2);
+    addLeg(key, leg1);
+  } else {
+    addLeg(key, leg1);
+    addLeg(key, leg2);
+  }
+  key.add(svFitStandalone::roundToNdigits(event.measuredMETx));
+  key.add(svFitStandalone::roundToNdigits(event.measuredMETy));
+  key.add(svFitStandalone::roundToNdigits(event.covMET00));
+  key.add(svFitStandalone::roundToNdigits(event.covMET01));
+  key.add(svFitStandalone::roundToNdigits(event.covMET10));
+  key.add(svFitStandalone::roundToNdigits(event.covMET11));
+  return key;
+}
+
+void
+SVfitStandaloneBatchAlgorithm::process(const svFitStandalone::BatchEvent& event, double sampleFraction, size_t idx, svFitStandalone::BatchResults& results)
+{
+  unsigned type1 = event.leg1Type;
+  unsigned type2 = event.leg2Type;
+  if ( type1 >= kNumDecayTypes || type2 >= kNumDecayTypes ) {
+    std::cerr << "<SVfitStandaloneBatchAlgorithm::process>:"
+	      << "Invalid decay types = { " << type1 << ", " << type2 << " } --> ABORTING !!\n";
+    assert(0);
+  }
+  // the order of the two legs does not matter, as SVfitStandaloneAlgorithm sorts them
+  unsigned channel = TMath::Min(type1, type2)*kNumDecayTypes + TMath::Max(type1, type2);
+  setMeasurements(event);
+  // recreate the algorithms in case the configuration has changed, 
+  // as options cannot be reverted in an existing algorithm (e.g. the MC quantities adapter used for streaming estimators)
+  if ( isConfigurationChanged_ ) {
+    for ( unsigned iChannel = 0; iChannel < kNumChannels; ++iChannel ) {
+      delete algorithms_[iChannel];
+      algorithms_[iChannel] = 0;
+    }
+    isConfigurationChanged_ = false;
+  }
+  SVfitStandaloneAlgorithm*& algorithm = algorithms_[channel];
+  if ( !algorithm ) {
+    algorithm = new SVfitStandaloneAlgorithm(measuredTauLeptons_, event.measuredMETx, event.measuredMETy, covMET_, verbosity_);
+    configure(*algorithm);
+  } else {
+    algorithm->reset(measuredTauLeptons_, event.measuredMETx, event.measuredMETy, covMET_);
+  }
+  algorithm->sampleFraction(sampleFraction);
+  if      ( mode_ == kFit             ) algorithm->fit();
+  else if ( mode_ == kIntegrateVEGAS  ) algorithm->integrateVEGAS();
+  else                                  algorithm->integrateMarkovChain();
+  fillResults(*algorithm, idx, results);
+  if ( verbosity_ >= 1 ) {
+    std::cout << "<SVfitStandaloneBatchAlgorithm::process>: event #" << idx << " (channel = " << channel << "):"
+	      << " mass = " << results.mass[idx] << " +/- " << results.massUncert[idx] << std::endl;
+  }
+}
+
+void
+SVfitStandaloneBatchAlgorithm::run(const svFitStandalone::BatchEvent* events, size_t numEvents, svFitStandalone::BatchResults& results)
+{
+  results.resize(numEvents);
+
+//--- retrieve results from cache;
+//    of several events with the same key, only the first one is reconstructed and its results are copied to the others
+  const size_t isPending = numEvents;
+  duplicateOf_.assign(numEvents, isPending);
+  if ( resultCache_ ) {
+    computeConfigurationKey();
+    keys_.resize(numEvents);
+    firstOccurrence_.clear();
+    svFitStandalone::CachedResult result;
+    for ( size_t idx = 0; idx < numEvents; ++idx ) {
+      keys_[idx] = computeKey(events[idx]);
+      if ( resultCache_->find(keys_[idx], result) ) {
+	results.set(idx, result);
+	duplicateOf_[idx] = idx;
+	continue;
+      }
+      std::pair<std::unordered_map<svFitStandalone::ResultCacheKey, size_t, svFitStandalone::ResultCacheKey::Hash>::iterator, bool> first = 
+	firstOccurrence_.insert(std::make_pair(keys_[idx], idx));
+      if ( !first.second ) duplicateOf_[idx] = first.first->second;
+    }
+  }
+
+//--- group events by channel (counting sort, keeping the order of events within each channel)
+  channels_.resize(numEvents);
+  unsigned numEventsPerChannel[kNumChannels];
+  for ( unsigned iChannel = 0; iChannel < kNumChannels; ++iChannel ) {
+    numEventsPerChannel[iChannel] = 0;
+  }
+  for ( size_t idx = 0; idx < numEvents; ++idx ) {
+    unsigned type1 = events[idx].leg1Type;
+    unsigned type2 = events[idx].leg2Type;
+    if ( type1 >= kNumDecayTypes || type2 >= kNumDecayTypes ) {
+      std::cerr << "<SVfitStandaloneBatchAlgorithm::run>:"
+		<< "Invalid decay types = { " << type1 << ", " << type2 << " } for event #" << idx << " --> ABORTING !!\n";
+      assert(0);
+    }
+    // the order of the two legs does not matter, as SVfitStandaloneAlgorithm sorts them
+    unsigned channel = TMath::Min(type1, type2)*kNumDecayTypes + TMath::Max(type1, type2);
+    channels_[idx] = channel;
+    if ( duplicateOf_[idx] == isPending ) ++numEventsPerChannel[channel];
+  }
+  size_t offsets[kNumChannels];
+  size_t offset = 0;
+  for ( unsigned iChannel = 0; iChannel < kNumChannels; ++iChannel ) {
+    offsets[iChannel] = offset;
+    offset += numEventsPerChannel[iChannel];
+  }
+  order_.resize(offset);
+  for ( size_t idx = 0; idx < numEvents; ++idx ) {
+    if ( duplicateOf_[idx] == isPending ) order_[offsets[channels_[idx]]++] = idx;
+  }
+
+//--- process events channel by channel
+  for ( size_t iEvent = 0; iEvent < order_.size(); ++iEvent ) {
+    size_t idx = order_[iEvent];
+    process(events[idx], 1., idx, results);
+    if ( resultCache_ ) {
+      svFitStandalone::CachedResult result;
+      results.get(idx, result);
+      resultCache_->insert(keys_[idx], result);
+    }
+  }
+
+//--- copy results to events with the same key
+  if ( resultCache_ ) {
+    svFitStandalone::CachedResult result;
+    for ( size_t idx = 0; idx < numEvents; ++idx ) {
+      if ( duplicateOf_[idx] == isPending || duplicateOf_[idx] == idx ) continue;
+      results.get(duplicateOf_[idx], result);
+      results.set(idx, result);
+    }
+    resultCache_->flush();
+    if ( verbosity_ >= 1 ) {
+      std::cout << "<SVfitStandaloneBatchAlgorithm::run>: reconstructed " << order_.size() << " out of " << numEvents << " events,"
+		<< " cache contains " << resultCache_->size() << " results." << std::endl;
+    }
+  }
+}
+
+void
+SVfitStandaloneBatchAlgorithm::runVariations(const svFitStandalone::BatchEvent& nominal, const svFitStandalone::BatchEvent* variations, size_t numVariations, 
+					     svFitStandalone::BatchResults& results)
+{
+  results.resize(1 + numVariations);
+  if ( resultCache_ ) computeConfigurationKey();
+  
+//--- SVfitStandaloneAlgorithm resets the random number generators to the same seed for each integration,
+//    so the nominal event and all variations are integrated with common random numbers,
+//    provided that they are integrated with the same number of integrand evaluations
+  for ( size_t idx = 0; idx <= numVariations; ++idx ) {
+    const svFitStandalone::BatchEvent& event = ( idx == 0 ) ? nominal : variations[idx - 1];
+    double sampleFraction = variationSampleFraction_;
+    svFitStandalone::CachedResult result;
+    svFitStandalone::ResultCacheKey key;
+    if ( resultCache_ ) {
+      key = computeKey(event, sampleFraction);
+      if ( resultCache_->find(key, result) ) {
+	results.set(idx, result);
+	continue;
+      }
+    }
+    process(event, sampleFraction, idx, results);
+    if ( resultCache_ ) {
+      results.get(idx, result);
+      resultCache_->insert(key, result);
+    }
+  }
+  if ( resultCache_ ) resultCache_->flush();
+}
@@ -0,0 +1,339 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneEventStore.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstring>
+#include <assert.h>
+
+using namespace svFitStandalone;
+
+namespace
+{
+  const char fileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'E', 'S', '1' };
+
+  struct FileHeader
+  {
+    char format[8];
+    unsigned numColumns;
+    unsigned reserved;
+    unsigned long long numEvents;
+  };
+
+  struct ColumnEntry
+  {
+    char name[24];
+    unsigned type;
+    unsigned reserved;
+    unsigned long long offset;
+  };
+
+  struct ColumnDef
+  {
+    const char* name;
+    SVfitStandaloneEventStore::ColumnType type;
+  };
+
+  const ColumnDef columnDefs[SVfitStandaloneEventStore::kNumColumns] = {
+    { "leg1Type",             SVfitStandaloneEventStore::kInt    },
+    { "leg1DecayMode",        SVfitStandaloneEventStore::kInt    },
+    { "leg1Pt",               SVfitStandaloneEventStore::kDouble },
+    { "leg1Eta",              SVfitStandaloneEventStore::kDouble },
+    { "leg1Phi",              SVfitStandaloneEventStore::kDouble },
+    { "leg1Mass",             SVfitStandaloneEventStore::kDouble },
+    { "leg2Type",             SVfitStandaloneEventStore::kInt    },
+    { "leg2DecayMode",        SVfitStandaloneEventStore::kInt    },
+    { "leg2Pt",               SVfitStandaloneEventStore::kDouble },
+    { "leg2Eta",              SVfitStandaloneEventStore::kDouble },
+    { "leg2Phi",              SVfitStandaloneEventStore::kDouble },
+    { "leg2Mass",             SVfitStandaloneEventStore::kDouble },
+    { "measuredMETx",         SVfitStandaloneEventStore::kDouble },
+    { "measuredMETy",         SVfitStandaloneEventStore::kDouble },
+    { "covMET00",             SVfitStandaloneEventStore::kDouble },
+    { "covMET01",             SVfitStandaloneEventStore::kDouble },
+    { "covMET10",             SVfitStandaloneEventStore::kDouble },
+    { "covMET11",             SVfitStandaloneEventStore::kDouble },
+    { "mass",                 SVfitStandaloneEventStore::kDouble },
+    { "massUncert",           SVfitStandaloneEventStore::kDouble },
+    { "massLmax",             SVfitStandaloneEventStore::kDouble },
+    { "transverseMass",       SVfitStandaloneEventStore::kDouble },
+    { "transverseMassUncert", SVfitStandaloneEventStore::kDouble },
+    { "transverseMassLmax",   SVfitStandaloneEventStore::kDouble },
+    { "fitStatus",            SVfitStandaloneEventStore::kInt    },
+    { "nllStatus",            SVfitStandaloneEventStore::kInt    },
+    { "isValidSolution",      SVfitStandaloneEventStore::kInt    }
+  };
+
+  const size_t alignment = 64;
+
+  size_t align(size_t offset)
+  {
+    return ((offset + alignment - 1)/alignment)*alignment;
+  }
+
+  size_t elementSize(SVfitStandaloneEventStore::ColumnType type)
+  {
+    return ( type == SVfitStandaloneEventStore::kDouble ) ? sizeof(double) : sizeof(int);
+  }
+}
+
+SVfitStandaloneEventStore::SVfitStandaloneEventStore(const std::string& fileName, Mode mode, size_t numEvents)
+  : fileName_(fileName),
+    mode_(mode),
+    numEvents_(0),
+    data_(0),
+    size_(0)
+{
+  int fd = -1;
+  if ( mode_ == kCreate ) {
+    // compute layout of file
+    numEvents_ = numEvents;
+    size_ = align(sizeof(FileHeader) + kNumColumns*sizeof(ColumnEntry));
+    for ( int iColumn = 0; iColumn < kNumColumns; ++iColumn ) {
+      size_ += align(numEvents_*elementSize(columnDefs[iColumn].type));
+    }
+    fd = open(fileName_.data(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( fd < 0 || ftruncate(fd, size_) != 0 ) {
+      std::cerr << "<SVfitStandaloneEventStore>:"
+		<< "Failed to create file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+  } else {
+    fd = open(fileName_.data(), ( mode_ == kRead ) ? O_RDONLY : O_RDWR);
+    struct stat fileStatus;
+    if ( fd < 0 || fstat(fd, &fileStatus) != 0 ) {
+      std::cerr << "<SVfitStandaloneEventStore>:"
+		<< "Failed to open file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+    size_ = fileStatus.st_size;
+  }
+  if ( size_ < sizeof(FileHeader) + kNumColumns*sizeof(ColumnEntry) ) {
+    std::cerr << "<SVfitStandaloneEventStore>:"
+	      << "File = " << fileName_ << " is not an event store written by this version of SVfit --> ABORTING !!\n";
+    assert(0);
+  }
+  int protection = ( mode_ == kRead ) ? PROT_READ : (PROT_READ | PROT_WRITE);
+  void* address = mmap(0, size_, protection, MAP_SHARED, fd, 0);
+  close(fd);
+  if ( address == MAP_FAILED ) {
+    std::cerr << "<SVfitStandaloneEventStore>:"
+	      << "Failed to map file = " << fileName_ << " --> ABORTING !!\n";
+    assert(0);
+  }
+  data_ = static_cast<char*>(address);
+
+  FileHeader* header = reinterpret_cast<FileHeader*>(data_);
+  ColumnEntry* columnEntries = reinterpret_cast<ColumnEntry*>(data_ + sizeof(FileHeader));
+  if ( mode_ == kCreate ) {
+    memcpy(header->format, fileFormat, sizeof(fileFormat));
+    header->numColumns = kNumColumns;
+    header->numEvents = numEvents_;
+    size_t offset = align(sizeof(FileHeader) + kNumColumns*sizeof(ColumnEntry));
+    for ( int iColumn = 0; iColumn < kNumColumns; ++iColumn ) {
+      strncpy(columnEntries[iColumn].name, columnDefs[iColumn].name, sizeof(columnEntries[iColumn].name) - 1);
+      columnEntries[iColumn].type = columnDefs[iColumn].type;
+      columnEntries[iColumn].offset = offset;
+      offset += align(numEvents_*elementSize(columnDefs[iColumn].type));
+    }
+  } else {
+    if ( memcmp(header->format, fileFormat, sizeof(fileFormat)) != 0 || header->numColumns != kNumColumns ) {
+      std::cerr << "<SVfitStandaloneEventStore>:"
+		<< "File = " << fileName_ << " is not an event store written by this version of SVfit --> ABORTING !!\n";
+      assert(0);
+    }
+    numEvents_ = header->numEvents;
+  }
+  for ( int iColumn = 0; iColumn < kNumColumns; ++iColumn ) {
+    const ColumnEntry& entry = columnEntries[iColumn];
+    if ( strncmp(entry.name, columnDefs[iColumn].name, sizeof(entry.name)) != 0 || entry.type != (unsigned)columnDefs[iColumn].type ||
+	 entry.offset + numEvents_*elementSize(columnDefs[iColumn].type) > size_ ) {
+      std::cerr << "<SVfitStandaloneEventStore>:"
+		<< "Invalid column = " << columnDefs[iColumn].name << " in file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+    columns_[iColumn] = data_ + entry.offset;
+  }
+}
+
+SVfitStandaloneEventStore::~SVfitStandaloneEventStore()
+{
+  if ( data_ ) munmap(data_, size_);
+}
+
+const char*
+SVfitStandaloneEventStore::columnName(Column column)
+{
+  return columnDefs[column].name;
+}
+
+SVfitStandaloneEventStore::ColumnType
+SVfitStandaloneEventStore::columnType(Column column)
+{
+  return columnDefs[column].type;
+}
+
+void
+SVfitStandaloneEventStore::checkColumn(Column column, ColumnType type) const
+{
+  if ( !(column >= 0 && column < kNumColumns && columnDefs[column].type == type) ) {
+    std::cerr << "<SVfitStandaloneEventStore::checkColumn>:"
+	      << "Invalid column = " << column << " for requested type = " << type << " --> ABORTING !!\n";
+    assert(0);
+  }
+}
+
+void
+SVfitStandaloneEventStore::checkRange(size_t first, size_t numEvents) const
+{
+  if ( first + numEvents > numEvents_ ) {
+    std::cerr << "<SVfitStandaloneEventStore::checkRange>:"
+	      << "Invalid range of events = " << first << ".." << (first + numEvents) << ", file = " << fileName_ << " contains " << numEvents_ << " events --> ABORTING !!\n";
+    assert(0);
+  }
+}
+
+void
+SVfitStandaloneEventStore::checkWritable() const
+{
+  if ( mode_ == kRead ) {
+    std::cerr << "<SVfitStandaloneEventStore::checkWritable>:"
+	      << "File = " << fileName_ << " has been opened read-only --> ABORTING !!\n";
+    assert(0);
+  }
+}
+
+const double*
+SVfitStandaloneEventStore::doubleColumn(Column column) const
+{
+  checkColumn(column, kDouble);
+  return reinterpret_cast<const double*>(columns_[column]);
+}
+
+double*
+SVfitStandaloneEventStore::mutableDoubleColumn(Column column)
+{
+  checkColumn(column, kDouble);
+  checkWritable();
+  return reinterpret_cast<double*>(columns_[column]);
+}
+
+const int*
+SVfitStandaloneEventStore::intColumn(Column column) const
+{
+  checkColumn(column, kInt);
+  return reinterpret_cast<const int*>(columns_[column]);
+}
+
+int*
+SVfitStandaloneEventStore::mutableIntColumn(Column column)
+{
+  checkColumn(column, kInt);
+  checkWritable();
+  return reinterpret_cast<int*>(columns_[column]);
+}
+
+void
+SVfitStandaloneEventStore::getEvent(size_t idx, BatchEvent& event) const
+{
+  checkRange(idx, 1);
+  event.leg1Type      = (kDecayType)column<int>(kLeg1Type)[idx];
+  event.leg1DecayMode = column<int>(kLeg1DecayMode)[idx];
+  event.leg1Pt        = column<double>(kLeg1Pt)[idx];
+  event.leg1Eta       = column<double>(kLeg1Eta)[idx];
+  event.leg1Phi       = column<double>(kLeg1Phi)[idx];
+  event.leg1Mass      = column<double>(kLeg1Mass)[idx];
+  event.leg2Type      = (kDecayType)column<int>(kLeg2Type)[idx];
+  event.leg2DecayMode = column<int>(kLeg2DecayMode)[idx];
+  event.leg2Pt        = column<double>(kLeg2Pt)[idx];
+  event.leg2Eta       = column<double>(kLeg2Eta)[idx];
+  event.leg2Phi       = column<double>(kLeg2Phi)[idx];
+  event.leg2Mass      = column<double>(kLeg2Mass)[idx];
+  event.measuredMETx  = column<double>(kMeasuredMETx)[idx];
+  event.measuredMETy  = column<double>(kMeasuredMETy)[idx];
+  event.covMET00      = column<double>(kCovMET00)[idx];
+  event.covMET01      = column<double>(kCovMET01)[idx];
+  event.covMET10      = column<double>(kCovMET10)[idx];
+  event.covMET11      = column<double>(kCovMET11)[idx];
+}
+
+void
+SVfitStandaloneEventStore::getEvents(size_t first, size_t numEvents, std::vector<BatchEvent>& events) const
+{
+  checkRange(first, numEvents);
+  events.resize(numEvents);
+  for ( size_t idx = 0; idx < numEvents; ++idx ) {
+    getEvent(first + idx, events[idx]);
+  }
+}
+
+void
+SVfitStandaloneEventStore::setEvent(size_t idx, const BatchEvent& event)
+{
+  checkRange(idx, 1);
+  checkWritable();
+  column<int>(kLeg1Type)[idx]         = event.leg1Type;
+  column<int>(kLeg1DecayMode)[idx]    = event.leg1DecayMode;
+  column<double>(kLeg1Pt)[idx]        = event.leg1Pt;
+  column<double>(kLeg1Eta)[idx]       = event.leg1Eta;
+  column<double>(kLeg1Phi)[idx]       = event.leg1Phi;
+  column<double>(kLeg1Mass)[idx]      = event.leg1Mass;
+  column<int>(kLeg2Type)[idx]         = event.leg2Type;
+  column<int>(kLeg2DecayMode)[idx]    = event.leg2DecayMode;
+  column<double>(kLeg2Pt)[idx]        = event.leg2Pt;
+  column<double>(kLeg2Eta)[idx]       = event.leg2Eta;
+  column<double>(kLeg2Phi)[idx]       = event.leg2Phi;
+  column<double>(kLeg2Mass)[idx]      = event.leg2Mass;
+  column<double>(kMeasuredMETx)[idx]  = event.measuredMETx;
+  column<double>(kMeasuredMETy)[idx]  = event.measuredMETy;
+  column<double>(kCovMET00)[idx]      = event.covMET00;
+  column<double>(kCovMET01)[idx]      = event.covMET01;
+  column<double>(kCovMET10)[idx]      = event.covMET10;
+  column<double>(kCovMET11)[idx]      = event.covMET11;
+}
+
+void
+SVfitStandaloneEventStore::getResults(size_t first, size_t numEvents, BatchResults& results) const
+{
+  checkRange(first, numEvents);
+  results.resize(numEvents);
+  for ( size_t idx = 0; idx < numEvents; ++idx ) {
+    results.mass[idx]                 = column<double>(kMass)[first + idx];
+    results.massUncert[idx]           = column<double>(kMassUncert)[first + idx];
+    results.massLmax[idx]             = column<double>(kMassLmax)[first + idx];
+    results.transverseMass[idx]       = column<double>(kTransverseMass)[first + idx];
+    results.transverseMassUncert[idx] = column<double>(kTransverseMassUncert)[first + idx];
+    results.transverseMassLmax[idx]   = column<double>(kTransverseMassLmax)[first + idx];
+    results.fitStatus[idx]            = column<int>(kFitStatus)[first + idx];
+    results.nllStatus[idx]            = column<int>(kNllStatus)[first + idx];
+    results.isValidSolution[idx]      = column<int>(kIsValidSolution)[first + idx];
+  }
+}
+
+void
+SVfitStandaloneEventStore::setResults(size_t first, const BatchResults& results)
+{
+  size_t numEvents = results.size();
+  checkRange(first, numEvents);
+  checkWritable();
+  for ( size_t idx = 0; idx < numEvents; ++idx ) {
+    column<double>(kMass)[first + idx]                 = results.mass[idx];
+    column<double>(kMassUncert)[first + idx]           = results.massUncert[idx];
+    column<double>(kMassLmax)[first + idx]             = results.massLmax[idx];
+    column<double>(kTransverseMass)[first + idx]       = results.transverseMass[idx];
+    column<double>(kTransverseMassUncert)[first + idx] = results.transverseMassUncert[idx];
+    column<double>(kTransverseMassLmax)[first + idx]   = results.transverseMassLmax[idx];
+    column<int>(kFitStatus)[first + idx]               = results.fitStatus[idx];
+    column<int>(kNllStatus)[first + idx]               = results.nllStatus[idx];
+    column<int>(kIsValidSolution)[first + idx]         = results.isValidSolution[idx];
+  }
+}
+
+void
+SVfitStandaloneEventStore::flush()
+{
+  if ( mode_ != kRead ) msync(data_, size_, MS_SYNC);
+}
@@ -0,0 +1,207 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneFlatHistogram.h"
+
+#include <TH1.h>
+#include <TMath.h>
+
+#include <iostream>
+#include <algorithm>
+#include <assert.h>
+
+using namespace svFitStandalone;
+
+FlatHistogram::FlatHistogram()
+  : binningType_(kUniform),
+    numBins_(0),
+    xMin_(0.),
+    xMax_(0.),
+    xMinLog_(0.),
+    invLogBinWidth_(0.),
+    numEntries_(0.),
+    sumWeights_(0.),
+    sumWeights2_(0.),
+    sumWeightedValues_(0.),
+    sumWeightedValues2_(0.)
+{
+  SetUniformBinning(1, 0., 1.);
+}
+
+void
+FlatHistogram::SetUniformBinning(int numBins, double xMin, double xMax)
+{
+  if ( !(numBins >= 1 && xMax > xMin) ) {
+    std::cerr << "<FlatHistogram::SetUniformBinning>:"
+	      << "Invalid binning = { " << numBins << ", " << xMin << ", " << xMax << " } for histogram = " << name_ << " --> ABORTING !!\n";
+    assert(0);
+  }
+  binningType_ = kUniform;
+  numBins_ = numBins;
+  xMin_ = xMin;
+  xMax_ = xMax;
+  binEdges_.clear();
+  Reset();
+}
+
+void
+FlatHistogram::SetLogBinning(double xMin, double xMax, double logBinWidth)
+{
+  if ( xMin <= 0 ) xMin = 0.1;
+  if ( !(xMax > xMin && logBinWidth > 1.) ) {
+    std::cerr << "<FlatHistogram::SetLogBinning>:"
+	      << "Invalid binning = { " << xMin << ", " << xMax << ", " << logBinWidth << " } for histogram = " << name_ << " --> ABORTING !!\n";
+    assert(0);
+  }
+  binningType_ = kLog;
+  numBins_ = 1 + TMath::Log(xMax/xMin)/TMath::Log(logBinWidth);
+  // compute bin edges in the same way as makeHistogram does, including the rounding to float precision
+  binEdges_.resize(numBins_ + 1);
+  binEdges_[0] = 0.;
+  double x = xMin;
+  for ( int iBin = 1; iBin <= numBins_; ++iBin ) {
+    binEdges_[iBin] = (float)x;
+    x *= logBinWidth;
+  }
+  xMin_ = binEdges_[0];
+  xMax_ = binEdges_[numBins_];
+  xMinLog_ = binEdges_[1];
+  invLogBinWidth_ = 1./TMath::Log(logBinWidth);
+  Reset();
+}
+
+void
+FlatHistogram::SetBinning(int numBins, const double* binEdges)
+{
+  if ( !(numBins >= 1) ) {
+    std::cerr << "<FlatHistogram::SetBinning>:"
+	      << "Invalid number of bins = " << numBins << " for histogram = " << name_ << " --> ABORTING !!\n";
+    assert(0);
+  }
+  binningType_ = kVariable;
+  numBins_ = numBins;
+  binEdges_.assign(binEdges, binEdges + numBins + 1);
+  xMin_ = binEdges_[0];
+  xMax_ = binEdges_[numBins_];
+  Reset();
+}
+
+void
+FlatHistogram::Reset()
+{
+  binContents_.assign(numBins_ + 2, 0.);
+  binSumw2_.assign(numBins_ + 2, 0.);
+  numEntries_ = 0.;
+  sumWeights_ = 0.;
+  sumWeights2_ = 0.;
+  sumWeightedValues_ = 0.;
+  sumWeightedValues2_ = 0.;
+}
+
+int
+FlatHistogram::FindBin(double x) const
+{
+  if ( x < xMin_ ) return 0;
+  if ( !(x < xMax_) ) return numBins_ + 1;
+  if ( binningType_ == kUniform ) {
+    // same formula as used by TAxis::FindBin
+    return 1 + int(numBins_*(x - xMin_)/(xMax_ - xMin_));
+  }
+  int bin;
+  if ( binningType_ == kLog ) {
+    if ( x < xMinLog_ ) return 1;
+    bin = 2 + int(TMath::Log(x/xMinLog_)*invLogBinWidth_);
+    if ( bin > numBins_ ) bin = numBins_;
+  } else {
+    bin = std::upper_bound(binEdges_.begin(), binEdges_.end(), x) - binEdges_.begin();
+  }
+  // correct for rounding of bin edges and logarithm
+  while ( bin > 1 && x < binEdges_[bin - 1] ) --bin;
+  while ( bin < numBins_ && !(x < binEdges_[bin]) ) ++bin;
+  return bin;
+}
+
+void
+FlatHistogram::Fill(double x, double weight)
+{
+  int bin = FindBin(x);
+  binContents_[bin] += weight;
+  binSumw2_[bin] += weight*weight;
+  numEntries_ += 1.;
+  // underflow and overflow are not included in the statistics, as for TH1
+  if ( bin == 0 || bin > numBins_ ) return;
+  sumWeights_ += weight;
+  sumWeights2_ += weight*weight;
+  sumWeightedValues_ += weight*x;
+  sumWeightedValues2_ += weight*x*x;
+}
+
+void
+FlatHistogram::FillRepeated(double x, double numEntries, double weight)
+{
+  int bin = FindBin(x);
+  binContents_[bin] += numEntries*weight;
+  binSumw2_[bin] += numEntries*weight*weight;
+  numEntries_ += numEntries;
+  if ( bin == 0 || bin > numBins_ ) return;
+  sumWeights_ += numEntries*weight;
+  sumWeights2_ += numEntries*weight*weight;
+  sumWeightedValues_ += numEntries*weight*x;
+  sumWeightedValues2_ += numEntries*weight*x*x;
+}
+
+double
+FlatHistogram::GetBinError(int bin) const
+{
+  return TMath::Sqrt(binSumw2_[bin]);
+}
+
+double
+FlatHistogram::GetBinLowEdge(int bin) const
+{
+  if ( binningType_ == kUniform ) return xMin_ + (bin - 1)*(xMax_ - xMin_)/numBins_;
+  if ( bin < 1 ) return xMin_ - GetBinWidth(1);
+  if ( bin > numBins_ ) return xMax_;
+  return binEdges_[bin - 1];
+}
+
+double
+FlatHistogram::GetBinWidth(int bin) const
+{
+  if ( binningType_ == kUniform ) return (xMax_ - xMin_)/numBins_;
+  if ( bin < 1 ) bin = 1;
+  if ( bin > numBins_ ) bin = numBins_;
+  return binEdges_[bin] - binEdges_[bin - 1];
+}
+
+double
+FlatHistogram::GetBinCenter(int bin) const
+{
+  if ( binningType_ == kUniform ) return xMin_ + (bin - 0.5)*(xMax_ - xMin_)/numBins_;
+  if ( bin < 1 || bin > numBins_ ) return GetBinLowEdge(bin) + 0.5*GetBinWidth(bin);
+  return binEdges_[bin - 1] + 0.5*(binEdges_[bin] - binEdges_[bin - 1]);
+}
+
+double
+FlatHistogram::Integral() const
+{
+  double integral = 0.;
+  for ( int iBin = 1; iBin <= numBins_; ++iBin ) {
+    integral += binContents_[iBin];
+  }
+  return integral;
+}
+
+TH1*
+FlatHistogram::CreateTH1() const
+{
+  TH1* histogram = 0;
+  if ( binningType_ == kUniform ) histogram = new TH1D(name_.data(), name_.data(), numBins_, xMin_, xMax_);
+  else histogram = new TH1D(name_.data(), name_.data(), numBins_, binEdges_.data());
+  histogram->Sumw2();
+  for ( int iBin = 0; iBin <= (numBins_ + 1); ++iBin ) {
+    histogram->SetBinContent(iBin, binContents_[iBin]);
+    histogram->SetBinError(iBin, GetBinError(iBin));
+  }
+  double stats[4] = { sumWeights_, sumWeights2_, sumWeightedValues_, sumWeightedValues2_ };
+  histogram->PutStats(stats);
+  histogram->SetEntries(numEntries_);
+  return histogram;
+}
@@ -0,0 +1,325 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneLUTRegistry.h"
+
+#include <TAxis.h>
+#include <TString.h>
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <climits>
+#include <cstdlib>
+#include <stdint.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace svFitStandalone;
+
+namespace
+{
+  const char fileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'L', 'U', '2' };
+
+  /// directory entry of a precompiled file; the numBins + 1 bin edges and numBins bin contents
+  /// of the table are stored as doubles at offset (which is a multiple of 8) in the file
+  struct TableEntry
+  {
+    char key[512];
+    int32_t numBins;
+    int32_t isUniform;
+    uint64_t offset;
+  };
+}
+
+LookupTable::LookupTable(const std::string& name, int numBins, bool isUniform, const double* binEdges, const double* binContents)
+  : name_(name),
+    numBins_(numBins),
+    isUniform_(isUniform),
+    binEdges_(binEdges),
+    binContents_(binContents)
+{}
+
+LookupTable::LookupTable(const TH1* histogram)
+  : name_(histogram->GetName()),
+    numBins_(histogram->GetNbinsX()),
+    isUniform_(histogram->GetXaxis()->GetXbins()->GetSize() == 0)
+{
+  const TAxis* xAxis = histogram->GetXaxis();
+  ownedBinEdges_.resize(numBins_ + 1);
+  ownedBinContents_.resize(numBins_);
+  for ( int iBin = 1; iBin <= numBins_; ++iBin ) {
+    ownedBinEdges_[iBin - 1] = xAxis->GetBinLowEdge(iBin);
+    ownedBinContents_[iBin - 1] = histogram->GetBinContent(iBin);
+  }
+  ownedBinEdges_[numBins_] = xAxis->GetBinUpEdge(numBins_);
+  binEdges_ = &ownedBinEdges_[0];
+  binContents_ = &ownedBinContents_[0];
+}
+
+unsigned long long
+LookupTable::checksum() const
+{
+  unsigned long long value = 14695981039346656037ULL;
+  const unsigned char* bytes[] = { reinterpret_cast<const unsigned char*>(&numBins_), reinterpret_cast<const unsigned char*>(&isUniform_),
+				   reinterpret_cast<const unsigned char*>(binEdges_), reinterpret_cast<const unsigned char*>(binContents_) };
+  size_t sizes[] = { sizeof(numBins_), sizeof(isUniform_), (numBins_ + 1)*sizeof(double), numBins_*sizeof(double) };
+  for ( int iPart = 0; iPart < 4; ++iPart ) {
+    for ( size_t idx = 0; idx < sizes[iPart]; ++idx ) {
+      value ^= bytes[iPart][idx];
+      value *= 1099511628211ULL;
+    }
+  }
+  return value;
+}
+
+int
+LookupTable::findBin(double x) const
+{
+  double xMin = binEdges_[0];
+  double xMax = binEdges_[numBins_];
+  if ( !(x >= xMin) ) return 0;
+  if ( x >= xMax ) return numBins_ + 1;
+  if ( isUniform_ ) {
+    // same computation as in TAxis::FindBin, to select the same bin also for x close to a bin edge
+    return 1 + int(numBins_*(x - xMin)/(xMax - xMin));
+  } else {
+    return std::upper_bound(binEdges_, binEdges_ + numBins_ + 1, x) - binEdges_;
+  }
+}
+
+SVfitStandaloneLUTRegistry&
+SVfitStandaloneLUTRegistry::instance()
+{
+  static SVfitStandaloneLUTRegistry registry;
+  return registry;
+}
+
+std::string
+SVfitStandaloneLUTRegistry::key(const std::string& fileName, const std::string& histogramName)
+{
+  // use the full path, so that files with the same name in different directories are not mixed up;
+  // names that do not refer to a local file (e.g. URLs) are taken as they are
+  char fullPath[PATH_MAX];
+  std::string path = ( realpath(fileName.data(), fullPath) ) ? fullPath : fileName;
+  return path + ":" + histogramName;
+}
+
+LookupTable*
+SVfitStandaloneLUTRegistry::load(TFile* file, const std::string& fileName, const std::string& histogramName, int rebin, int minNumBinsToRebin)
+{
+  TH1* histogram = dynamic_cast<TH1*>(file->Get(histogramName.data()));
+  if ( !histogram ) {
+    std::cerr << "<SVfitStandaloneLUTRegistry::load>:"
+	      << "Failed to load histogram = " << histogramName << " from file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  LookupTable* lut = 0;
+  if ( rebin > 1 && histogram->GetNbinsX() >= minNumBinsToRebin ) {
+    // rebin a copy, the histogram read from the file is owned by the file
+    TH1* histogram_rebinned = (TH1*)histogram->Clone();
+    histogram_rebinned->SetDirectory(0);
+    histogram_rebinned->Rebin(rebin);
+    lut = new LookupTable(histogram_rebinned);
+    delete histogram_rebinned;
+  } else {
+    lut = new LookupTable(histogram);
+  }
+  return lut;
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::get(const std::string& fileName, const std::string& histogramName, TFile* inputFile)
+{
+  return get(fileName, histogramName, inputFile, 1, 0);
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::get(const std::string& fileName, const std::string& histogramName, TFile* inputFile, int rebin, int minNumBinsToRebin)
+{
+  std::string tableKey = key(fileName, histogramName);
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, std::unique_ptr<LookupTable> >::const_iterator table = tables_.find(tableKey);
+  if ( table != tables_.end() ) {
+    if ( inputFile ) {
+      // the content of a file passed by the caller may differ from the table loaded before under the same name
+      std::unique_ptr<LookupTable> lut(load(inputFile, fileName, histogramName, rebin, minNumBinsToRebin));
+      if ( lut->checksum() != table->second->checksum() ) {
+	std::cerr << "<SVfitStandaloneLUTRegistry::get>:"
+		  << "Histogram = " << histogramName << " in file = " << fileName << " differs from look-up table = " << tableKey
+		  << " already in the registry --> ABORTING !!\n";
+	assert(0);
+      }
+    }
+    return table->second.get();
+  }
+  TFile* file = inputFile;
+  if ( !file ) {
+    file = TFile::Open(fileName.data());
+    if ( !file || file->IsZombie() ) {
+      std::cerr << "<SVfitStandaloneLUTRegistry::get>:"
+		<< "Failed to open file = " << fileName << " --> ABORTING !!\n";
+      assert(0);
+    }
+  }
+  LookupTable* lut = load(file, fileName, histogramName, rebin, minNumBinsToRebin);
+  if ( file != inputFile ) delete file;
+  tables_[tableKey].reset(lut);
+  return lut;
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::visMassAllDMs(const std::string& fileName)
+{
+  return get(fileName, "DQMData/genTauMassAnalyzer/genTauJetMass", 0, 100, 1000);
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::visMassAllDMs(TFile* inputFile)
+{
+  return get(inputFile->GetName(), "DQMData/genTauMassAnalyzer/genTauJetMass", inputFile, 100, 1000);
+}
+
+namespace
+{
+  std::string decayModeSuffix(int decayMode)
+  {
+    if ( !(decayMode == 0 || decayMode == 1 || decayMode == 10) ) {
+      std::cerr << "<SVfitStandaloneLUTRegistry>:"
+		<< "No look-up table for decayMode = " << decayMode << " --> ABORTING !!\n";
+      assert(0);
+    }
+    return Form("_recDecayModeEq%i", decayMode);
+  }
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::visMassRes(const std::string& fileName, int decayMode)
+{
+  return get(fileName, "recMinusGenTauMass" + decayModeSuffix(decayMode), 0);
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::visMassRes(TFile* inputFile, int decayMode)
+{
+  return get(inputFile->GetName(), "recMinusGenTauMass" + decayModeSuffix(decayMode), inputFile);
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::visPtRes(const std::string& fileName, int decayMode)
+{
+  return get(fileName, "recTauPtDivGenTauPt" + decayModeSuffix(decayMode), 0);
+}
+
+const LookupTable*
+SVfitStandaloneLUTRegistry::visPtRes(TFile* inputFile, int decayMode)
+{
+  return get(inputFile->GetName(), "recTauPtDivGenTauPt" + decayModeSuffix(decayMode), inputFile);
+}
+
+void
+SVfitStandaloneLUTRegistry::loadPrecompiled(const std::string& fileName)
+{
+  int fd = open(fileName.data(), O_RDONLY);
+  struct stat fileStatus;
+  if ( fd < 0 || fstat(fd, &fileStatus) != 0 || fileStatus.st_size < (off_t)(sizeof(fileFormat) + sizeof(uint64_t)) ) {
+    std::cerr << "<SVfitStandaloneLUTRegistry::loadPrecompiled>:"
+	      << "Failed to open file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  size_t size = fileStatus.st_size;
+  void* address = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if ( address == MAP_FAILED ) {
+    std::cerr << "<SVfitStandaloneLUTRegistry::loadPrecompiled>:"
+	      << "Failed to map file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  const char* data = static_cast<const char*>(address);
+  uint64_t numTables = 0;
+  memcpy(&numTables, data + sizeof(fileFormat), sizeof(numTables));
+  size_t directorySize = sizeof(fileFormat) + sizeof(numTables) + numTables*sizeof(TableEntry);
+  if ( memcmp(data, fileFormat, sizeof(fileFormat)) != 0 || directorySize > size ) {
+    std::cerr << "<SVfitStandaloneLUTRegistry::loadPrecompiled>:"
+	      << "File = " << fileName << " is not a look-up table file written by this version of SVfit --> ABORTING !!\n";
+    assert(0);
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  for ( uint64_t idx = 0; idx < numTables; ++idx ) {
+    TableEntry entry;
+    memcpy(&entry, data + sizeof(fileFormat) + sizeof(numTables) + idx*sizeof(TableEntry), sizeof(entry));
+    entry.key[sizeof(entry.key) - 1] = '\0';
+    if ( entry.numBins < 1 || entry.offset % sizeof(double) != 0 || entry.offset + (2*entry.numBins + 1)*sizeof(double) > size ) {
+      std::cerr << "<SVfitStandaloneLUTRegistry::loadPrecompiled>:"
+		<< "Invalid look-up table = " << entry.key << " in file = " << fileName << " --> ABORTING !!\n";
+      assert(0);
+    }
+    const double* binEdges = reinterpret_cast<const double*>(data + entry.offset);
+    const double* binContents = binEdges + entry.numBins + 1;
+    std::string name = entry.key;
+    name = name.substr(name.find_last_of(':') + 1);
+    std::unique_ptr<LookupTable> lut(new LookupTable(name, entry.numBins, entry.isUniform, binEdges, binContents));
+    // keep tables that are already in the registry, as they may be in use, provided their content is the same
+    std::unique_ptr<LookupTable>& table = tables_[entry.key];
+    if ( table ) {
+      if ( table->checksum() != lut->checksum() ) {
+	std::cerr << "<SVfitStandaloneLUTRegistry::loadPrecompiled>:"
+		  << "Look-up table = " << entry.key << " in file = " << fileName << " differs from the one already in the registry --> ABORTING !!\n";
+	assert(0);
+      }
+      continue;
+    }
+    table.reset(lut.release());
+  }
+}
+
+void
+SVfitStandaloneLUTRegistry::writePrecompiled(const std::string& fileName) const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  FILE* file = fopen(fileName.data(), "wb");
+  if ( !file ) {
+    std::cerr << "<SVfitStandaloneLUTRegistry::writePrecompiled>:"
+	      << "Failed to create file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  uint64_t numTables = tables_.size();
+  fwrite(fileFormat, sizeof(fileFormat), 1, file);
+  fwrite(&numTables, sizeof(numTables), 1, file);
+  uint64_t offset = sizeof(fileFormat) + sizeof(numTables) + numTables*sizeof(TableEntry);
+  for ( std::map<std::string, std::unique_ptr<LookupTable> >::const_iterator table = tables_.begin();
+	table != tables_.end(); ++table ) {
+    if ( table->first.size() >= sizeof(TableEntry().key) ) {
+      std::cerr << "<SVfitStandaloneLUTRegistry::writePrecompiled>:"
+		<< "Name of look-up table = " << table->first << " too long --> ABORTING !!\n";
+      assert(0);
+    }
+    TableEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    strncpy(entry.key, table->first.data(), sizeof(entry.key) - 1);
+    entry.numBins = table->second->numBins();
+    entry.isUniform = table->second->isUniform();
+    entry.offset = offset;
+    fwrite(&entry, sizeof(entry), 1, file);
+    offset += (2*entry.numBins + 1)*sizeof(double);
+  }
+  for ( std::map<std::string, std::unique_ptr<LookupTable> >::const_iterator table = tables_.begin();
+	table != tables_.end(); ++table ) {
+    fwrite(table->second->binEdges(), sizeof(double), table->second->numBins() + 1, file);
+    fwrite(table->second->binContents(), sizeof(double), table->second->numBins(), file);
+  }
+  if ( ferror(file) ) {
+    std::cerr << "<SVfitStandaloneLUTRegistry::writePrecompiled>:"
+	      << "Failed to write file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  fclose(file);
+}
+
+size_t
+SVfitStandaloneLUTRegistry::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return tables_.size();
+}
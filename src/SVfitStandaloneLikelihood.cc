@@ -3,6 +3,9 @@
 #include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
 #include "TauAnalysis/SVfitStandalone/interface/LikelihoodFunctions.h"
 
+#include <algorithm>
+#include <limits>
+
 // !!! ONLY FOR TESTING
 //#include "TauAnalysis/SVfitMEM/interface/svFitAuxFunctions.h"
 //     FOR TESTING ONLY !!!
@@ -23,6 +26,7 @@ SVfitStandaloneLikelihood::SVfitStandaloneLikelihood(const std::vector<MeasuredT
     addPhiPenalty_(true),
     verbosity_(verbosity), 
     idxObjFunctionCall_(0), 
+    isValidKinematics_(false),
     invCovMET_(2,2),
     errorCode_(0),
     requirePhysicalSolution_(false),
@@ -39,6 +43,15 @@ SVfitStandaloneLikelihood::SVfitStandaloneLikelihood(const std::vector<MeasuredT
   //if ( verbosity_ ) {
   //  std::cout << "<SVfitStandaloneLikelihood::SVfitStandaloneLikelihood>:" << std::endl;
   //}
+  reset(measuredTauLeptons, measuredMET, covMET);
+}
+
+void
+SVfitStandaloneLikelihood::reset(const std::vector<MeasuredTauLepton>& measuredTauLeptons, const Vector& measuredMET, const TMatrixD& covMET)
+{
+  errorCode_ = 0;
+  idxObjFunctionCall_ = 0;
+  isValidKinematics_ = false;
   measuredMET_ = measuredMET;
   measuredTauLeptons_= measuredTauLeptons;
   if ( measuredTauLeptons_.size() != 2 ) {
@@ -59,7 +72,7 @@ SVfitStandaloneLikelihood::SVfitStandaloneLikelihood(const std::vector<MeasuredT
 }
 
 void 
-SVfitStandaloneLikelihood::marginalizeVisMass(bool value, const TH1* l1lutVisMass, const TH1* l2lutVisMass)
+SVfitStandaloneLikelihood::marginalizeVisMass(bool value, const LookupTable* l1lutVisMass, const LookupTable* l2lutVisMass)
 {
   marginalizeVisMass_ = value;
   if ( marginalizeVisMass_ ) {
@@ -69,7 +82,7 @@ SVfitStandaloneLikelihood::marginalizeVisMass(bool value, const TH1* l1lutVisMas
 }
 
 void 
-SVfitStandaloneLikelihood::shiftVisMass(bool value, const TH1* l1lutVisMassRes, const TH1* l2lutVisMassRes)
+SVfitStandaloneLikelihood::shiftVisMass(bool value, const LookupTable* l1lutVisMassRes, const LookupTable* l2lutVisMassRes)
 {
   shiftVisMass_ = value;
   if ( shiftVisMass_ ) {
@@ -79,7 +92,7 @@ SVfitStandaloneLikelihood::shiftVisMass(bool value, const TH1* l1lutVisMassRes,
 }
 
 void 
-SVfitStandaloneLikelihood::shiftVisPt(bool value, const TH1* l1lutVisPtRes, const TH1* l2lutVisPtRes)
+SVfitStandaloneLikelihood::shiftVisPt(bool value, const LookupTable* l1lutVisPtRes, const LookupTable* l2lutVisPtRes)
 {
   shiftVisPt_ = value;
   if ( shiftVisPt_ ) {
@@ -94,6 +107,7 @@ SVfitStandaloneLikelihood::transform(double* xPrime, const double* x, bool fixTo
   //if ( verbosity_ ) {
   //  std::cout << "<SVfitStandaloneLikelihood::transform(double*, const double*)>:" << std::endl;
   //}
+  isValidKinematics_ = false;
   LorentzVector fittedDiTauSystem;
   for ( size_t idx = 0; idx < measuredTauLeptons_.size(); ++idx ) {
     const MeasuredTauLepton& measuredTauLepton = measuredTauLeptons_[idx];
@@ -174,6 +188,7 @@ SVfitStandaloneLikelihood::transform(double* xPrime, const double* x, bool fixTo
     //  std::cout << "phiInvis = " << phiInvis << std::endl;
     //}
     fittedDiTauSystem += p4Tau_lab;
+    kinematics_.fittedTauLeptons[idx] = p4Tau_lab;
     // fill branch-wise nll parameters
     xPrime[ idx == 0 ? kNuNuMass1            : kNuNuMass2            ] = nunuMass;
     xPrime[ idx == 0 ? kVisMass1             : kVisMass2             ] = visMass;
@@ -194,6 +209,11 @@ SVfitStandaloneLikelihood::transform(double* xPrime, const double* x, bool fixTo
   if ( fixToMtest ) xPrime[ kMTauTau ] = mtest;       // CV: evaluate delta-function derrivate in case of VEGAS integration for nominal test mass,
   else xPrime[ kMTauTau ] = fittedDiTauSystem.mass(); //     not for fitted mass, to improve numerical stability of integration (this is what the SVfit plugin version does)
 
+  // keep the four-vectors for the SVfitQuantities, in case this point gets accepted by the Markov Chain
+  kinematics_.fittedDiTauSystem = fittedDiTauSystem;
+  std::copy(x, x + 2*kMaxFitParams, xKinematics_);
+  isValidKinematics_ = true;
+
   //if ( verbosity_ && FIRST ) {
   //  std::cout << " >> input values for transformed variables: " << std::endl;
   //  std::cout << "    MET[x] = " <<  fittedMET.x() << " (fitted)  " << measuredMET_.x() << " (measured) " << std::endl; 
@@ -256,6 +276,14 @@ SVfitStandaloneLikelihood::prob(const double* x, bool fixToMtest, double mtest)
   }
 }
 
+void
+SVfitStandaloneLikelihood::probBatch(const double* x, unsigned numPoints, double* probs, bool fixToMtest, const double* mtest) const 
+{
+  for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+    probs[iPoint] = prob(x + iPoint*2*kMaxFitParams, fixToMtest, ( fixToMtest ) ? mtest[iPoint] : -1.);
+  }
+}
+
 double 
 SVfitStandaloneLikelihood::prob(const double* xPrime, double phiPenalty) const
 {
@@ -382,3 +410,286 @@ SVfitStandaloneLikelihood::results(std::vector<LorentzVector>& fittedTauLeptons,
     else fittedTauLeptons.push_back(p4Tau_lab);
   }
 }
+
+const FittedKinematics&
+SVfitStandaloneLikelihood::kinematics(const double* x) const
+{
+  if ( !(isValidKinematics_ && std::equal(x, x + 2*kMaxFitParams, xKinematics_)) ) {
+    results(kinematics_.fittedTauLeptons, x);
+    kinematics_.fittedDiTauSystem = kinematics_.fittedTauLeptons[0] + kinematics_.fittedTauLeptons[1];
+    std::copy(x, x + 2*kMaxFitParams, xKinematics_);
+    isValidKinematics_ = true;
+  }
+  return kinematics_;
+}
+
+namespace
+{
+  // apply the rotation performed by svFitStandalone::rotateUz to the cartesian vector v
+  Vector rotateUz_cartesian(const Vector& v, const Vector& newUzVector)
+  {
+    double u1 = newUzVector.X();
+    double u2 = newUzVector.Y();
+    double u3 = newUzVector.Z();
+    double up = u1*u1 + u2*u2;
+    if ( up > 0. ) {
+      up = TMath::Sqrt(up);
+      return Vector((u1*u3*v.X() - u2*v.Y() + u1*up*v.Z())/up,
+		    (u2*u3*v.X() + u1*v.Y() + u2*up*v.Z())/up,
+		    (u3*u3*v.X() -    v.X() + u3*up*v.Z())/up);
+    } else if ( u3 < 0. ) {
+      return Vector(-v.X(), v.Y(), -v.Z());
+    } else {
+      return v;
+    }
+  }
+  
+  // derivative of -log(probTauToLepMatrixElement) with respect to nunuMass, in the physical region (nunuMass below kinematic limit) 
+  double dNLLTauToLepMatrixElement(double nunuMass)
+  {
+    double nunuMass2 = nunuMass*nunuMass;
+    return -(-2.*nunuMass/(tauLeptonMass2 - nunuMass2) + 4.*nunuMass/(tauLeptonMass2 + 2.*nunuMass2) + 1./nunuMass);
+  }
+}
+
+double
+SVfitStandaloneLikelihood::nllAndGradient(const double* x, double* grad) const
+{
+  std::fill(grad, grad + 2*kMaxFitParams, 0.);
+  double prob = this->prob(x);
+  if ( !(prob > 0.) ) {
+    return std::numeric_limits<float>::max();
+  }
+  double nll = -TMath::Log(prob);
+
+  // the derivatives are computed by applying the chain rule to the individual steps performed in the functions transform and prob,
+  // see there for the meaning of the individual variables. The notation d_y[k] refers to the derivative of y with respect to the 
+  // fit parameter k of the current tau decay branch
+  const int numFitParams = 2*kMaxFitParams;
+  double d_diTau[4][numFitParams]; // derivatives of { px, py, pz, energy } of the fitted di-tau system
+  for ( int iComponent = 0; iComponent < 4; ++iComponent ) {
+    std::fill(d_diTau[iComponent], d_diTau[iComponent] + numFitParams, 0.);
+  }
+  for ( size_t idx = 0; idx < measuredTauLeptons_.size(); ++idx ) {
+    const MeasuredTauLepton& measuredTauLepton = measuredTauLeptons_[idx];
+    const double* xLeg = x + idx*kMaxFitParams;
+    double* gradLeg = grad + idx*kMaxFitParams;
+
+    bool isLeptonicDecay = ( measuredTauLepton.type() == kTauToElecDecay || measuredTauLepton.type() == kTauToMuDecay );
+    double labframeXFrac = xLeg[kXFrac];
+    double nunuMass = 0.;
+    double labframePhi = xLeg[kPhi];
+    double visMass = measuredTauLepton.mass();
+    double labframeVisMom_unshifted = measuredTauLepton.momentum();
+    double labframeVisEn_unshifted = measuredTauLepton.energy();
+    double d_nunuMass[kMaxFitParams] = { 0. };
+    double d_visMass[kMaxFitParams] = { 0. };
+    double shift = 1.;
+    double d_shift = 0.; // derivative with respect to kRecTauPtDivGenTauPt
+    if ( isLeptonicDecay ) {
+      nunuMass = xLeg[kMNuNu];
+      d_nunuMass[kMNuNu] = 1.;
+    } else {
+      if ( marginalizeVisMass_ || shiftVisMass_ ) {
+	visMass = xLeg[kVisMassShifted];
+	d_visMass[kVisMassShifted] = 1.;
+      }
+      if ( shiftVisPt_ ) {
+	double shiftInv = 1. + xLeg[kRecTauPtDivGenTauPt];
+	if ( shiftInv > 1.e-1 ) {
+	  shift = 1./shiftInv;
+	  d_shift = -shift*shift;
+	} else {
+	  shift = 1.e+1;
+	}
+      }
+    }
+    double labframeVisMom = labframeVisMom_unshifted*shift;
+    double labframeVisEn = labframeVisEn_unshifted*shift;
+    double d_labframeVisMom[kMaxFitParams] = { 0. };
+    double d_labframeVisEn[kMaxFitParams] = { 0. };
+    d_labframeVisMom[kRecTauPtDivGenTauPt] = labframeVisMom_unshifted*d_shift;
+    d_labframeVisEn[kRecTauPtDivGenTauPt] = labframeVisEn_unshifted*d_shift;
+
+    // Gottfried-Jackson angle in the laboratory frame: 
+    // the two solutions computed in gjAngleLabFrameFromX simplify to cosGjAngle = sign*(2*enVis^2 - sigma*A*x)/(2*pVis*sqrt(enVis^2 - mTau^2*x^2))
+    bool isValidSolution = true;
+    double gjAngle_lab = gjAngleLabFrameFromX(labframeXFrac, visMass, nunuMass, labframeVisMom, labframeVisEn, tauLeptonMass, isValidSolution);
+    double d_gjAngle_lab[kMaxFitParams] = { 0. };
+    double term1 = square(labframeVisEn) - tauLeptonMass2*square(labframeXFrac);
+    double sqrtTerm1 = TMath::Sqrt(term1);
+    double A = (square(visMass) - square(nunuMass)) + tauLeptonMass2;
+    double term2 = 2.*TMath::Sqrt(square(labframeVisMom)*square(labframeVisEn)*square(labframeVisEn)*term1);
+    double term3 = A*labframeVisMom*labframeXFrac*sqrtTerm1;
+    double term4 = 2.*square(labframeVisMom)*term1;
+    double cosGjAngle_lab1 =  (term2 - term3)/term4;
+    double cosGjAngle_lab2 = -(term2 + term3)/term4;
+    double sign = 0.;
+    double cosGjAngle_lab = 0.;
+    if      ( TMath::Abs(cosGjAngle_lab1) <= 1. && TMath::Abs(cosGjAngle_lab2) >  1. ) { sign = +1.; cosGjAngle_lab = cosGjAngle_lab1; }
+    else if ( TMath::Abs(cosGjAngle_lab1) >  1. && TMath::Abs(cosGjAngle_lab2) <= 1. ) { sign = -1.; cosGjAngle_lab = cosGjAngle_lab2; }
+    if ( sign != 0. && TMath::Abs(cosGjAngle_lab) < 1. ) {
+      double N = 2.*square(labframeVisEn) - sign*A*labframeXFrac;
+      double D = 2.*labframeVisMom*sqrtTerm1;
+      double sinGjAngle_lab = TMath::Sqrt(1. - square(cosGjAngle_lab));
+      for ( int k = 0; k < kMaxFitParams; ++k ) {
+	double d_x = ( k == kXFrac ) ? 1. : 0.;
+	double d_A = 2.*visMass*d_visMass[k] - 2.*nunuMass*d_nunuMass[k];
+	double d_N = 4.*labframeVisEn*d_labframeVisEn[k] - sign*(d_A*labframeXFrac + A*d_x);
+	double d_sqrtTerm1 = (labframeVisEn*d_labframeVisEn[k] - tauLeptonMass2*labframeXFrac*d_x)/sqrtTerm1;
+	double d_D = 2.*(d_labframeVisMom[k]*sqrtTerm1 + labframeVisMom*d_sqrtTerm1);
+	double d_cosGjAngle_lab = sign*(d_N*D - N*d_D)/square(D);
+	d_gjAngle_lab[k] = -d_cosGjAngle_lab/sinGjAngle_lab;
+      }
+    }
+
+    // energy and momentum of tau lepton in the laboratory frame
+    double enTau_lab = labframeVisEn/labframeXFrac;
+    double d_enTau_lab[kMaxFitParams] = { 0. };
+    if ( (enTau_lab*enTau_lab) < tauLeptonMass2 ) {
+      enTau_lab = tauLeptonMass;
+    } else {
+      for ( int k = 0; k < kMaxFitParams; ++k ) {
+	double d_x = ( k == kXFrac ) ? 1. : 0.;
+	d_enTau_lab[k] = (d_labframeVisEn[k] - enTau_lab*d_x)/labframeXFrac;
+      }
+    }
+    double pTau_lab = TMath::Sqrt(square(enTau_lab) - tauLeptonMass2);
+    double d_pTau_lab[kMaxFitParams] = { 0. };
+    if ( pTau_lab > 0. ) {
+      for ( int k = 0; k < kMaxFitParams; ++k ) {
+	d_pTau_lab[k] = enTau_lab*d_enTau_lab[k]/pTau_lab;
+      }
+    }
+
+    // Gottfried-Jackson angle in the tau rest frame
+    double gamma = enTau_lab/tauLeptonMass;
+    double beta = TMath::Sqrt(1. - 1./(gamma*gamma));
+    double cosGj = TMath::Cos(gjAngle_lab);
+    double sinGj = TMath::Sin(gjAngle_lab);
+    double pVis_parl_rf = -beta*gamma*labframeVisEn + gamma*cosGj*labframeVisMom;
+    double pVis_perp = labframeVisMom*sinGj;
+    double gjAngle_rf = TMath::ATan2(pVis_perp, pVis_parl_rf);
+    double d_gjAngle_rf[kMaxFitParams] = { 0. };
+    double norm2 = square(pVis_parl_rf) + square(pVis_perp);
+    if ( norm2 > 0. ) {
+      for ( int k = 0; k < kMaxFitParams; ++k ) {
+	double d_pVis_parl_rf = -(d_pTau_lab[k]/tauLeptonMass)*labframeVisEn - beta*gamma*d_labframeVisEn[k]
+	  + (d_enTau_lab[k]/tauLeptonMass)*cosGj*labframeVisMom - gamma*sinGj*d_gjAngle_lab[k]*labframeVisMom + gamma*cosGj*d_labframeVisMom[k];
+	double d_pVis_perp = d_labframeVisMom[k]*sinGj + labframeVisMom*cosGj*d_gjAngle_lab[k];
+	d_gjAngle_rf[k] = (pVis_parl_rf*d_pVis_perp - pVis_perp*d_pVis_parl_rf)/norm2;
+      }
+    }
+
+    // tau lepton direction and momentum: 
+    // direction is (-sin(gjAngle)*cos(phi), -sin(gjAngle)*sin(phi), cos(gjAngle)) in a system in which the visible momentum defines the z-axis
+    Vector p3Tau_unit = motherDirection(measuredTauLepton.direction(), gjAngle_lab, labframePhi);
+    Vector visDirection = measuredTauLepton.direction().Unit();
+    double cosPhi = TMath::Cos(labframePhi);
+    double sinPhi = TMath::Sin(labframePhi);
+    Vector d_p3Tau_unit_dGjAngle = rotateUz_cartesian(Vector(-cosGj*cosPhi, -cosGj*sinPhi, -sinGj), visDirection);
+    Vector d_p3Tau_unit_dPhi = rotateUz_cartesian(Vector(sinGj*sinPhi, -sinGj*cosPhi, 0.), visDirection);
+    for ( int k = 0; k < kMaxFitParams; ++k ) {
+      Vector d_p3Tau_unit = d_gjAngle_lab[k]*d_p3Tau_unit_dGjAngle;
+      if ( k == kPhi ) d_p3Tau_unit += d_p3Tau_unit_dPhi;
+      Vector d_p3Tau = d_pTau_lab[k]*p3Tau_unit + pTau_lab*d_p3Tau_unit;
+      d_diTau[0][idx*kMaxFitParams + k] = d_p3Tau.X();
+      d_diTau[1][idx*kMaxFitParams + k] = d_p3Tau.Y();
+      d_diTau[2][idx*kMaxFitParams + k] = d_p3Tau.Z();
+      d_diTau[3][idx*kMaxFitParams + k] = d_enTau_lab[k];
+    }
+
+    // likelihood terms of the tau decay branch
+    if ( addSinTheta_ ) {
+      double tanGjAngle_rf = TMath::Tan(gjAngle_rf);
+      for ( int k = 0; k < kMaxFitParams; ++k ) {
+	gradLeg[k] -= d_gjAngle_rf[k]/tanGjAngle_rf;
+      }
+    }
+    if ( isLeptonicDecay ) {
+      double nunuMass_limit = TMath::Sqrt((1. - labframeXFrac)*tauLeptonMass2);
+      if ( nunuMass < nunuMass_limit ) {
+	gradLeg[kMNuNu] += dNLLTauToLepMatrixElement(nunuMass);
+      } else {
+	double d_nunuMass_limit = ( nunuMass_limit > 0. ) ? -0.5*tauLeptonMass2/nunuMass_limit : 0.; // derivative with respect to kXFrac
+	double delta = nunuMass - nunuMass_limit;
+	double penalty = 1. + 1.e+6*square(delta);
+	gradLeg[kXFrac] += dNLLTauToLepMatrixElement(nunuMass_limit)*d_nunuMass_limit;
+	gradLeg[kXFrac] += 2.e+6*delta*(-d_nunuMass_limit)/penalty;
+	gradLeg[kMNuNu] += 2.e+6*delta/penalty;
+      }
+    } else if ( measuredTauLepton.type() == kTauToHadDecay ) {
+      // phase-space term is tauLeptonMass/(2*pVisRestFrame(visMass, nunuMass, tauLeptonMass)),
+      // divided by a penalty term for x below the kinematic limit visMass^2/tauLeptonMass^2 or above 1
+      double a = tauLeptonMass2 - square(visMass + nunuMass);
+      double b = tauLeptonMass2 - square(visMass - nunuMass);
+      double x_limit = square(visMass)/tauLeptonMass2;
+      double delta = 0.;
+      if      ( labframeXFrac < x_limit ) delta = labframeXFrac - x_limit;
+      else if ( labframeXFrac > 1.      ) delta = labframeXFrac - 1.;
+      double penalty = 1. + 1.e+6*square(delta);
+      for ( int k = 0; k < kMaxFitParams; ++k ) {
+	double d_a = -2.*(visMass + nunuMass)*d_visMass[k];
+	double d_b = -2.*(visMass - nunuMass)*d_visMass[k];
+	gradLeg[k] += 0.5*(d_a/a + d_b/b);
+	double d_x = ( k == kXFrac ) ? 1. : 0.;
+	if ( labframeXFrac < x_limit ) {
+	  double d_delta = d_x - 2.*visMass*d_visMass[k]/tauLeptonMass2;
+	  gradLeg[k] += 2.e+6*delta*d_delta/penalty;
+	} else if ( labframeXFrac > 1. ) {
+	  gradLeg[k] += 2.e+6*delta*d_x/penalty;
+	}
+      }
+      if ( shiftVisPt_ && labframeVisMom > 0. ) {
+	// Jacobi factor 1/recTauPtDivGenTauPt in probVisPtShift; the look-up table itself is piecewise constant
+	double recTauPtDivGenTauPt = labframeVisMom_unshifted/labframeVisMom;
+	for ( int k = 0; k < kMaxFitParams; ++k ) {
+	  double d_recTauPtDivGenTauPt = -recTauPtDivGenTauPt*d_labframeVisMom[k]/labframeVisMom;
+	  gradLeg[k] += d_recTauPtDivGenTauPt/recTauPtDivGenTauPt;
+	}
+      }
+    }
+  }
+
+  // MET likelihood term
+  const LorentzVector& fittedDiTauSystem = kinematics_.fittedDiTauSystem;
+  Vector fittedMET = fittedDiTauSystem.Vect() - (measuredTauLeptons_[0].p() + measuredTauLeptons_[1].p()); 
+  double dMETx = measuredMET_.x() - fittedMET.x();
+  double dMETy = measuredMET_.y() - fittedMET.y();
+  if ( covDet_ != 0. ) {
+    double d_nllMET_dMETx = 0.5*(2.*invCovMET_(0,0)*dMETx + (invCovMET_(0,1) + invCovMET_(1,0))*dMETy);
+    double d_nllMET_dMETy = 0.5*((invCovMET_(0,1) + invCovMET_(1,0))*dMETx + 2.*invCovMET_(1,1)*dMETy);
+    for ( int k = 0; k < numFitParams; ++k ) {
+      grad[k] -= metPower_*(d_nllMET_dMETx*d_diTau[0][k] + d_nllMET_dMETy*d_diTau[1][k]);
+    }
+  }
+
+  // terms depending on the mass of the di-tau system
+  double mTauTau = fittedDiTauSystem.mass();
+  if ( mTauTau > 0. ) {
+    double d_nll_dLogM = 0.;
+    if ( addDelta_ ) d_nll_dLogM += 1.;
+    if ( addLogM_ && powerLogM_ > 0. ) d_nll_dLogM += powerLogM_;
+    if ( d_nll_dLogM != 0. ) {
+      for ( int k = 0; k < numFitParams; ++k ) {
+	double d_mTauTau = (fittedDiTauSystem.energy()*d_diTau[3][k] 
+			  - fittedDiTauSystem.px()*d_diTau[0][k] - fittedDiTauSystem.py()*d_diTau[1][k] - fittedDiTauSystem.pz()*d_diTau[2][k])/mTauTau;
+	grad[k] += d_nll_dLogM*d_mTauTau/mTauTau;
+      }
+    }
+  }
+  if ( addDelta_ ) {
+    grad[kMaxFitParams + kXFrac] -= 1./x[kMaxFitParams + kXFrac];
+  }
+
+  // phi penalty term (computed exactly as in prob)
+  if ( addPhiPenalty_ ) {
+    for ( size_t idx = 0; idx < measuredTauLeptons_.size(); ++idx ) {
+      if ( TMath::Abs(idx*kMaxFitParams + x[kPhi]) > TMath::Pi() ) {
+	grad[kPhi] += 2.*(TMath::Abs(x[kPhi]) - TMath::Pi())*(( x[kPhi] > 0. ) ? +1. : -1.);
+      }
+    }
+  }
+
+  return nll;
+}
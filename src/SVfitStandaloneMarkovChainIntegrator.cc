@@ -52,6 +52,8 @@ SVfitStandaloneMarkovChainIntegrator::SVfitStandaloneMarkovChainIntegrator(const
   : name_(""),
     integrand_(0),
     startPosition_and_MomentumFinder_(0),
+    sampleCallBackFunction_(0),
+    statistics_(0),
     x_(0),
     useVariableEpsilon0_(false),
     numIntegrationCalls_(0),
@@ -75,34 +77,12 @@ SVfitStandaloneMarkovChainIntegrator::SVfitStandaloneMarkovChainIntegrator(const
     assert(0);
   }
 
-//--- get parameters defining number of "stochastic moves" performed per integration
-  numIterBurnin_ = numIterBurnin;
-  numIterSampling_ = numIterSampling;
-
 //--- get parameters defining maximum number of attempts to find a valid starting-position for the Markov Chain
   maxCallsStartingPos_ = 1000000;
 
-//--- get parameters defining "simulated annealing" stage at beginning of integration
-  numIterSimAnnealingPhase1_ = numIterSimAnnealingPhase1;
-  numIterSimAnnealingPhase2_ = numIterSimAnnealingPhase2;
-  numIterSimAnnealingPhase1plus2_ = numIterSimAnnealingPhase1_ + numIterSimAnnealingPhase2_;
-  if ( numIterSimAnnealingPhase1plus2_ > numIterBurnin_ ) {
-    std::cerr << "<SVfitStandaloneMarkovChainIntegrator>:"
-	      << "Invalid Configuration Parameters 'numIterSimAnnealingPhase1' = " << numIterSimAnnealingPhase1_ << ","
-	      << " 'numIterSimAnnealingPhase2' = " << numIterSimAnnealingPhase2_ << ","
-	      << " sim. Annealing and Sampling stages must not overlap --> ABORTING !!\n";
-    assert(0);
-  }
   T0_ = T0;
   sqrtT0_ = TMath::Sqrt(T0_);
-  alpha_ = alpha;
-  if ( !(alpha_ > 0. && alpha_ < 1.) ) {
-    std::cerr << "<SVfitStandaloneMarkovChainIntegrator>:"
-	      << "Invalid Configuration Parameter 'alpha' = " << alpha_ << "," 
-	      << " value within interval ]0..1[ expected --> ABORTING !!\n";
-    assert(0);
-  }
-  alpha2_ = square(alpha_);
+  setSimAnnealingAlpha(alpha);
   
 //--- get parameter specifying how many Markov Chains are run in parallel
   numChains_ = numChains;
@@ -120,12 +100,12 @@ SVfitStandaloneMarkovChainIntegrator::SVfitStandaloneMarkovChainIntegrator(const
 	      << " value greater 0 expected --> ABORTING !!\n";
     assert(0);
   }
-  if ( (numIterSampling_ % numBatches_) != 0 ) {
-    std::cerr << "<SVfitStandaloneMarkovChainIntegrator>:"
-	      << "Invalid Configuration Parameter 'numBatches' = " << numBatches_ << "," 
-	      << " factor of numIterSampling = " << numIterSampling_ << " expected --> ABORTING !!\n";
-    assert(0);
-  }
+
+//--- get parameters defining number of "stochastic moves" performed per integration
+//    and "simulated annealing" stage at beginning of integration
+  setNumIterations(numIterBurnin, numIterSampling, numIterSimAnnealingPhase1, numIterSimAnnealingPhase2);
+
+  seed_ = 12345;
   
 //--- get parameters specific to "dynamic moves" 
   L_ = L;
@@ -135,6 +115,42 @@ SVfitStandaloneMarkovChainIntegrator::SVfitStandaloneMarkovChainIntegrator(const
   verbose_ = verbose;
 }
 
+void SVfitStandaloneMarkovChainIntegrator::setSimAnnealingAlpha(double alpha)
+{
+  alpha_ = alpha;
+  if ( !(alpha_ > 0. && alpha_ < 1.) ) {
+    std::cerr << "<SVfitStandaloneMarkovChainIntegrator>:"
+	      << "Invalid Configuration Parameter 'alpha' = " << alpha_ << "," 
+	      << " value within interval ]0..1[ expected --> ABORTING !!\n";
+    assert(0);
+  }
+  alpha2_ = square(alpha_);
+}
+
+void SVfitStandaloneMarkovChainIntegrator::setNumIterations(unsigned numIterBurnin, unsigned numIterSampling, 
+							    unsigned numIterSimAnnealingPhase1, unsigned numIterSimAnnealingPhase2)
+{
+  numIterBurnin_ = numIterBurnin;
+  numIterSampling_ = numIterSampling;
+
+  numIterSimAnnealingPhase1_ = numIterSimAnnealingPhase1;
+  numIterSimAnnealingPhase2_ = numIterSimAnnealingPhase2;
+  numIterSimAnnealingPhase1plus2_ = numIterSimAnnealingPhase1_ + numIterSimAnnealingPhase2_;
+  if ( numIterSimAnnealingPhase1plus2_ > numIterBurnin_ ) {
+    std::cerr << "<SVfitStandaloneMarkovChainIntegrator>:"
+	      << "Invalid Configuration Parameters 'numIterSimAnnealingPhase1' = " << numIterSimAnnealingPhase1_ << ","
+	      << " 'numIterSimAnnealingPhase2' = " << numIterSimAnnealingPhase2_ << ","
+	      << " sim. Annealing and Sampling stages must not overlap --> ABORTING !!\n";
+    assert(0);
+  }
+  if ( (numIterSampling_ % numBatches_) != 0 ) {
+    std::cerr << "<SVfitStandaloneMarkovChainIntegrator>:"
+	      << "Invalid Configuration Parameter 'numBatches' = " << numBatches_ << "," 
+	      << " factor of numIterSampling = " << numIterSampling_ << " expected --> ABORTING !!\n";
+    assert(0);
+  }
+}
+
 SVfitStandaloneMarkovChainIntegrator::~SVfitStandaloneMarkovChainIntegrator()
 {
   if ( verbose_ >= 0 ) {
@@ -205,6 +221,11 @@ void SVfitStandaloneMarkovChainIntegrator::registerCallBackFunction(const ROOT::
   callBackFunctions_.push_back(&function);
 }
 
+void SVfitStandaloneMarkovChainIntegrator::registerCallBackFunction(const SVfitStandaloneMarkovChainCallBackFunction& function)
+{
+  stateCallBackFunctions_.push_back(&function);
+}
+
 void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>& xMin, const std::vector<double>& xMax, 
 						     double& integral, double& integralErr, int& errorFlag)
 {
@@ -235,7 +256,7 @@ void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>&
   
 //--- CV: set random number generator used to initialize starting-position
 //        for each integration, in order to make integration results independent of processing history
-  rnd_.SetSeed(12345);
+  rnd_.SetSeed(seed_);
 
   numMoves_accepted_ = 0;
   numMoves_rejected_ = 0;
@@ -245,7 +266,11 @@ void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>&
 
   numChainsRun_ = 0; 
 
+  if ( statistics_ ) statistics_->numChains += numChains_;
+  svFitStandalone::Statistics::Clock::time_point time;
+
   for ( unsigned iChain = 0; iChain < numChains_; ++iChain ) {
+    if ( statistics_ ) time = svFitStandalone::Statistics::Clock::now();
     bool isValidStartPos = false;
     if ( initMode_ == kNone ) {
       prob_ = evalProb(q_);
@@ -295,6 +320,10 @@ void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>&
       }
       ++iTry;
     }
+    if ( statistics_ ) {
+      statistics_->numStartPositionTries += ( initMode_ == kNone ) ? iTry + 1 : iTry;
+      statistics_->timeStartPosition += svFitStandalone::Statistics::elapsed(time);
+    }
     if ( !isValidStartPos ) continue;
 
     for ( unsigned iMove = 0; iMove < numIterBurnin_; ++iMove ) {
@@ -307,6 +336,12 @@ void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>&
       do {
 	makeStochasticMove(iMove, isAccepted, isValid);
       } while ( !isValid );
+      if ( statistics_ ) {
+	svFitStandalone::Statistics::Phase phase = burninPhase(iMove);
+	if ( isAccepted ) ++statistics_->numMovesAccepted[phase];
+	else ++statistics_->numMovesRejected[phase];
+	if ( (iMove + 1) == numIterBurnin_ || burninPhase(iMove + 1) != phase ) statistics_->timePhase[phase] += svFitStandalone::Statistics::elapsed(time);
+      }
     }
 
     unsigned idxBatch = iChain*numBatches_;
@@ -324,8 +359,10 @@ void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>&
       } while ( !isValid );
       if ( isAccepted ) {
 	++numMoves_accepted_;
+	if ( statistics_ ) ++statistics_->numMovesAccepted[svFitStandalone::Statistics::kSampling];
       } else {
 	++numMoves_rejected_;
+	if ( statistics_ ) ++statistics_->numMovesRejected[svFitStandalone::Statistics::kSampling];
       }
 
       updateX(q_);
@@ -333,11 +370,29 @@ void SVfitStandaloneMarkovChainIntegrator::integrate(const std::vector<double>&
 	    callBackFunction != callBackFunctions_.end(); ++callBackFunction ) {
 	(**callBackFunction)(x_);
       }
+//--- the first sampling move of each chain always starts a new state,
+//    as the position reached at the end of the burn-in stage has not been passed to any call-back function yet
+      bool isNewState = ( isAccepted || iMove == 0 );
+      for ( std::vector<const SVfitStandaloneMarkovChainCallBackFunction*>::const_iterator callBackFunction = stateCallBackFunctions_.begin();
+	    callBackFunction != stateCallBackFunctions_.end(); ++callBackFunction ) {
+	(*callBackFunction)->EvalCallBack(x_, isNewState);
+      }
+      if ( sampleCallBackFunction_ ) sampleCallBackFunction_->EvalSample(iChain, isAccepted, prob_, x_);
 
       if ( iMove > 0 && (iMove % m) == 0 ) ++idxBatch;
       probSum_[idxBatch] += prob_;
     }
 
+    for ( std::vector<const SVfitStandaloneMarkovChainCallBackFunction*>::const_iterator callBackFunction = stateCallBackFunctions_.begin();
+	  callBackFunction != stateCallBackFunctions_.end(); ++callBackFunction ) {
+      (*callBackFunction)->Flush();
+    }
+
+    if ( statistics_ ) {
+      statistics_->timePhase[svFitStandalone::Statistics::kSampling] += svFitStandalone::Statistics::elapsed(time);
+      ++statistics_->numChainsRun;
+    }
+
     ++numChainsRun_;
   }
 
@@ -568,7 +623,9 @@ void SVfitStandaloneMarkovChainIntegrator::makeStochasticMove(unsigned idxMove,
     for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {    
       q_[iDimension] = qProposal_[iDimension];
     }
-    prob_ = evalProb(q_);
+//--- integrand has already been evaluated at the proposed point,
+//    no need to evaluate it again
+    prob_ = probProposal;
     isAccepted = true;
   } else {
     //if ( verbose_ >= 2 ) std::cout << "move rejected." << std::endl;
@@ -576,6 +633,13 @@ void SVfitStandaloneMarkovChainIntegrator::makeStochasticMove(unsigned idxMove,
   }
 }
 
+svFitStandalone::Statistics::Phase SVfitStandaloneMarkovChainIntegrator::burninPhase(unsigned idxMove) const
+{
+  if      ( idxMove < numIterSimAnnealingPhase1_      ) return svFitStandalone::Statistics::kSimAnnealingPhase1;
+  else if ( idxMove < numIterSimAnnealingPhase1plus2_ ) return svFitStandalone::Statistics::kSimAnnealingPhase2;
+  else                                                  return svFitStandalone::Statistics::kBurnin;
+}
+
 void SVfitStandaloneMarkovChainIntegrator::updateX(const std::vector<double>& q)
 {
   //std::cout << "<MarkovChainIntegrator::updateX>:" << std::endl;
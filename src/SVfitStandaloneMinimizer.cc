@@ -0,0 +1,442 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneMinimizer.h"
+
+#include <TMath.h>
+
+#include <iostream>
+#include <limits>
+#include <algorithm>
+#include <assert.h>
+
+namespace
+{
+  const double edmMax = 1.e-5;       // same convergence criterion as Minuit2 (0.002*tolerance*errorDef, with default tolerance = 0.01) for errorDef = 0.5
+  const unsigned maxLineSearchSteps = 30;
+
+  // inverse of positive definite matrix by Cholesky decomposition, return false in case matrix is not positive definite
+  bool invertPosDef(const double* A, double* Ainv, unsigned n)
+  {
+    const unsigned kMaxDim = SVfitStandaloneMinimizer::kMaxDim;
+    double L[kMaxDim*kMaxDim];
+    for ( unsigned i = 0; i < n; ++i ) {
+      for ( unsigned j = 0; j <= i; ++j ) {
+	double sum = A[i*n + j];
+	for ( unsigned k = 0; k < j; ++k ) {
+	  sum -= L[i*n + k]*L[j*n + k];
+	}
+	if ( i == j ) {
+	  if ( !(sum > 0.) ) return false;
+	  L[i*n + i] = TMath::Sqrt(sum);
+	} else {
+	  L[i*n + j] = sum/L[j*n + j];
+	}
+      }
+    }
+    // invert L, then compute Ainv = L^-T L^-1
+    double Linv[kMaxDim*kMaxDim];
+    for ( unsigned i = 0; i < n; ++i ) {
+      for ( unsigned j = 0; j < n; ++j ) {
+	Linv[i*n + j] = 0.;
+      }
+      Linv[i*n + i] = 1./L[i*n + i];
+      for ( unsigned j = 0; j < i; ++j ) {
+	double sum = 0.;
+	for ( unsigned k = j; k < i; ++k ) {
+	  sum -= L[i*n + k]*Linv[k*n + j];
+	}
+	Linv[i*n + j] = sum/L[i*n + i];
+      }
+    }
+    for ( unsigned i = 0; i < n; ++i ) {
+      for ( unsigned j = 0; j <= i; ++j ) {
+	double sum = 0.;
+	for ( unsigned k = i; k < n; ++k ) {
+	  sum += Linv[k*n + i]*Linv[k*n + j];
+	}
+	Ainv[i*n + j] = sum;
+	Ainv[j*n + i] = sum;
+      }
+    }
+    return true;
+  }
+}
+
+SVfitStandaloneMinimizer::SVfitStandaloneMinimizer()
+  : function_(0),
+    gradFunction_(0),
+    maxFunctionCalls_(10000),
+    errorDef_(0.5)
+{
+  clear();
+}
+
+void
+SVfitStandaloneMinimizer::clear()
+{
+  numDimensions_ = 0;
+  for ( unsigned idx = 0; idx < kMaxDim; ++idx ) {
+    type_[idx] = kUndefined;
+    value_[idx] = 0.;
+    step_[idx] = 0.;
+    lower_[idx] = 0.;
+    upper_[idx] = 0.;
+    x_[idx] = 0.;
+    errors_[idx] = 0.;
+  }
+  numFree_ = 0;
+  status_ = -1;
+  fMin_ = 0.;
+  edm_ = 0.;
+  numCalls_ = 0;
+}
+
+void
+SVfitStandaloneMinimizer::setVariable(unsigned idx, double value, double step)
+{
+  assert(idx < kMaxDim);
+  type_[idx] = kFree;
+  value_[idx] = value;
+  step_[idx] = step;
+  numDimensions_ = TMath::Max(numDimensions_, idx + 1);
+}
+
+void
+SVfitStandaloneMinimizer::setLimitedVariable(unsigned idx, double value, double step, double lower, double upper)
+{
+  assert(idx < kMaxDim);
+  if ( !(upper > lower) ) {
+    std::cerr << "<SVfitStandaloneMinimizer>:"
+	      << "Invalid limits = { " << lower << ", " << upper << " } for parameter #" << idx << " --> ABORTING !!\n";
+    assert(0);
+  }
+  type_[idx] = kLimited;
+  value_[idx] = TMath::Min(TMath::Max(value, lower), upper);
+  step_[idx] = step;
+  lower_[idx] = lower;
+  upper_[idx] = upper;
+  numDimensions_ = TMath::Max(numDimensions_, idx + 1);
+}
+
+void
+SVfitStandaloneMinimizer::setFixedVariable(unsigned idx, double value)
+{
+  assert(idx < kMaxDim);
+  type_[idx] = kFixed;
+  value_[idx] = value;
+  step_[idx] = 0.;
+  numDimensions_ = TMath::Max(numDimensions_, idx + 1);
+}
+
+double
+SVfitStandaloneMinimizer::int2ext(unsigned idx, double u) const
+{
+  if ( type_[idx] == kLimited ) return lower_[idx] + 0.5*(upper_[idx] - lower_[idx])*(TMath::Sin(u) + 1.);
+  else return u;
+}
+
+double
+SVfitStandaloneMinimizer::ext2int(unsigned idx, double x) const
+{
+  if ( type_[idx] == kLimited ) {
+    double y = 2.*(x - lower_[idx])/(upper_[idx] - lower_[idx]) - 1.;
+    return TMath::ASin(TMath::Min(TMath::Max(y, -1.), +1.));
+  } else {
+    return x;
+  }
+}
+
+double
+SVfitStandaloneMinimizer::dInt2Ext(unsigned idx, double u) const
+{
+  if ( type_[idx] == kLimited ) return 0.5*(upper_[idx] - lower_[idx])*TMath::Cos(u);
+  else return 1.;
+}
+
+double
+SVfitStandaloneMinimizer::int2extError(unsigned idx, double u, double uErr) const
+{
+//--- same conversion as done by Minuit2 for bounded parameters
+  if ( type_[idx] == kLimited ) {
+    double x = int2ext(idx, u);
+    double dx1 = int2ext(idx, u + uErr) - x;
+    double dx2 = int2ext(idx, u - uErr) - x;
+    if ( uErr > 1. ) dx1 = upper_[idx] - lower_[idx];
+    return 0.5*(TMath::Abs(dx1) + TMath::Abs(dx2));
+  } else {
+    return uErr;
+  }
+}
+
+double
+SVfitStandaloneMinimizer::eval(const double* u, double* grad)
+{
+  for ( unsigned iFree = 0; iFree < numFree_; ++iFree ) {
+    unsigned idx = idxFree_[iFree];
+    xExt_[idx] = int2ext(idx, u[iFree]);
+  }
+  double f = 0.;
+  if ( gradFunction_ ) {
+    gradFunction_->FdF(xExt_, f, gradExt_);
+    ++numCalls_;
+  } else {
+    f = (*function_)(xExt_);
+    ++numCalls_;
+//--- compute derivatives numerically by central differences
+    for ( unsigned iFree = 0; iFree < numFree_; ++iFree ) {
+      unsigned idx = idxFree_[iFree];
+      double x0 = xExt_[idx];
+      double h = 1.e-6*TMath::Max(1., TMath::Abs(x0));
+      if ( type_[idx] == kLimited ) h = TMath::Min(h, 0.25*(upper_[idx] - lower_[idx]));
+      xExt_[idx] = x0 + h;
+      double fPlus = (*function_)(xExt_);
+      xExt_[idx] = x0 - h;
+      double fMinus = (*function_)(xExt_);
+      xExt_[idx] = x0;
+      numCalls_ += 2;
+      gradExt_[idx] = (fPlus - fMinus)/(2.*h);
+    }
+  }
+  for ( unsigned iFree = 0; iFree < numFree_; ++iFree ) {
+    unsigned idx = idxFree_[iFree];
+    grad[iFree] = gradExt_[idx]*dInt2Ext(idx, u[iFree]);
+  }
+  return f;
+}
+
+int
+SVfitStandaloneMinimizer::compCovariance(const double* u, double* cov)
+{
+//--- compute Hessian matrix by central differences of the gradient
+  const unsigned n = numFree_;
+  double hessian[kMaxDim*kMaxDim];
+  double uShifted[kMaxDim];
+  double gradPlus[kMaxDim];
+  double gradMinus[kMaxDim];
+  std::copy(u, u + n, uShifted);
+  for ( unsigned j = 0; j < n; ++j ) {
+    double h = 1.e-4*TMath::Max(1., TMath::Abs(u[j]));
+    uShifted[j] = u[j] + h;
+    eval(uShifted, gradPlus);
+    uShifted[j] = u[j] - h;
+    eval(uShifted, gradMinus);
+    uShifted[j] = u[j];
+    for ( unsigned i = 0; i < n; ++i ) {
+      hessian[i*n + j] = (gradPlus[i] - gradMinus[i])/(2.*h);
+    }
+  }
+  for ( unsigned i = 0; i < n; ++i ) {
+    for ( unsigned j = 0; j < i; ++j ) {
+      double hessian_ij = 0.5*(hessian[i*n + j] + hessian[j*n + i]);
+      hessian[i*n + j] = hessian_ij;
+      hessian[j*n + i] = hessian_ij;
+    }
+  }
+
+//--- invert Hessian matrix;
+//    in case it is not positive definite, add a positive constant to the diagonal elements (as done by Minuit)
+  int status = 0;
+  double maxDiag = 0.;
+  for ( unsigned i = 0; i < n; ++i ) {
+    maxDiag = TMath::Max(maxDiag, TMath::Abs(hessian[i*n + i]));
+  }
+  if ( !(maxDiag > 0.) ) maxDiag = 1.;
+  double epsilon = 1.e-3*maxDiag;
+  double hessianInv[kMaxDim*kMaxDim];
+  while ( !invertPosDef(hessian, hessianInv, n) ) {
+    status = 1;
+    for ( unsigned i = 0; i < n; ++i ) {
+      hessian[i*n + i] += epsilon;
+    }
+    epsilon *= 2.;
+//--- give up in case the Hessian matrix cannot be made positive definite (e.g. if it contains NaN values);
+//    the covariance matrix is not computed in this case
+    if ( !(epsilon < 1.e+6*maxDiag) ) return 2;
+  }
+  for ( unsigned i = 0; i < n*n; ++i ) {
+    cov[i] = 2.*errorDef_*hessianInv[i];
+  }
+  return status;
+}
+
+bool
+SVfitStandaloneMinimizer::minimize(const ROOT::Math::IMultiGenFunction& function)
+{
+  function_ = &function;
+  gradFunction_ = dynamic_cast<const ROOT::Math::IMultiGradFunction*>(&function);
+  numCalls_ = 0;
+  status_ = 5;
+
+  numFree_ = 0;
+  for ( unsigned idx = 0; idx < numDimensions_; ++idx ) {
+    if ( type_[idx] == kUndefined ) {
+      std::cerr << "<SVfitStandaloneMinimizer>:"
+		<< "Parameter #" << idx << " has not been defined --> ABORTING !!\n";
+      assert(0);
+    }
+    xExt_[idx] = value_[idx];
+    gradExt_[idx] = 0.;
+    x_[idx] = value_[idx];
+    errors_[idx] = 0.;
+    if ( type_[idx] != kFixed ) {
+      idxFree_[numFree_] = idx;
+      ++numFree_;
+    }
+  }
+  const unsigned n = numFree_;
+
+  double u[kMaxDim];
+  double grad[kMaxDim];
+  for ( unsigned iFree = 0; iFree < n; ++iFree ) {
+    unsigned idx = idxFree_[iFree];
+    u[iFree] = ext2int(idx, value_[idx]);
+  }
+  double f = eval(u, grad);
+
+//--- initialize inverse Hessian matrix by numerical second derivatives along the coordinate axes,
+//    falling back to the step size given for each parameter in case the second derivative is not positive
+  double H[kMaxDim*kMaxDim];
+  double H0[kMaxDim];
+  double uShifted[kMaxDim];
+  double gradShifted[kMaxDim];
+  std::copy(u, u + n, uShifted);
+  for ( unsigned i = 0; i < n; ++i ) {
+    unsigned idx = idxFree_[i];
+    double uStep = step_[idx]/TMath::Max(TMath::Abs(dInt2Ext(idx, u[i])), 1.e-3);
+    if ( !(uStep > 0.) ) uStep = 0.1;
+    double h = TMath::Min(0.1*uStep, 1.e-2);
+    uShifted[i] = u[i] + h;
+    eval(uShifted, gradShifted);
+    uShifted[i] = u[i];
+    double d2f = (gradShifted[i] - grad[i])/h;
+    H0[i] = ( d2f > 0. && !TMath::IsNaN(d2f) ) ? 1./d2f : uStep*uStep;
+  }
+  for ( unsigned i = 0; i < n; ++i ) {
+    for ( unsigned j = 0; j < n; ++j ) {
+      H[i*n + j] = ( i == j ) ? H0[i] : 0.;
+    }
+  }
+
+  double p[kMaxDim];
+  double uNew[kMaxDim];
+  double gradNew[kMaxDim];
+  double s[kMaxDim];
+  double y[kMaxDim];
+  double Hy[kMaxDim];
+  bool isConverged = false;
+  bool isFailed = false;
+  bool isReset = false;
+  edm_ = 0.;
+  while ( !isConverged && !isFailed ) {
+    // compute estimated distance to minimum and search direction
+    edm_ = 0.;
+    double gp = 0.;
+    for ( unsigned i = 0; i < n; ++i ) {
+      double Hg_i = 0.;
+      for ( unsigned j = 0; j < n; ++j ) {
+	Hg_i += H[i*n + j]*grad[j];
+      }
+      p[i] = -Hg_i;
+      edm_ += 0.5*grad[i]*Hg_i;
+      gp += grad[i]*p[i];
+    }
+    if ( edm_ >= 0. && edm_ < edmMax ) {
+      isConverged = true;
+      break;
+    }
+    if ( numCalls_ >= maxFunctionCalls_ ) break;
+    if ( !(gp < 0.) ) {
+      // not a descent direction: reset inverse Hessian matrix
+      if ( isReset ) {
+	isFailed = true;
+	break;
+      }
+      for ( unsigned i = 0; i < n; ++i ) {
+	for ( unsigned j = 0; j < n; ++j ) {
+	  H[i*n + j] = ( i == j ) ? H0[i] : 0.;
+	}
+      }
+      isReset = true;
+      continue;
+    }
+
+    // backtracking line search, satisfying the Armijo condition
+    double alpha = 1.;
+    double fNew = f;
+    bool isAccepted = false;
+    for ( unsigned iStep = 0; iStep < maxLineSearchSteps && numCalls_ < maxFunctionCalls_; ++iStep ) {
+      for ( unsigned i = 0; i < n; ++i ) {
+	uNew[i] = u[i] + alpha*p[i];
+      }
+      fNew = eval(uNew, gradNew);
+      if ( !TMath::IsNaN(fNew) && fNew <= (f + 1.e-4*alpha*gp) ) {
+	isAccepted = true;
+	break;
+      }
+      // minimum of quadratic interpolation, restricted to interval [0.1, 0.5]*alpha
+      double alphaNew = ( !TMath::IsNaN(fNew) ) ? -0.5*gp*alpha*alpha/(fNew - f - gp*alpha) : 0.1*alpha;
+      alpha = TMath::Min(TMath::Max(alphaNew, 0.1*alpha), 0.5*alpha);
+    }
+    if ( !isAccepted ) {
+      if ( numCalls_ >= maxFunctionCalls_ ) break;
+      if ( isReset ) {
+	isFailed = true;
+	break;
+      }
+      for ( unsigned i = 0; i < n; ++i ) {
+	for ( unsigned j = 0; j < n; ++j ) {
+	  H[i*n + j] = ( i == j ) ? H0[i] : 0.;
+	}
+      }
+      isReset = true;
+      continue;
+    }
+    isReset = false;
+
+    // BFGS update of inverse Hessian matrix
+    double sy = 0.;
+    for ( unsigned i = 0; i < n; ++i ) {
+      s[i] = uNew[i] - u[i];
+      y[i] = gradNew[i] - grad[i];
+      sy += s[i]*y[i];
+    }
+    if ( sy > 0. ) {
+      double yHy = 0.;
+      for ( unsigned i = 0; i < n; ++i ) {
+	Hy[i] = 0.;
+	for ( unsigned j = 0; j < n; ++j ) {
+	  Hy[i] += H[i*n + j]*y[j];
+	}
+	yHy += y[i]*Hy[i];
+      }
+      for ( unsigned i = 0; i < n; ++i ) {
+	for ( unsigned j = 0; j < n; ++j ) {
+	  H[i*n + j] += ((sy + yHy)*s[i]*s[j])/(sy*sy) - (Hy[i]*s[j] + s[i]*Hy[j])/sy;
+	}
+      }
+    }
+    std::copy(uNew, uNew + n, u);
+    std::copy(gradNew, gradNew + n, grad);
+    f = fNew;
+  }
+
+  fMin_ = f;
+  for ( unsigned iFree = 0; iFree < n; ++iFree ) {
+    unsigned idx = idxFree_[iFree];
+    x_[idx] = int2ext(idx, u[iFree]);
+  }
+
+  if ( isConverged ) {
+    double cov[kMaxDim*kMaxDim];
+    status_ = compCovariance(u, cov);
+    if ( status_ <= 1 ) {
+      for ( unsigned iFree = 0; iFree < n; ++iFree ) {
+	unsigned idx = idxFree_[iFree];
+	errors_[idx] = int2extError(idx, u[iFree], TMath::Sqrt(TMath::Max(0., cov[iFree*n + iFree])));
+      }
+    }
+  } else if ( !isFailed && numCalls_ >= maxFunctionCalls_ ) {
+    status_ = 4;
+  } else {
+    status_ = 5;
+  }
+  return ( status_ <= 1 );
+}
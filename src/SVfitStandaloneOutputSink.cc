@@ -0,0 +1,441 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneOutputSink.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstring>
+#include <assert.h>
+
+using namespace svFitStandalone;
+
+namespace
+{
+  const char dataFileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'P', 'O', '2' };
+  const char indexFileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'P', 'I', '1' };
+
+  struct IndexEntry
+  {
+    unsigned long long run;
+    unsigned long long lumi;
+    unsigned long long event;
+    unsigned long long offset;
+    unsigned long long size;
+  };
+
+  // encoding of events: sequence of 4-byte words
+  //   numGraphs, numHistograms,
+  //   for each graph:     name, numPoints, x[numPoints], y[numPoints], xErr[numPoints], yErr[numPoints]
+  //   for each histogram: name, binningOffset (2 words), numNonEmptyBins, { bin, binContent, binError } for each non-empty bin
+  //   for each binning that differs from the last one written for a histogram of the same name: numBins, binEdges[numBins + 1]
+  // with name = length, characters padded to a multiple of 4 bytes, and binningOffset = position of the binning in the data file;
+  // bins are numbered as in OutputHistogram (0 = underflow, numBins + 1 = overflow)
+  void encode(std::vector<char>& data, unsigned value)
+  {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(value));
+  }
+
+  void encode(std::vector<char>& data, unsigned long long value)
+  {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(value));
+  }
+
+  void encode(std::vector<char>& data, float value)
+  {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    data.insert(data.end(), bytes, bytes + sizeof(value));
+  }
+
+  void encode(std::vector<char>& data, const std::string& value)
+  {
+    encode(data, (unsigned)value.size());
+    data.insert(data.end(), value.begin(), value.end());
+    data.resize(data.size() + (4 - value.size() % 4) % 4, 0);
+  }
+
+  void encode(std::vector<char>& data, const std::vector<float>& values)
+  {
+    const char* bytes = reinterpret_cast<const char*>(values.data());
+    data.insert(data.end(), bytes, bytes + values.size()*sizeof(float));
+  }
+
+  // the decoder checks that no word beyond the end of the block is read
+  struct Decoder
+  {
+    Decoder(const char* data, size_t size) : data_(data), size_(size), position_(0) {}
+    const char* get(size_t numBytes)
+    {
+      if ( position_ + numBytes > size_ ) {
+	std::cerr << "<SVfitStandaloneOutputReader>:"
+		  << "Corrupted event block --> ABORTING !!\n";
+	assert(0);
+      }
+      const char* data = data_ + position_;
+      position_ += numBytes;
+      return data;
+    }
+    unsigned getUnsigned()
+    {
+      unsigned value;
+      memcpy(&value, get(sizeof(value)), sizeof(value));
+      return value;
+    }
+    unsigned long long getUnsignedLong()
+    {
+      unsigned long long value;
+      memcpy(&value, get(sizeof(value)), sizeof(value));
+      return value;
+    }
+    float getFloat()
+    {
+      float value;
+      memcpy(&value, get(sizeof(value)), sizeof(value));
+      return value;
+    }
+    std::string getString()
+    {
+      unsigned length = getUnsigned();
+      std::string value(get(length), length);
+      get((4 - length % 4) % 4);
+      return value;
+    }
+    void getFloats(std::vector<float>& values, size_t numValues)
+    {
+      values.resize(numValues);
+      if ( numValues > 0 ) memcpy(values.data(), get(numValues*sizeof(float)), numValues*sizeof(float));
+    }
+    const char* data_;
+    size_t size_;
+    size_t position_;
+  };
+}
+
+void
+OutputEvent::clear()
+{
+  graphs.clear();
+  histograms.clear();
+}
+
+void
+OutputEvent::addGraph(const std::string& name, size_t numPoints, const double* x, const double* y, const double* xErr, const double* yErr)
+{
+  graphs.push_back(OutputGraph());
+  OutputGraph& graph = graphs.back();
+  graph.name = name;
+  graph.x.assign(x, x + numPoints);
+  graph.y.assign(y, y + numPoints);
+  graph.xErr.assign(xErr, xErr + numPoints);
+  graph.yErr.assign(yErr, yErr + numPoints);
+}
+
+void
+OutputEvent::addHistogram(const FlatHistogram& flatHistogram)
+{
+  histograms.push_back(OutputHistogram());
+  OutputHistogram& histogram = histograms.back();
+  histogram.name = flatHistogram.GetName();
+  int numBins = flatHistogram.GetNbinsX();
+  histogram.binEdges.resize(numBins + 1);
+  for ( int iBin = 1; iBin <= (numBins + 1); ++iBin ) {
+    histogram.binEdges[iBin - 1] = flatHistogram.GetBinLowEdge(iBin);
+  }
+  histogram.binContents.resize(numBins + 2);
+  histogram.binErrors.resize(numBins + 2);
+  for ( int iBin = 0; iBin <= (numBins + 1); ++iBin ) {
+    histogram.binContents[iBin] = flatHistogram.GetBinContent(iBin);
+    histogram.binErrors[iBin] = flatHistogram.GetBinError(iBin);
+  }
+}
+
+SVfitStandaloneOutputSink::SVfitStandaloneOutputSink(const std::string& fileName, size_t maxBufferedBytes)
+  : fileName_(fileName),
+    dataFile_(0),
+    indexFile_(0),
+    dataFileSize_(0),
+    numEvents_(0),
+    maxBufferedBytes_(maxBufferedBytes),
+    queuedDataFileSize_(0),
+    bufferedBytes_(0),
+    isWriting_(false),
+    isStopped_(false),
+    isFailed_(false)
+{
+  dataFile_ = fopen(fileName_.data(), "wb");
+  indexFile_ = fopen((fileName_ + ".idx").data(), "wb");
+  if ( !(dataFile_ && indexFile_) ) {
+    std::cerr << "<SVfitStandaloneOutputSink>:"
+	      << "Failed to create file = " << fileName_ << " --> ABORTING !!\n";
+    assert(0);
+  }
+  fwrite(dataFileFormat, sizeof(dataFileFormat), 1, dataFile_);
+  fwrite(indexFileFormat, sizeof(indexFileFormat), 1, indexFile_);
+  dataFileSize_ = sizeof(dataFileFormat);
+  queuedDataFileSize_ = dataFileSize_;
+  writer_ = std::thread(&SVfitStandaloneOutputSink::writeBlocks, this);
+}
+
+SVfitStandaloneOutputSink::~SVfitStandaloneOutputSink()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopped_ = true;
+  }
+  queueChanged_.notify_all();
+  writer_.join();
+  fclose(dataFile_);
+  fclose(indexFile_);
+}
+
+void
+SVfitStandaloneOutputSink::write(const OutputEvent& event)
+{
+  Block block;
+  block.run = event.run;
+  block.lumi = event.lumi;
+  block.event = event.event;
+  encode(block.data, (unsigned)event.graphs.size());
+  encode(block.data, (unsigned)event.histograms.size());
+  for ( std::vector<OutputGraph>::const_iterator graph = event.graphs.begin(); graph != event.graphs.end(); ++graph ) {
+    encode(block.data, graph->name);
+    encode(block.data, (unsigned)graph->x.size());
+    encode(block.data, graph->x);
+    encode(block.data, graph->y);
+    encode(block.data, graph->xErr);
+    encode(block.data, graph->yErr);
+  }
+  std::vector<size_t> binningOffsetPositions;
+  for ( std::vector<OutputHistogram>::const_iterator histogram = event.histograms.begin(); histogram != event.histograms.end(); ++histogram ) {
+    encode(block.data, histogram->name);
+    // the position of the binning in the data file is filled in below
+    binningOffsetPositions.push_back(block.data.size());
+    encode(block.data, 0ULL);
+    size_t numNonEmptyBinsPosition = block.data.size();
+    encode(block.data, 0U);
+    unsigned numNonEmptyBins = 0;
+    for ( size_t iBin = 0; iBin < histogram->binContents.size(); ++iBin ) {
+      if ( histogram->binContents[iBin] == 0. && histogram->binErrors[iBin] == 0. ) continue;
+      encode(block.data, (unsigned)iBin);
+      encode(block.data, histogram->binContents[iBin]);
+      encode(block.data, histogram->binErrors[iBin]);
+      ++numNonEmptyBins;
+    }
+    memcpy(&block.data[numNonEmptyBinsPosition], &numNonEmptyBins, sizeof(numNonEmptyBins));
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  // wait for writer thread in case too much data is waiting to be written
+  queueChanged_.wait(lock, [this]{ return queue_.empty() || bufferedBytes_ < maxBufferedBytes_; });
+  // blocks are written in the order in which they are queued, so the position of this block in the data file is known here;
+  // binnings are appended to the block in case they differ from the last binning written for a histogram of the same name
+  for ( size_t iHistogram = 0; iHistogram < event.histograms.size(); ++iHistogram ) {
+    const OutputHistogram& histogram = event.histograms[iHistogram];
+    std::pair<std::vector<float>, unsigned long long>& binning = binnings_[histogram.name];
+    if ( binning.first != histogram.binEdges || binning.second == 0 ) {
+      binning.first = histogram.binEdges;
+      binning.second = queuedDataFileSize_ + block.data.size();
+      encode(block.data, (unsigned)(histogram.binEdges.size() - 1));
+      encode(block.data, histogram.binEdges);
+    }
+    memcpy(&block.data[binningOffsetPositions[iHistogram]], &binning.second, sizeof(binning.second));
+  }
+  size_t blockSize = block.data.size();
+  queuedDataFileSize_ += blockSize;
+  queue_.push_back(std::move(block));
+  bufferedBytes_ += blockSize;
+  ++numEvents_;
+  lock.unlock();
+  queueChanged_.notify_all();
+}
+
+void
+SVfitStandaloneOutputSink::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  queueChanged_.wait(lock, [this]{ return queue_.empty() && !isWriting_; });
+}
+
+void
+SVfitStandaloneOutputSink::writeBlocks()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while ( true ) {
+    queueChanged_.wait(lock, [this]{ return !queue_.empty() || isStopped_; });
+    if ( queue_.empty() ) break;
+    Block block = std::move(queue_.front());
+    queue_.pop_front();
+    isWriting_ = true;
+    lock.unlock();
+
+    // the index entry is written after the event block, so that the index never refers to an incomplete block
+    bool isFailed = isFailed_;
+    if ( !isFailed ) {
+      isFailed |= ( fwrite(block.data.data(), 1, block.data.size(), dataFile_) != block.data.size() );
+      IndexEntry entry;
+      entry.run = block.run;
+      entry.lumi = block.lumi;
+      entry.event = block.event;
+      entry.offset = dataFileSize_;
+      entry.size = block.data.size();
+      if ( !isFailed ) isFailed |= ( fwrite(&entry, sizeof(entry), 1, indexFile_) != 1 );
+      dataFileSize_ += block.data.size();
+    }
+
+    lock.lock();
+    bufferedBytes_ -= block.data.size();
+    if ( queue_.empty() ) {
+      isFailed |= !flushFiles();
+      isWriting_ = false;
+    }
+    if ( isFailed && !isFailed_ ) reportFailure();
+    isFailed_ = isFailed;
+    queueChanged_.notify_all();
+  }
+  if ( !flushFiles() && !isFailed_ ) {
+    reportFailure();
+    isFailed_ = true;
+  }
+  isWriting_ = false;
+}
+
+bool
+SVfitStandaloneOutputSink::flushFiles()
+{
+  bool isFailed = false;
+  isFailed |= ( fflush(dataFile_) != 0 || ferror(dataFile_) );
+  isFailed |= ( fflush(indexFile_) != 0 || ferror(indexFile_) );
+  return !isFailed;
+}
+
+void
+SVfitStandaloneOutputSink::reportFailure() const
+{
+  std::cerr << "<SVfitStandaloneOutputSink::writeBlocks>:"
+	    << "Failed to write file = " << fileName_ << ", discarding all subsequent events !!\n";
+}
+
+SVfitStandaloneOutputReader::SVfitStandaloneOutputReader(const std::string& fileName)
+  : fileName_(fileName),
+    data_(0),
+    dataSize_(0),
+    index_(0),
+    indexSize_(0),
+    numEvents_(0)
+{
+  data_ = mapFile(fileName_, dataSize_);
+  index_ = mapFile(fileName_ + ".idx", indexSize_);
+  if ( memcmp(data_, dataFileFormat, sizeof(dataFileFormat)) != 0 || memcmp(index_, indexFileFormat, sizeof(indexFileFormat)) != 0 ) {
+    std::cerr << "<SVfitStandaloneOutputReader>:"
+	      << "File = " << fileName_ << " is not an output file written by this version of SVfit --> ABORTING !!\n";
+    assert(0);
+  }
+  // ignore partially written index entries and entries referring to blocks that are not (completely) in the data file
+  numEvents_ = (indexSize_ - sizeof(indexFileFormat))/sizeof(IndexEntry);
+  while ( numEvents_ > 0 ) {
+    IndexEntry entry;
+    memcpy(&entry, index_ + sizeof(indexFileFormat) + (numEvents_ - 1)*sizeof(IndexEntry), sizeof(entry));
+    if ( entry.offset + entry.size <= dataSize_ ) break;
+    --numEvents_;
+  }
+}
+
+SVfitStandaloneOutputReader::~SVfitStandaloneOutputReader()
+{
+  if ( data_ ) munmap(const_cast<char*>(data_), dataSize_);
+  if ( index_ ) munmap(const_cast<char*>(index_), indexSize_);
+}
+
+const char*
+SVfitStandaloneOutputReader::mapFile(const std::string& fileName, size_t& size)
+{
+  int fd = open(fileName.data(), O_RDONLY);
+  struct stat fileStatus;
+  if ( fd < 0 || fstat(fd, &fileStatus) != 0 || fileStatus.st_size < (off_t)sizeof(dataFileFormat) ) {
+    std::cerr << "<SVfitStandaloneOutputReader>:"
+	      << "Failed to open file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  size = fileStatus.st_size;
+  void* address = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if ( address == MAP_FAILED ) {
+    std::cerr << "<SVfitStandaloneOutputReader>:"
+	      << "Failed to map file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  return static_cast<const char*>(address);
+}
+
+long
+SVfitStandaloneOutputReader::find(unsigned long long run, unsigned long long lumi, unsigned long long event) const
+{
+  if ( eventIndex_.empty() ) {
+    for ( size_t idx = 0; idx < numEvents_; ++idx ) {
+      IndexEntry entry;
+      memcpy(&entry, index_ + sizeof(indexFileFormat) + idx*sizeof(IndexEntry), sizeof(entry));
+      eventIndex_[std::make_tuple(entry.run, entry.lumi, entry.event)] = idx;
+    }
+  }
+  std::map<std::tuple<unsigned long long, unsigned long long, unsigned long long>, size_t>::const_iterator it = eventIndex_.find(std::make_tuple(run, lumi, event));
+  return ( it != eventIndex_.end() ) ? (long)it->second : -1;
+}
+
+void
+SVfitStandaloneOutputReader::read(size_t idx, OutputEvent& event) const
+{
+  if ( idx >= numEvents_ ) {
+    std::cerr << "<SVfitStandaloneOutputReader::read>:"
+	      << "Invalid event index = " << idx << ", file = " << fileName_ << " contains " << numEvents_ << " events --> ABORTING !!\n";
+    assert(0);
+  }
+  IndexEntry entry;
+  memcpy(&entry, index_ + sizeof(indexFileFormat) + idx*sizeof(IndexEntry), sizeof(entry));
+  event.clear();
+  event.run = entry.run;
+  event.lumi = entry.lumi;
+  event.event = entry.event;
+  Decoder decoder(data_ + entry.offset, entry.size);
+  unsigned numGraphs = decoder.getUnsigned();
+  unsigned numHistograms = decoder.getUnsigned();
+  event.graphs.resize(numGraphs);
+  for ( unsigned iGraph = 0; iGraph < numGraphs; ++iGraph ) {
+    OutputGraph& graph = event.graphs[iGraph];
+    graph.name = decoder.getString();
+    unsigned numPoints = decoder.getUnsigned();
+    decoder.getFloats(graph.x, numPoints);
+    decoder.getFloats(graph.y, numPoints);
+    decoder.getFloats(graph.xErr, numPoints);
+    decoder.getFloats(graph.yErr, numPoints);
+  }
+  event.histograms.resize(numHistograms);
+  for ( unsigned iHistogram = 0; iHistogram < numHistograms; ++iHistogram ) {
+    OutputHistogram& histogram = event.histograms[iHistogram];
+    histogram.name = decoder.getString();
+    unsigned long long binningOffset = decoder.getUnsignedLong();
+    // the binning is stored either in this block or in one of the blocks written before
+    if ( !(binningOffset >= sizeof(dataFileFormat) && binningOffset < entry.offset + entry.size) ) {
+      std::cerr << "<SVfitStandaloneOutputReader::read>:"
+		<< "Invalid binning of histogram = " << histogram.name << " in file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+    Decoder binningDecoder(data_ + binningOffset, entry.offset + entry.size - binningOffset);
+    unsigned numBins = binningDecoder.getUnsigned();
+    binningDecoder.getFloats(histogram.binEdges, numBins + 1);
+    histogram.binContents.assign(numBins + 2, 0.);
+    histogram.binErrors.assign(numBins + 2, 0.);
+    unsigned numNonEmptyBins = decoder.getUnsigned();
+    for ( unsigned iNonEmptyBin = 0; iNonEmptyBin < numNonEmptyBins; ++iNonEmptyBin ) {
+      unsigned bin = decoder.getUnsigned();
+      if ( bin > (numBins + 1) ) {
+	std::cerr << "<SVfitStandaloneOutputReader::read>:"
+		  << "Invalid bin = " << bin << " of histogram = " << histogram.name << " in file = " << fileName_ << " --> ABORTING !!\n";
+	assert(0);
+      }
+      histogram.binContents[bin] = decoder.getFloat();
+      histogram.binErrors[bin] = decoder.getFloat();
+    }
+  }
+}
@@ -1,4 +1,5 @@
 #include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneQuantities.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneOutputSink.h"
 
 #include "Math/Factory.h"
 #include "Math/Functor.h"
@@ -12,6 +13,9 @@
 #include <TMatrixDSymEigen.h>
 #include <TVectorD.h>
 
+#include <iostream>
+#include <assert.h>
+
 namespace svFitStandalone
 {
   TH1* makeHistogram(const std::string& histogramName, double xMin, double xMax, double logBinWidth)
@@ -37,30 +41,22 @@ namespace svFitStandalone
   }
   double extractValue(const TH1* histogram)
   {
-    double maximum, maximum_interpol, mean, quantile016, quantile050, quantile084, mean3sigmaWithinMax, mean5sigmaWithinMax;
-    TH1* histogram_density = compHistogramDensity(histogram);
-    svFitStandalone::extractHistogramProperties(histogram, histogram_density, maximum, maximum_interpol, mean, quantile016, quantile050, quantile084, mean3sigmaWithinMax, mean5sigmaWithinMax);
-    delete histogram_density;
-    //double value = maximum_interpol;
-    double value = maximum;
-    return value;
+    HistogramSummary summary;
+    extractHistogramSummary(histogram, summary);
+    //double value = summary.maximum_interpol;
+    return summary.value();
   }
   double extractUncertainty(const TH1* histogram)
   {
-    double maximum, maximum_interpol, mean, quantile016, quantile050, quantile084, mean3sigmaWithinMax, mean5sigmaWithinMax;
-    TH1* histogram_density = compHistogramDensity(histogram);
-    svFitStandalone::extractHistogramProperties(histogram, histogram_density, maximum, maximum_interpol, mean, quantile016, quantile050, quantile084, mean3sigmaWithinMax, mean5sigmaWithinMax);
-    delete histogram_density;
-    //double uncertainty = TMath::Sqrt(0.5*(TMath::Power(quantile084 - maximum_interpol, 2.) + TMath::Power(maximum_interpol - quantile016, 2.)));
-    double uncertainty = TMath::Sqrt(0.5*(TMath::Power(quantile084 - maximum, 2.) + TMath::Power(maximum - quantile016, 2.)));
-    return uncertainty;
+    HistogramSummary summary;
+    extractHistogramSummary(histogram, summary);
+    return summary.uncertainty();
   }
   double extractLmax(const TH1* histogram)
   {
-    TH1* histogram_density = compHistogramDensity(histogram);
-    double Lmax = histogram_density->GetMaximum();
-    delete histogram_density;
-    return Lmax;
+    HistogramSummary summary;
+    extractHistogramSummary(histogram, summary);
+    return summary.Lmax;
   }
 
   void map_xVEGAS(const double* x, bool l1isLep, bool l2isLep, bool marginalizeVisMass, bool shiftVisMass, bool shiftVisPt, double mvis, double mtest, double* x_mapped)
@@ -120,6 +116,25 @@ namespace svFitStandalone
     }
   }
 
+  void ObjectiveFunctionAdapterVEGAS::EvalBatch(const double* x, unsigned numPoints, double* f) const
+  {
+    if ( xBatch_mapped_.size() < numPoints*2*kMaxFitParams ) {
+      xBatch_mapped_.resize(numPoints*2*kMaxFitParams);
+      mtestBatch_.resize(numPoints);
+    }
+    for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+      const double* x_point = x + iPoint*nDim_;
+      double mtest = ( integrateOverMass_ ) ? TMath::Exp(x_point[nDim_ - 1]) : mtest_;
+      map_xVEGAS(x_point, l1isLep_, l2isLep_, marginalizeVisMass_, shiftVisMass_, shiftVisPt_, mvis_, mtest, &xBatch_mapped_[iPoint*2*kMaxFitParams]);
+      mtestBatch_[iPoint] = mtest;
+    }
+    likelihood()->probBatch(&xBatch_mapped_[0], numPoints, f, true, &mtestBatch_[0]);
+    for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+      if ( TMath::IsNaN(f[iPoint]) ) f[iPoint] = 0.;
+      if ( integrateOverMass_ ) f[iPoint] *= mtestBatch_[iPoint]; // Jacobi factor for integration over log(mtest)
+    }
+  }
+
   void map_xMarkovChain(const double* x, bool l1isLep, bool l2isLep, bool marginalizeVisMass, bool shiftVisMass, bool shiftVisPt, double* x_mapped)
   {
     int offset1 = 0;
@@ -185,20 +200,58 @@ namespace svFitStandalone
   }
   SVfitQuantity::~SVfitQuantity()
   {
-    if (histogram_ != nullptr) delete histogram_;
+  }
+  void SVfitQuantity::SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    TH1* histogram_tmp = CreateHistogram(measuredTauLeptons, measuredMET);
+    if ( !histogram_tmp ) {
+      std::cerr << "<SVfitQuantity::SetupHistogram>:"
+		<< "No histogram returned by CreateHistogram --> ABORTING !!\n";
+      assert(0);
+    }
+    int numBins = histogram_tmp->GetNbinsX();
+    std::vector<double> binEdges(numBins + 1);
+    for ( int iBin = 1; iBin <= (numBins + 1); ++iBin ) {
+      binEdges[iBin - 1] = histogram_tmp->GetBinLowEdge(iBin);
+    }
+    histogram.SetName(histogram_tmp->GetName());
+    histogram.SetBinning(numBins, &binEdges[0]);
+    delete histogram_tmp;
+  }
+  TH1* SVfitQuantity::CreateHistogramFromSetup(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    svFitStandalone::FlatHistogram histogram;
+    SetupHistogram(histogram, measuredTauLeptons, measuredMET);
+    return histogram.CreateTH1();
   }
   void SVfitQuantity::SetHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET)
   {
-    if (histogram_ != nullptr) delete histogram_;
-    histogram_ = CreateHistogram(measuredTauLeptons, measuredMET);
+    if (useStreamingEstimator_) estimator_.Reset();
+    else SetupHistogram(histogram_, measuredTauLeptons, measuredMET);
+    isValidSummary_ = false;
   }
   void SVfitQuantity::Reset()
   {
-    histogram_->Reset();
+    histogram_.Reset();
+    estimator_.Reset();
+    isValidSummary_ = false;
   }
   void SVfitQuantity::WriteHistograms() const
   {
-    if (histogram_ != nullptr) histogram_->Write();
+    TH1* histogram = GetHistogram();
+    if ( !histogram ) return;
+    histogram->Write();
+    delete histogram;
+  }
+  TH1* SVfitQuantity::GetHistogram() const
+  {
+    if (useStreamingEstimator_) return 0;
+    return histogram_.CreateTH1();
+  }
+  void SVfitQuantity::WriteHistograms(svFitStandalone::OutputEvent& event) const
+  {
+    if (useStreamingEstimator_) return;
+    event.addHistogram(histogram_);
   }
   double SVfitQuantity::Eval(
       std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons,
@@ -208,18 +261,59 @@ namespace svFitStandalone
   {
     return FitFunction(fittedTauLeptons, measuredTauLeptons, measuredMET);
   }
+  double SVfitQuantity::EvalKinematics(
+      svFitStandalone::FittedKinematics const& kinematics,
+      std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons,
+      svFitStandalone::Vector const& measuredMET
+  ) const
+  {
+    return FitFunction(kinematics.fittedTauLeptons, measuredTauLeptons, measuredMET);
+  }
+  void SVfitQuantity::EvalBatch(
+      svFitStandalone::FittedKinematics const* kinematics, size_t numSamples,
+      std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons,
+      svFitStandalone::Vector const& measuredMET,
+      double* values
+  ) const
+  {
+    for (size_t iSample = 0; iSample < numSamples; ++iSample)
+    {
+      values[iSample] = EvalKinematics(kinematics[iSample], measuredTauLeptons, measuredMET);
+    }
+  }
 
+  void SVfitQuantity::Fill(double value, double weight) const
+  {
+    if (useStreamingEstimator_) estimator_.Fill(value, weight);
+    else histogram_.Fill(value, weight);
+    isValidSummary_ = false;
+  }
+  void SVfitQuantity::FillRepeated(double value, double numEntries, double weight) const
+  {
+    if (useStreamingEstimator_) estimator_.Fill(value, numEntries*weight);
+    else histogram_.FillRepeated(value, numEntries, weight);
+    isValidSummary_ = false;
+  }
+  const svFitStandalone::HistogramSummary& SVfitQuantity::ExtractSummary() const
+  {
+    if ( !isValidSummary_ ) {
+      if ( useStreamingEstimator_ ) estimator_.ExtractSummary(summary_);
+      else extractHistogramSummary(histogram_, summary_);
+      isValidSummary_ = true;
+    }
+    return summary_;
+  }
   double SVfitQuantity::ExtractValue() const
   {
-    return extractValue(histogram_);
+    return ExtractSummary().value();
   }
   double SVfitQuantity::ExtractUncertainty() const
   {
-    return extractUncertainty(histogram_);
+    return ExtractSummary().uncertainty();
   }
   double SVfitQuantity::ExtractLmax() const
   {
-    return extractLmax(histogram_);
+    return ExtractSummary().Lmax;
   }
 
   bool SVfitQuantity::isValidSolution() const
@@ -229,55 +323,105 @@ namespace svFitStandalone
 
   TH1* HiggsPtSVfitQuantity::CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
-    return makeHistogram("SVfitStandaloneAlgorithm_histogramPt", 1., 1.e+3, 1.025);
+    return CreateHistogramFromSetup(measuredTauLeptons, measuredMET);
+  }
+  void HiggsPtSVfitQuantity::SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    histogram.SetName("SVfitStandaloneAlgorithm_histogramPt");
+    histogram.SetLogBinning(1., 1.e+3, 1.025);
   }
   double HiggsPtSVfitQuantity::FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     return (fittedTauLeptons.at(0) + fittedTauLeptons.at(1)).pt();
   }
+  double HiggsPtSVfitQuantity::EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return kinematics.fittedDiTauSystem.pt();
+  }
   TH1* HiggsEtaSVfitQuantity::CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
-    return new TH1D("SVfitStandaloneAlgorithm_histogramEta", "SVfitStandaloneAlgorithm_histogramEta", 198, -9.9, +9.9);
+    return CreateHistogramFromSetup(measuredTauLeptons, measuredMET);
+  }
+  void HiggsEtaSVfitQuantity::SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    histogram.SetName("SVfitStandaloneAlgorithm_histogramEta");
+    histogram.SetUniformBinning(198, -9.9, +9.9);
   }
   double HiggsEtaSVfitQuantity::FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     return (fittedTauLeptons.at(0) + fittedTauLeptons.at(1)).eta();
   }
+  double HiggsEtaSVfitQuantity::EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return kinematics.fittedDiTauSystem.eta();
+  }
   TH1* HiggsPhiSVfitQuantity::CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
-    return new TH1D("SVfitStandaloneAlgorithm_histogramPhi", "SVfitStandaloneAlgorithm_histogramPhi", 180, -TMath::Pi(), +TMath::Pi());
+    return CreateHistogramFromSetup(measuredTauLeptons, measuredMET);
+  }
+  void HiggsPhiSVfitQuantity::SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    histogram.SetName("SVfitStandaloneAlgorithm_histogramPhi");
+    histogram.SetUniformBinning(180, -TMath::Pi(), +TMath::Pi());
   }
   double HiggsPhiSVfitQuantity::FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     return (fittedTauLeptons.at(0) + fittedTauLeptons.at(1)).phi();
   }
+  double HiggsPhiSVfitQuantity::EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return kinematics.fittedDiTauSystem.phi();
+  }
   TH1* HiggsMassSVfitQuantity::CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return CreateHistogramFromSetup(measuredTauLeptons, measuredMET);
+  }
+  void HiggsMassSVfitQuantity::SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     double visMass = (measuredTauLeptons.at(0)+measuredTauLeptons.at(1)).mass();
     double minMass = visMass/1.0125;
     double maxMass = TMath::Max(1.e+4, 1.e+1*minMass);
-    return makeHistogram("SVfitStandaloneAlgorithm_histogramMass", minMass, maxMass, 1.025);
+    histogram.SetName("SVfitStandaloneAlgorithm_histogramMass");
+    histogram.SetLogBinning(minMass, maxMass, 1.025);
   }
   double HiggsMassSVfitQuantity::FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     return (fittedTauLeptons.at(0) + fittedTauLeptons.at(1)).mass();
   }
+  double HiggsMassSVfitQuantity::EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return kinematics.fittedDiTauSystem.mass();
+  }
   TH1* TransverseMassSVfitQuantity::CreateHistogram(std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return CreateHistogramFromSetup(measuredTauLeptons, measuredMET);
+  }
+  void TransverseMassSVfitQuantity::SetupHistogram(svFitStandalone::FlatHistogram& histogram, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     svFitStandalone::LorentzVector measuredDiTauSystem = measuredTauLeptons.at(0) + measuredTauLeptons.at(1);
     double visTransverseMass2 = square(measuredTauLeptons.at(0).Et() + measuredTauLeptons.at(1).Et()) - (square(measuredDiTauSystem.px()) + square(measuredDiTauSystem.py()));
     double visTransverseMass = TMath::Sqrt(TMath::Max(1., visTransverseMass2));
     double minTransverseMass = visTransverseMass/1.0125;
     double maxTransverseMass = TMath::Max(1.e+4, 1.e+1*minTransverseMass);
-    return makeHistogram("SVfitStandaloneAlgorithm_histogramTransverseMass", minTransverseMass, maxTransverseMass, 1.025);
+    histogram.SetName("SVfitStandaloneAlgorithm_histogramTransverseMass");
+    histogram.SetLogBinning(minTransverseMass, maxTransverseMass, 1.025);
   }
   double TransverseMassSVfitQuantity::FitFunction(std::vector<svFitStandalone::LorentzVector> const& fittedTauLeptons, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
   {
     return TMath::Sqrt(2.0*fittedTauLeptons.at(0).pt()*fittedTauLeptons.at(1).pt()*(1.0 - TMath::Cos(fittedTauLeptons.at(0).phi() - fittedTauLeptons.at(1).phi())));
   }
+  double TransverseMassSVfitQuantity::EvalKinematics(svFitStandalone::FittedKinematics const& kinematics, std::vector<svFitStandalone::LorentzVector> const& measuredTauLeptons, svFitStandalone::Vector const& measuredMET) const
+  {
+    return FitFunction(kinematics.fittedTauLeptons, measuredTauLeptons, measuredMET);
+  }
 
   MCQuantitiesAdapter::MCQuantitiesAdapter(std::vector<SVfitQuantity*> const& quantities) :
-    quantities_(quantities)
+    quantities_(quantities),
+    bufferedKinematics_(256),
+    bufferedWeights_(256),
+    numBuffered_(0),
+    values_(256),
+    keepSamples_(false)
   {
   }
   MCQuantitiesAdapter::~MCQuantitiesAdapter()
@@ -299,8 +443,21 @@ namespace svFitStandalone
       quantities_.at(index)->SetHistogram(measuredTauLeptons, measuredMET);
     }
   }
+  void MCQuantitiesAdapter::SetUseStreamingEstimators(bool value)
+  {
+    for (std::vector<SVfitQuantity*>::iterator quantity = quantities_.begin(); quantity != quantities_.end(); ++quantity)
+    {
+      (*quantity)->SetUseStreamingEstimator(value);
+    }
+  }
   void MCQuantitiesAdapter::Reset()
   {
+    numBuffered_ = 0;
+    sampleValues_.clear();
+    sampleWeights_.clear();
+    sampleDMETx_.clear();
+    sampleDMETy_.clear();
+    sampleMass_.clear();
     for (std::vector<SVfitQuantity*>::iterator quantity = quantities_.begin(); quantity != quantities_.end(); ++quantity)
     {
       (*quantity)->Reset();
@@ -313,16 +470,159 @@ namespace svFitStandalone
       (*quantity)->WriteHistograms();
     }
   }
+  void MCQuantitiesAdapter::WriteHistograms(svFitStandalone::OutputEvent& event) const
+  {
+    for (std::vector<SVfitQuantity*>::const_iterator quantity = quantities_.begin(); quantity != quantities_.end(); ++quantity)
+    {
+      (*quantity)->WriteHistograms(event);
+    }
+  }
   double MCQuantitiesAdapter::DoEval(const double* x) const
   {
     map_xMarkovChain(x, l1isLep_, l2isLep_, marginalizeVisMass_, shiftVisMass_, shiftVisPt_, x_mapped_);
-    SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood->results(fittedTauLeptons_, x_mapped_);
+    const FittedKinematics& kinematics = SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood->kinematics(x_mapped_);
     for (std::vector<SVfitQuantity*>::const_iterator quantity = quantities_.begin(); quantity != quantities_.end(); ++quantity)
     {
-      (*quantity)->histogram_->Fill((*quantity)->Eval(fittedTauLeptons_, measuredTauLeptons_, measuredMET_));
+      (*quantity)->Fill((*quantity)->EvalKinematics(kinematics, measuredTauLeptons_, measuredMET_));
     }
     return 0.0;
   }
+  void MCQuantitiesAdapter::EvalCallBack(const double* x, bool isNewState) const
+  {
+    if (! isNewState && numBuffered_ > 0)
+    {
+      bufferedWeights_[numBuffered_ - 1] += 1.0;
+      return;
+    }
+    if (numBuffered_ == bufferedKinematics_.size()) ProcessBuffer();
+    map_xMarkovChain(x, l1isLep_, l2isLep_, marginalizeVisMass_, shiftVisMass_, shiftVisPt_, x_mapped_);
+    bufferedKinematics_[numBuffered_] = SVfitStandaloneLikelihood::gSVfitStandaloneLikelihood->kinematics(x_mapped_);
+    bufferedWeights_[numBuffered_] = 1.0;
+    ++numBuffered_;
+  }
+  void MCQuantitiesAdapter::Flush() const
+  {
+    ProcessBuffer();
+  }
+  void MCQuantitiesAdapter::ProcessBuffer() const
+  {
+    size_t numQuantities = quantities_.size();
+    size_t offset = sampleWeights_.size();
+    if (keepSamples_)
+    {
+      svFitStandalone::Vector measuredVisMomentum = (measuredTauLeptons_[0] + measuredTauLeptons_[1]).Vect();
+      for (size_t iSample = 0; iSample < numBuffered_; ++iSample)
+      {
+        const svFitStandalone::LorentzVector& fittedDiTauSystem = bufferedKinematics_[iSample].fittedDiTauSystem;
+        // same definition as used for the MET term in SVfitStandaloneLikelihood::transform
+        sampleDMETx_.push_back(measuredMET_.x() - (fittedDiTauSystem.px() - measuredVisMomentum.x()));
+        sampleDMETy_.push_back(measuredMET_.y() - (fittedDiTauSystem.py() - measuredVisMomentum.y()));
+        sampleMass_.push_back(fittedDiTauSystem.mass());
+        sampleWeights_.push_back(bufferedWeights_[iSample]);
+      }
+      sampleValues_.resize(sampleWeights_.size()*numQuantities);
+    }
+    for (size_t index = 0; index != numQuantities; ++index)
+    {
+      const SVfitQuantity* quantity = quantities_[index];
+      quantity->EvalBatch(bufferedKinematics_.data(), numBuffered_, measuredTauLeptons_, measuredMET_, values_.data());
+      for (size_t iSample = 0; iSample < numBuffered_; ++iSample)
+      {
+        quantity->FillRepeated(values_[iSample], bufferedWeights_[iSample]);
+      }
+      if (keepSamples_)
+      {
+        for (size_t iSample = 0; iSample < numBuffered_; ++iSample)
+        {
+          sampleValues_[(offset + iSample)*numQuantities + index] = values_[iSample];
+        }
+      }
+    }
+    numBuffered_ = 0;
+  }
+
+  namespace
+  {
+    // -log of MET term of the likelihood, as computed by probMET in src/LikelihoodFunctions.cc
+    struct NllMET
+    {
+      NllMET(const PosteriorConfiguration& config)
+      {
+        double covDet = config.covMET(0,0)*config.covMET(1,1) - config.covMET(0,1)*config.covMET(1,0);
+        isValid_ = (covDet != 0.);
+        if (isValid_)
+        {
+          invCov00_ =  config.covMET(1,1)/covDet;
+          invCov01_ = -config.covMET(0,1)/covDet;
+          invCov10_ = -config.covMET(1,0)/covDet;
+          invCov11_ =  config.covMET(0,0)/covDet;
+          offset_ = TMath::Log(2.*TMath::Pi()) + 0.5*TMath::Log(TMath::Abs(covDet));
+        }
+      }
+      double operator()(double dMETx, double dMETy) const
+      {
+        return offset_ + 0.5*(dMETx*(invCov00_*dMETx + invCov01_*dMETy) + dMETy*(invCov10_*dMETx + invCov11_*dMETy));
+      }
+      bool isValid_;
+      double invCov00_, invCov01_, invCov10_, invCov11_;
+      double offset_;
+    };
+  }
+
+  bool MCQuantitiesAdapter::Reweight(const PosteriorConfiguration& config, double minRelEffectiveSampleSize)
+  {
+    Flush();
+    size_t numSamples = sampleWeights_.size();
+    if (numSamples == 0) return false;
+    NllMET nllMET_nominal(posteriorConfiguration_);
+    NllMET nllMET(config);
+    if (!(nllMET_nominal.isValid_ && nllMET.isValid_)) return false;
+
+    // shifting the measured MET shifts the difference between measured and fitted MET by the same amount,
+    // the fitted MET is given by the position of the Markov Chain and does not change
+    double shiftMETx = config.measuredMET.x() - posteriorConfiguration_.measuredMET.x();
+    double shiftMETy = config.measuredMET.y() - posteriorConfiguration_.measuredMET.y();
+    reweightedWeights_.resize(numSamples);
+    double maxLogWeight = -std::numeric_limits<double>::max();
+    for (size_t iSample = 0; iSample < numSamples; ++iSample)
+    {
+      double dMETx = sampleDMETx_[iSample];
+      double dMETy = sampleDMETy_[iSample];
+      double logWeight = posteriorConfiguration_.metPower*nllMET_nominal(dMETx, dMETy) - config.metPower*nllMET(dMETx + shiftMETx, dMETy + shiftMETy);
+      double mass = sampleMass_[iSample];
+      if (mass > 0.) logWeight += (posteriorConfiguration_.powerLogM - config.powerLogM)*TMath::Log(mass);
+      reweightedWeights_[iSample] = logWeight;
+      if (logWeight > maxLogWeight) maxLogWeight = logWeight;
+    }
+    double sumIterations = 0.;
+    double sumWeights = 0.;
+    double sumWeights2 = 0.;
+    for (size_t iSample = 0; iSample < numSamples; ++iSample)
+    {
+      double numIterations = sampleWeights_[iSample];
+      double weight = TMath::Exp(reweightedWeights_[iSample] - maxLogWeight);
+      reweightedWeights_[iSample] = weight;
+      sumIterations += numIterations;
+      sumWeights += numIterations*weight;
+      sumWeights2 += numIterations*weight*weight;
+    }
+    double effectiveSampleSize = ( sumWeights2 > 0. ) ? (sumWeights*sumWeights/sumWeights2) : 0.;
+    if (!(effectiveSampleSize >= minRelEffectiveSampleSize*sumIterations)) return false;
+
+    // normalize weights to the number of iterations, so that Lmax stays comparable to the one of the original distributions
+    double norm = sumIterations/sumWeights;
+    size_t numQuantities = quantities_.size();
+    for (size_t index = 0; index != numQuantities; ++index)
+    {
+      SVfitQuantity* quantity = quantities_[index];
+      quantity->Reset();
+      for (size_t iSample = 0; iSample < numSamples; ++iSample)
+      {
+        quantity->FillRepeated(sampleValues_[iSample*numQuantities + index], sampleWeights_[iSample], norm*reweightedWeights_[iSample]);
+      }
+    }
+    return true;
+  }
   double MCQuantitiesAdapter::ExtractValue(size_t index) const
   {
     return quantities_.at(index)->ExtractValue();
@@ -337,21 +637,21 @@ namespace svFitStandalone
   }
   std::vector<double> MCQuantitiesAdapter::ExtractValues() const
   {
-  	std::vector<double> results;
+  	std::vector<double> results(quantities_.size());
   	std::transform(quantities_.begin(), quantities_.end(), results.begin(),
                    [](SVfitQuantity* quantity) { return quantity->ExtractValue(); });
     return results;
   }
   std::vector<double> MCQuantitiesAdapter::ExtractUncertainties() const
   {
-  	std::vector<double> results;
+  	std::vector<double> results(quantities_.size());
   	std::transform(quantities_.begin(), quantities_.end(), results.begin(),
                    [](SVfitQuantity* quantity) { return quantity->ExtractUncertainty(); });
     return results;
   }
   std::vector<double> MCQuantitiesAdapter::ExtractLmaxima() const
   {
-  	std::vector<double> results;
+  	std::vector<double> results(quantities_.size());
   	std::transform(quantities_.begin(), quantities_.end(), results.begin(),
                    [](SVfitQuantity* quantity) { return quantity->ExtractLmax(); });
     return results;
@@ -0,0 +1,139 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneResultCache.h"
+
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <assert.h>
+#include <unistd.h>
+
+namespace
+{
+  const char fileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'R', 'C', '2' };
+  const unsigned maxKeySize = 65536;
+}
+
+void
+svFitStandalone::ResultCacheKey::add(const void* data, size_t size)
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  for ( size_t idx = 0; idx < size; ++idx ) {
+    value_ ^= bytes[idx];
+    value_ *= 1099511628211ULL;
+  }
+  data_.append(static_cast<const char*>(data), size);
+}
+
+void
+svFitStandalone::ResultCacheKey::add(double value)
+{
+  // make sure +0. and -0. give the same key
+  if ( value == 0. ) value = 0.;
+  add(&value, sizeof(value));
+}
+
+SVfitStandaloneResultCache::SVfitStandaloneResultCache(const std::string& fileName)
+  : fileName_(fileName),
+    file_(0),
+    numHits_(0),
+    numMisses_(0)
+{
+  if ( fileName_ == "" ) return;
+  file_ = fopen(fileName_.data(), "r+b");
+  long size = ( file_ ) ? readFile() : -1;
+  if ( size >= 0 ) {
+    // drop a partially written record at the end of the file, so that it gets overwritten by the next record
+    fflush(file_);
+    if ( ftruncate(fileno(file_), size) != 0 ) {
+      std::cerr << "<SVfitStandaloneResultCache>:"
+		<< "Failed to truncate file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+    fseek(file_, size, SEEK_SET);
+  } else {
+    // new file, or file left behind by a job that was killed before the header was written
+    if ( file_ ) fclose(file_);
+    file_ = fopen(fileName_.data(), "w+b");
+    if ( !file_ ) {
+      std::cerr << "<SVfitStandaloneResultCache>:"
+		<< "Failed to open file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+    writeHeader();
+  }
+}
+
+SVfitStandaloneResultCache::~SVfitStandaloneResultCache()
+{
+  if ( file_ ) fclose(file_);
+}
+
+void
+SVfitStandaloneResultCache::writeHeader()
+{
+  unsigned resultSize = sizeof(svFitStandalone::CachedResult);
+  fwrite(fileFormat, sizeof(fileFormat), 1, file_);
+  fwrite(&resultSize, sizeof(resultSize), 1, file_);
+  fflush(file_);
+}
+
+long
+SVfitStandaloneResultCache::readFile()
+{
+  char format[sizeof(fileFormat)];
+  unsigned resultSize = 0;
+  if ( fread(format, sizeof(format), 1, file_) != 1 || fread(&resultSize, sizeof(resultSize), 1, file_) != 1 ) return -1;
+  if ( memcmp(format, fileFormat, sizeof(fileFormat)) != 0 || resultSize != sizeof(svFitStandalone::CachedResult) ) {
+    std::cerr << "<SVfitStandaloneResultCache::readFile>:"
+	      << "File = " << fileName_ << " is not a result cache written by this version of SVfit --> ABORTING !!\n";
+    assert(0);
+  }
+  long size = sizeof(format) + sizeof(resultSize);
+  std::vector<char> keyData;
+  while ( true ) {
+    unsigned keySize = 0;
+    // a size beyond maxKeySize can only be the remnant of a partially written record
+    if ( fread(&keySize, sizeof(keySize), 1, file_) != 1 || keySize > maxKeySize ) break;
+    keyData.resize(keySize);
+    svFitStandalone::CachedResult result;
+    if ( (keySize > 0 && fread(&keyData[0], keySize, 1, file_) != 1) || fread(&result, sizeof(result), 1, file_) != 1 ) break;
+    svFitStandalone::ResultCacheKey key;
+    key.add(keyData.data(), keySize);
+    results_[key] = result;
+    size += sizeof(keySize) + keySize + sizeof(result);
+  }
+  return size;
+}
+
+bool
+SVfitStandaloneResultCache::find(const svFitStandalone::ResultCacheKey& key, svFitStandalone::CachedResult& result) const
+{
+  std::unordered_map<svFitStandalone::ResultCacheKey, svFitStandalone::CachedResult, svFitStandalone::ResultCacheKey::Hash>::const_iterator it = results_.find(key);
+  if ( it == results_.end() ) {
+    ++numMisses_;
+    return false;
+  }
+  result = it->second;
+  ++numHits_;
+  return true;
+}
+
+void
+SVfitStandaloneResultCache::insert(const svFitStandalone::ResultCacheKey& key, const svFitStandalone::CachedResult& result)
+{
+  if ( !results_.insert(std::make_pair(key, result)).second ) return;
+  if ( file_ ) {
+    unsigned keySize = key.data().size();
+    svFitStandalone::CachedResult record;
+    memset(&record, 0, sizeof(record));
+    record = result;
+    fwrite(&keySize, sizeof(keySize), 1, file_);
+    fwrite(key.data().data(), keySize, 1, file_);
+    fwrite(&record, sizeof(record), 1, file_);
+  }
+}
+
+void
+SVfitStandaloneResultCache::flush()
+{
+  if ( file_ ) fflush(file_);
+}
@@ -0,0 +1,247 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneSampleFile.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <cstring>
+#include <assert.h>
+
+using namespace svFitStandalone;
+
+namespace
+{
+  const char dataFileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'M', 'C', '1' };
+  const char indexFileFormat[8] = { 'S', 'V', 'F', 'I', 'T', 'M', 'I', '1' };
+
+  // header = format + size of SampleRecord/SampleIndexEntry + padding, so that all records are aligned to 8 bytes
+  struct FileHeader
+  {
+    char format[8];
+    unsigned recordSize;
+    unsigned reserved;
+  };
+
+  size_t sampleSize(unsigned numDimensions)
+  {
+    return sizeof(SampleRecord) + numDimensions*sizeof(double);
+  }
+}
+
+SVfitStandaloneSampleFileWriter::SVfitStandaloneSampleFileWriter(const std::string& fileName)
+  : fileName_(fileName),
+    dataFile_(0),
+    indexFile_(0),
+    dataFileSize_(0),
+    numEvents_(0),
+    hasEventId_(false),
+    isInEvent_(false),
+    hasSample_(false)
+{
+  long indexFileSize = 0;
+  indexFile_ = openFile(fileName_ + ".idx", indexFileFormat, sizeof(SampleIndexEntry), indexFileSize);
+  dataFile_ = openFile(fileName_, dataFileFormat, sizeof(SampleRecord), dataFileSize_);
+  // position index file after the last complete entry and data file after the samples of the corresponding event,
+  // so that partially written events get overwritten
+  numEvents_ = (indexFileSize - sizeof(FileHeader))/sizeof(SampleIndexEntry);
+  indexFileSize = sizeof(FileHeader) + numEvents_*sizeof(SampleIndexEntry);
+  long dataFileSize = sizeof(FileHeader);
+  if ( numEvents_ > 0 ) {
+    SampleIndexEntry lastEntry;
+    fseek(indexFile_, indexFileSize - sizeof(SampleIndexEntry), SEEK_SET);
+    if ( fread(&lastEntry, sizeof(lastEntry), 1, indexFile_) != 1 ) {
+      std::cerr << "<SVfitStandaloneSampleFileWriter>:"
+		<< "Failed to read index of file = " << fileName_ << " --> ABORTING !!\n";
+      assert(0);
+    }
+    dataFileSize = lastEntry.offset + lastEntry.numSamples*sampleSize(lastEntry.numDimensions);
+  }
+  if ( dataFileSize > dataFileSize_ ) {
+    std::cerr << "<SVfitStandaloneSampleFileWriter>:"
+	      << "Index of file = " << fileName_ << " refers to samples beyond the end of the file --> ABORTING !!\n";
+    assert(0);
+  }
+  dataFileSize_ = dataFileSize;
+  fseek(indexFile_, indexFileSize, SEEK_SET);
+  fseek(dataFile_, dataFileSize_, SEEK_SET);
+}
+
+SVfitStandaloneSampleFileWriter::~SVfitStandaloneSampleFileWriter()
+{
+  if ( isInEvent_ ) endEvent();
+  if ( dataFile_ ) fclose(dataFile_);
+  if ( indexFile_ ) fclose(indexFile_);
+}
+
+FILE*
+SVfitStandaloneSampleFileWriter::openFile(const std::string& fileName, const char* format, size_t recordSize, long& size)
+{
+  FILE* file = fopen(fileName.data(), "r+b");
+  if ( file ) {
+    FileHeader header;
+    if ( fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.format, format, sizeof(header.format)) != 0 || header.recordSize != recordSize ) {
+      std::cerr << "<SVfitStandaloneSampleFileWriter>:"
+		<< "File = " << fileName << " is not a sample file written by this version of SVfit --> ABORTING !!\n";
+      assert(0);
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+  } else {
+    file = fopen(fileName.data(), "w+b");
+    if ( !file ) {
+      std::cerr << "<SVfitStandaloneSampleFileWriter>:"
+		<< "Failed to open file = " << fileName << " --> ABORTING !!\n";
+      assert(0);
+    }
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.format, format, sizeof(header.format));
+    header.recordSize = recordSize;
+    fwrite(&header, sizeof(header), 1, file);
+    size = sizeof(header);
+  }
+  return file;
+}
+
+void
+SVfitStandaloneSampleFileWriter::setEventId(unsigned long long run, unsigned long long lumi, unsigned long long event)
+{
+  entry_.run = run;
+  entry_.lumi = lumi;
+  entry_.event = event;
+  hasEventId_ = true;
+}
+
+void
+SVfitStandaloneSampleFileWriter::beginEvent(unsigned numDimensions)
+{
+  if ( isInEvent_ ) endEvent();
+  if ( !hasEventId_ ) {
+    entry_.run = 0;
+    entry_.lumi = 0;
+    entry_.event = numEvents_;
+  }
+  entry_.offset = dataFileSize_;
+  entry_.numSamples = 0;
+  entry_.numDimensions = numDimensions;
+  entry_.reserved = 0;
+  x_.resize(numDimensions);
+  hasSample_ = false;
+  isInEvent_ = true;
+}
+
+void
+SVfitStandaloneSampleFileWriter::EvalSample(unsigned chain, bool isAccepted, double prob, const double* x)
+{
+  if ( !isInEvent_ ) {
+    std::cerr << "<SVfitStandaloneSampleFileWriter::EvalSample>:"
+	      << "No call to beginEvent before first sample --> ABORTING !!\n";
+    assert(0);
+  }
+  if ( hasSample_ && !isAccepted && chain == sample_.chain ) {
+    ++sample_.numIterations;
+    return;
+  }
+  if ( hasSample_ ) writeSample();
+  sample_.chain = chain;
+  sample_.numIterations = 1;
+  sample_.isAccepted = isAccepted;
+  sample_.reserved = 0;
+  sample_.prob = prob;
+  for ( unsigned iDimension = 0; iDimension < entry_.numDimensions; ++iDimension ) {
+    x_[iDimension] = x[iDimension];
+  }
+  hasSample_ = true;
+}
+
+void
+SVfitStandaloneSampleFileWriter::writeSample()
+{
+  fwrite(&sample_, sizeof(sample_), 1, dataFile_);
+  if ( entry_.numDimensions > 0 ) fwrite(x_.data(), sizeof(double), entry_.numDimensions, dataFile_);
+  dataFileSize_ += sampleSize(entry_.numDimensions);
+  ++entry_.numSamples;
+}
+
+void
+SVfitStandaloneSampleFileWriter::endEvent()
+{
+  if ( !isInEvent_ ) return;
+  if ( hasSample_ ) writeSample();
+  hasSample_ = false;
+  // make sure the samples are in the file before the index entry refers to them
+  fflush(dataFile_);
+  fwrite(&entry_, sizeof(entry_), 1, indexFile_);
+  fflush(indexFile_);
+  ++numEvents_;
+  hasEventId_ = false;
+  isInEvent_ = false;
+}
+
+SVfitStandaloneSampleFileReader::SVfitStandaloneSampleFileReader(const std::string& fileName)
+  : fileName_(fileName),
+    data_(0),
+    dataSize_(0),
+    index_(0),
+    indexSize_(0),
+    numEvents_(0)
+{
+  data_ = mapFile(fileName_, dataSize_);
+  index_ = mapFile(fileName_ + ".idx", indexSize_);
+  const FileHeader* dataHeader = reinterpret_cast<const FileHeader*>(data_);
+  const FileHeader* indexHeader = reinterpret_cast<const FileHeader*>(index_);
+  if ( memcmp(dataHeader->format, dataFileFormat, sizeof(dataFileFormat)) != 0 || dataHeader->recordSize != sizeof(SampleRecord) ||
+       memcmp(indexHeader->format, indexFileFormat, sizeof(indexFileFormat)) != 0 || indexHeader->recordSize != sizeof(SampleIndexEntry) ) {
+    std::cerr << "<SVfitStandaloneSampleFileReader>:"
+	      << "File = " << fileName_ << " is not a sample file written by this version of SVfit --> ABORTING !!\n";
+    assert(0);
+  }
+  // ignore partially written index entries and entries referring to samples that are not (completely) in the data file
+  numEvents_ = (indexSize_ - sizeof(FileHeader))/sizeof(SampleIndexEntry);
+  while ( numEvents_ > 0 ) {
+    const SampleIndexEntry* entry = reinterpret_cast<const SampleIndexEntry*>(index_ + sizeof(FileHeader)) + (numEvents_ - 1);
+    if ( entry->offset + entry->numSamples*sampleSize(entry->numDimensions) <= dataSize_ ) break;
+    --numEvents_;
+  }
+}
+
+SVfitStandaloneSampleFileReader::~SVfitStandaloneSampleFileReader()
+{
+  if ( data_ ) munmap(const_cast<char*>(data_), dataSize_);
+  if ( index_ ) munmap(const_cast<char*>(index_), indexSize_);
+}
+
+const char*
+SVfitStandaloneSampleFileReader::mapFile(const std::string& fileName, size_t& size)
+{
+  int fd = open(fileName.data(), O_RDONLY);
+  struct stat fileStatus;
+  if ( fd < 0 || fstat(fd, &fileStatus) != 0 || fileStatus.st_size < (off_t)sizeof(FileHeader) ) {
+    std::cerr << "<SVfitStandaloneSampleFileReader>:"
+	      << "Failed to open file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  size = fileStatus.st_size;
+  void* address = mmap(0, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if ( address == MAP_FAILED ) {
+    std::cerr << "<SVfitStandaloneSampleFileReader>:"
+	      << "Failed to map file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  return static_cast<const char*>(address);
+}
+
+SampleView
+SVfitStandaloneSampleFileReader::event(size_t idx) const
+{
+  if ( idx >= numEvents_ ) {
+    std::cerr << "<SVfitStandaloneSampleFileReader::event>:"
+	      << "Invalid event index = " << idx << ", file = " << fileName_ << " contains " << numEvents_ << " events --> ABORTING !!\n";
+    assert(0);
+  }
+  const SampleIndexEntry* entry = reinterpret_cast<const SampleIndexEntry*>(index_ + sizeof(FileHeader)) + idx;
+  return SampleView(entry, data_ + entry->offset);
+}
@@ -0,0 +1,60 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStatistics.h"
+
+using namespace svFitStandalone;
+
+namespace
+{
+  const char* phaseNames[Statistics::kNumPhases] = { "annealing phase 1", "annealing phase 2", "burn-in", "sampling" };
+}
+
+void
+Statistics::clear()
+{
+  mode = kNone;
+  numIntegrandCalls = 0;
+  numChains = 0;
+  numChainsRun = 0;
+  numStartPositionTries = 0;
+  timeStartPosition = 0.;
+  for ( unsigned iPhase = 0; iPhase < kNumPhases; ++iPhase ) {
+    numMovesAccepted[iPhase] = 0;
+    numMovesRejected[iPhase] = 0;
+    timePhase[iPhase] = 0.;
+  }
+  numMassPointsCoarse = 0;
+  numMassPointsFine = 0;
+  numMassPointsReduced = 0;
+  numVEGASPoints = 0;
+  timeVEGASCoarse = 0.;
+  timeVEGASFine = 0.;
+  timeTotal = 0.;
+  fitStatus = -1;
+  nllStatus = 0;
+}
+
+void
+Statistics::print(std::ostream& stream) const
+{
+  stream << "<svFitStandalone::Statistics::print>:" << std::endl;
+  if ( mode == kNone ) {
+    stream << " no statistics collected." << std::endl;
+    return;
+  }
+  const char* modeName = ( mode == kFit ) ? "fit" : ( mode == kIntegrateVEGAS ) ? "integrateVEGAS" : "integrateMarkovChain";
+  stream << " mode = " << modeName << ": fitStatus = " << fitStatus << ", nllStatus = " << nllStatus << std::endl;
+  stream << " integrand calls = " << numIntegrandCalls << ", wall time = " << timeTotal << " s" << std::endl;
+  if ( mode == kIntegrateVEGAS ) {
+    stream << " mass points: coarse = " << numMassPointsCoarse << " (" << timeVEGASCoarse << " s),"
+	   << " fine = " << numMassPointsFine << " (" << timeVEGASFine << " s), reduced = " << numMassPointsReduced << std::endl;
+    stream << " VEGAS points = " << numVEGASPoints << std::endl;
+  } else if ( mode == kIntegrateMarkovChain ) {
+    stream << " chains run = " << numChainsRun << "/" << numChains << ","
+	   << " start-position tries = " << numStartPositionTries << " (" << timeStartPosition << " s)" << std::endl;
+    for ( unsigned iPhase = 0; iPhase < kNumPhases; ++iPhase ) {
+      unsigned long numMoves = numMovesAccepted[iPhase] + numMovesRejected[iPhase];
+      stream << " " << phaseNames[iPhase] << ": moves accepted = " << numMovesAccepted[iPhase] << ", rejected = " << numMovesRejected[iPhase];
+      if ( numMoves > 0 ) stream << " (fraction = " << (double)numMovesAccepted[iPhase]/numMoves*100. << "%)";
+      stream << ", wall time = " << timePhase[iPhase] << " s" << std::endl;
+    }
+  }
+}
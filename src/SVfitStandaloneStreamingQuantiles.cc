@@ -0,0 +1,169 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneStreamingQuantiles.h"
+
+#include <TMath.h>
+
+#include <algorithm>
+
+using namespace svFitStandalone;
+
+StreamingQuantileEstimator::StreamingQuantileEstimator()
+{
+  Reset();
+}
+
+void
+StreamingQuantileEstimator::Reset()
+{
+  numValues_ = 0;
+  sumWeights_ = 0.;
+  sumWeightedValues_ = 0.;
+  for ( unsigned iMarker = 0; iMarker < kNumMarkers; ++iMarker ) {
+    heights_[iMarker] = 0.;
+    positions_[iMarker] = 0.;
+    weights_[iMarker] = 0.;
+  }
+}
+
+void
+StreamingQuantileEstimator::Fill(double value, double weight)
+{
+  if ( !(weight > 0.) ) return;
+  sumWeights_ += weight;
+  sumWeightedValues_ += weight*value;
+
+//--- store the first kNumMarkers values,
+//    once all of them are filled, use them to initialize the markers
+  if ( numValues_ < kNumMarkers ) {
+    heights_[numValues_] = value;
+    weights_[numValues_] = weight;
+    ++numValues_;
+    if ( numValues_ == kNumMarkers ) getMarkers(heights_, positions_);
+    return;
+  }
+  ++numValues_;
+
+//--- find cell k containing the new value and shift the positions of all markers above it;
+//    the position of the lowest marker is kept at zero, so that the weight of the minimum does not enter the marker positions
+  const unsigned numMarkers = kNumMarkers;
+  unsigned k;
+  if ( value < heights_[0] ) {
+    heights_[0] = value;
+    k = 0;
+  } else if ( value >= heights_[numMarkers - 1] ) {
+    heights_[numMarkers - 1] = value;
+    k = numMarkers - 2;
+  } else {
+    k = std::upper_bound(heights_, heights_ + numMarkers, value) - heights_ - 1;
+  }
+  for ( unsigned iMarker = k + 1; iMarker < numMarkers; ++iMarker ) {
+    positions_[iMarker] += weight;
+  }
+
+//--- adjust heights of the inner markers which are off their desired positions by more than one unit of weight,
+//    by piecewise parabolic interpolation (P^2 formula, generalized to steps of arbitrary size)
+  double totalPosition = positions_[numMarkers - 1];
+  for ( unsigned iMarker = 1; iMarker < (numMarkers - 1); ++iMarker ) {
+    double desiredPosition = totalPosition*iMarker/(numMarkers - 1);
+    double d = desiredPosition - positions_[iMarker];
+    double gapUp = positions_[iMarker + 1] - positions_[iMarker];
+    double gapDown = positions_[iMarker] - positions_[iMarker - 1];
+    double step = 0.;
+    if      ( d >= +1. && gapUp   > 1. ) step = +TMath::Min(d, gapUp - 1.);
+    else if ( d <= -1. && gapDown > 1. ) step = -TMath::Min(-d, gapDown - 1.);
+    else continue;
+    double qMinus = heights_[iMarker - 1];
+    double q = heights_[iMarker];
+    double qPlus = heights_[iMarker + 1];
+    double qNew = q + step/(gapUp + gapDown)*((gapDown + step)*(qPlus - q)/gapUp + (gapUp - step)*(q - qMinus)/gapDown);
+    if ( !(qNew > qMinus && qNew < qPlus) ) {
+      // parabolic prediction not monotonous, use linear interpolation instead
+      if ( step > 0. ) qNew = q + step*(qPlus - q)/gapUp;
+      else qNew = q + step*(q - qMinus)/gapDown;
+    }
+    heights_[iMarker] = qNew;
+    positions_[iMarker] += step;
+  }
+}
+
+unsigned
+StreamingQuantileEstimator::getMarkers(double* heights, double* positions) const
+{
+  if ( numValues_ >= kNumMarkers && heights != heights_ ) {
+    std::copy(heights_, heights_ + kNumMarkers, heights);
+    std::copy(positions_, positions_ + kNumMarkers, positions);
+    return kNumMarkers;
+  }
+  unsigned numMarkers = TMath::Min((unsigned)numValues_, (unsigned)kNumMarkers);
+  unsigned order[kNumMarkers];
+  double values[kNumMarkers];
+  for ( unsigned iValue = 0; iValue < numMarkers; ++iValue ) {
+    order[iValue] = iValue;
+    values[iValue] = heights_[iValue];
+  }
+  std::sort(order, order + numMarkers, [&values](unsigned i, unsigned j) { return values[i] < values[j]; });
+  double position = 0.;
+  for ( unsigned iMarker = 0; iMarker < numMarkers; ++iMarker ) {
+    if ( iMarker > 0 ) position += weights_[order[iMarker]];
+    heights[iMarker] = values[order[iMarker]];
+    positions[iMarker] = position;
+  }
+  return numMarkers;
+}
+
+double
+StreamingQuantileEstimator::GetQuantile(double p) const
+{
+  double heights[kNumMarkers];
+  double positions[kNumMarkers];
+  unsigned numMarkers = getMarkers(heights, positions);
+  if ( numMarkers == 0 ) return 0.;
+  double targetPosition = p*positions[numMarkers - 1];
+  for ( unsigned iMarker = 0; iMarker < (numMarkers - 1); ++iMarker ) {
+    if ( positions[iMarker + 1] >= targetPosition ) {
+      double dPosition = positions[iMarker + 1] - positions[iMarker];
+      if ( !(dPosition > 0.) ) return heights[iMarker + 1];
+      return heights[iMarker] + (targetPosition - positions[iMarker])*(heights[iMarker + 1] - heights[iMarker])/dPosition;
+    }
+  }
+  return heights[numMarkers - 1];
+}
+
+void
+StreamingQuantileEstimator::ExtractSummary(HistogramSummary& summary) const
+{
+  summary = HistogramSummary();
+  if ( !(sumWeights_ > 0.) ) return;
+
+  double heights[kNumMarkers];
+  double positions[kNumMarkers];
+  unsigned numMarkers = getMarkers(heights, positions);
+
+//--- mode = marker at which the density, computed over the interval spanned by its neighbouring markers, is highest;
+//    taking three neighbours on each side (15% of the distribution) 
+//    suppresses the statistical fluctuations of the density computed between adjacent markers
+  const unsigned maxSpan = 3;
+  unsigned span = TMath::Min(maxSpan, (numMarkers - 1)/2);
+  double mode = heights[0];
+  double Lmax = 0.;
+  for ( unsigned iMarker = span; (iMarker + span) < numMarkers && span > 0; ++iMarker ) {
+    double dHeight = heights[iMarker + span] - heights[iMarker - span];
+    if ( !(dHeight > 0.) ) continue;
+    double density = (positions[iMarker + span] - positions[iMarker - span])/dHeight;
+    if ( density > Lmax ) {
+      mode = heights[iMarker];
+      Lmax = density;
+    }
+  }
+  // too few or only identical values, density not defined
+  if ( !(Lmax > 0.) ) Lmax = sumWeights_;
+
+  summary.maximum = mode;
+  summary.maximum_interpol = mode;
+  summary.mean = sumWeightedValues_/sumWeights_;
+  summary.quantile016 = GetQuantile(0.16);
+  summary.quantile050 = GetQuantile(0.50);
+  summary.quantile084 = GetQuantile(0.84);
+  summary.mean3sigmaWithinMax = mode;
+  summary.mean5sigmaWithinMax = mode;
+  summary.Lmax = Lmax;
+}
@@ -0,0 +1,145 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneTreeIO.h"
+
+#include <TMath.h>
+
+#include <iostream>
+#include <assert.h>
+
+using namespace svFitStandalone;
+
+namespace
+{
+  const char* branchNames[] = { "met", "mphi", "mcov_11", "mcov_12", "mcov_21", "mcov_22",
+				"l1_Pt", "l1_Eta", "l1_Phi", "l1_M", "l2_Pt", "l2_Eta", "l2_Phi", "l2_M" };
+}
+
+SVfitStandaloneTreeReader::SVfitStandaloneTreeReader(TTree* tree, kDecayType leg1Type, kDecayType leg2Type, long cacheSize)
+  : tree_(tree),
+    leg1Type_(leg1Type),
+    leg2Type_(leg2Type),
+    numEntries_(tree->GetEntries()),
+    firstEntry_(0),
+    clusterIterator_(tree->GetClusterIterator(0))
+{
+  // read only the branches that are needed, with baskets prefetched by the TTreeCache
+  tree_->SetBranchStatus("*", 0);
+  tree_->SetCacheSize(cacheSize);
+  for ( int iBranch = 0; iBranch < kNumBranches; ++iBranch ) {
+    branches_[iBranch] = tree_->GetBranch(branchNames[iBranch]);
+    if ( !branches_[iBranch] ) {
+      std::cerr << "<SVfitStandaloneTreeReader>:"
+		<< "Tree has no branch = " << branchNames[iBranch] << " --> ABORTING !!\n";
+      assert(0);
+    }
+    tree_->SetBranchStatus(branchNames[iBranch], 1);
+    branches_[iBranch]->SetAddress(&values_[iBranch]);
+    tree_->AddBranchToCache(branchNames[iBranch]);
+  }
+  tree_->StopCacheLearningPhase();
+}
+
+bool
+SVfitStandaloneTreeReader::nextCluster(std::vector<BatchEvent>& events)
+{
+  long start = clusterIterator_();
+  if ( start >= numEntries_ ) {
+    events.clear();
+    return false;
+  }
+  long end = TMath::Min(clusterIterator_.GetNextEntry(), numEntries_);
+  firstEntry_ = start;
+  size_t numEvents = end - start;
+  tree_->SetCacheEntryRange(start, end);
+  for ( int iBranch = 0; iBranch < kNumBranches; ++iBranch ) {
+    TBranch* branch = branches_[iBranch];
+    std::vector<float>& column = columns_[iBranch];
+    column.resize(numEvents);
+    for ( size_t idx = 0; idx < numEvents; ++idx ) {
+      branch->GetEntry(start + idx);
+      column[idx] = values_[iBranch];
+    }
+  }
+  events.resize(numEvents);
+  for ( size_t idx = 0; idx < numEvents; ++idx ) {
+    BatchEvent& event = events[idx];
+    event.leg1Type = leg1Type_;
+    event.leg1DecayMode = -1;
+    event.leg1Pt = columns_[kLeg1Pt][idx];
+    event.leg1Eta = columns_[kLeg1Eta][idx];
+    event.leg1Phi = columns_[kLeg1Phi][idx];
+    event.leg1Mass = columns_[kLeg1Mass][idx];
+    event.leg2Type = leg2Type_;
+    event.leg2DecayMode = -1;
+    event.leg2Pt = columns_[kLeg2Pt][idx];
+    event.leg2Eta = columns_[kLeg2Eta][idx];
+    event.leg2Phi = columns_[kLeg2Phi][idx];
+    event.leg2Mass = columns_[kLeg2Mass][idx];
+    double met = columns_[kMET][idx];
+    double metPhi = columns_[kMETPhi][idx];
+    event.measuredMETx = met*TMath::Cos(metPhi);
+    event.measuredMETy = met*TMath::Sin(metPhi);
+    event.covMET00 = columns_[kCovMET11][idx];
+    event.covMET01 = columns_[kCovMET12][idx];
+    event.covMET10 = columns_[kCovMET21][idx];
+    event.covMET11 = columns_[kCovMET22][idx];
+  }
+  return true;
+}
+
+SVfitStandaloneFriendTreeWriter::SVfitStandaloneFriendTreeWriter(const std::string& fileName, const std::string& treeName)
+  : file_(0),
+    tree_(0),
+    numEntries_(0),
+    isWritten_(false)
+{
+  file_ = new TFile(fileName.data(), "RECREATE");
+  if ( !file_ || file_->IsZombie() ) {
+    std::cerr << "<SVfitStandaloneFriendTreeWriter>:"
+	      << "Failed to create file = " << fileName << " --> ABORTING !!\n";
+    assert(0);
+  }
+  tree_ = new TTree(treeName.data(), treeName.data());
+  tree_->SetDirectory(file_);
+  tree_->Branch("mass", &mass_, "mass/D");
+  tree_->Branch("massUncert", &massUncert_, "massUncert/D");
+  tree_->Branch("massLmax", &massLmax_, "massLmax/D");
+  tree_->Branch("transverseMass", &transverseMass_, "transverseMass/D");
+  tree_->Branch("transverseMassUncert", &transverseMassUncert_, "transverseMassUncert/D");
+  tree_->Branch("transverseMassLmax", &transverseMassLmax_, "transverseMassLmax/D");
+  tree_->Branch("fitStatus", &fitStatus_, "fitStatus/I");
+  tree_->Branch("nllStatus", &nllStatus_, "nllStatus/I");
+  tree_->Branch("isValidSolution", &isValidSolution_, "isValidSolution/I");
+}
+
+SVfitStandaloneFriendTreeWriter::~SVfitStandaloneFriendTreeWriter()
+{
+  if ( !isWritten_ ) write();
+  // the tree is owned by the file
+  delete file_;
+}
+
+void
+SVfitStandaloneFriendTreeWriter::fill(const BatchResults& results)
+{
+  for ( size_t idx = 0; idx < results.size(); ++idx ) {
+    mass_ = results.mass[idx];
+    massUncert_ = results.massUncert[idx];
+    massLmax_ = results.massLmax[idx];
+    transverseMass_ = results.transverseMass[idx];
+    transverseMassUncert_ = results.transverseMassUncert[idx];
+    transverseMassLmax_ = results.transverseMassLmax[idx];
+    fitStatus_ = results.fitStatus[idx];
+    nllStatus_ = results.nllStatus[idx];
+    isValidSolution_ = results.isValidSolution[idx];
+    tree_->Fill();
+    ++numEntries_;
+  }
+}
+
+void
+SVfitStandaloneFriendTreeWriter::write()
+{
+  file_->cd();
+  tree_->Write();
+  isWritten_ = true;
+}
@@ -0,0 +1,328 @@
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneVEGASIntegrator.h"
+
+#include <TMath.h>
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <assert.h>
+
+namespace
+{
+  double square(double x)
+  {
+    return x*x;
+  }
+}
+
+SVfitStandaloneVEGASIntegrator::SVfitStandaloneVEGASIntegrator(unsigned numCallsPerIteration, unsigned numIterations,
+							       unsigned numBins, double alpha,
+							       int verbose)
+  : integrand_(0),
+    numDimensions_(0),
+    volume_(0.),
+    numCallsPerIteration_(numCallsPerIteration),
+    numIterations_(numIterations),
+    maxRelErr_(-1.),
+    minIterations_(numIterations),
+    numBins_(numBins),
+    alpha_(alpha),
+    isGridInitialized_(false),
+    batchSize_(500),
+    seed_(12345),
+    integral_(0.),
+    integralErr_(0.),
+    chi2PerIter_(0.),
+    numIterationsDone_(0),
+    numIntegrationCalls_(0),
+    numIntegrandCalls_(0),
+    verbose_(verbose)
+{
+  if ( numBins_ < 2 ) {
+    std::cerr << "<SVfitStandaloneVEGASIntegrator>:"
+	      << "Invalid Configuration Parameter 'numBins' = " << numBins_ << " --> ABORTING !!\n";
+    assert(0);
+  }
+  setNumCalls(numCallsPerIteration, numIterations);
+}
+
+SVfitStandaloneVEGASIntegrator::~SVfitStandaloneVEGASIntegrator()
+{}
+
+void
+SVfitStandaloneVEGASIntegrator::setNumCalls(unsigned numCallsPerIteration, unsigned numIterations)
+{
+  if ( numCallsPerIteration < 2 || numIterations < 1 ) {
+    std::cerr << "<SVfitStandaloneVEGASIntegrator>:"
+	      << "Invalid Configuration Parameters 'numCallsPerIteration' = " << numCallsPerIteration << ","
+	      << " 'numIterations' = " << numIterations << " --> ABORTING !!\n";
+    assert(0);
+  }
+  numCallsPerIteration_ = numCallsPerIteration;
+  numIterations_ = numIterations;
+}
+
+void
+SVfitStandaloneVEGASIntegrator::setIntegrand(const SVfitStandaloneVEGASIntegrand& integrand)
+{
+  integrand_ = &integrand;
+  unsigned numDimensions = integrand.NDim();
+  if ( numDimensions != numDimensions_ ) {
+    numDimensions_ = numDimensions;
+    xMin_.resize(numDimensions_);
+    xMax_.resize(numDimensions_);
+    grid_.resize(numDimensions_*(numBins_ + 1));
+    gridSum2_.resize(numDimensions_*numBins_);
+    x_.resize(batchSize_*numDimensions_);
+    f_.resize(batchSize_);
+    jacobi_.resize(batchSize_);
+    bin_.resize(batchSize_*numDimensions_);
+    r_.resize(batchSize_*numDimensions_);
+    weights_.resize(batchSize_);
+  }
+//--- grid adapted for previous integrand is not meaningful for new integrand
+  isGridInitialized_ = false;
+}
+
+void
+SVfitStandaloneVEGASIntegrator::registerCallBackFunction(const SVfitStandaloneVEGASCallBackFunction& function)
+{
+  callBackFunctions_.push_back(&function);
+}
+
+void
+SVfitStandaloneVEGASIntegrator::unregisterCallBackFunction(const SVfitStandaloneVEGASCallBackFunction& function)
+{
+  callBackFunctions_.erase(std::remove(callBackFunctions_.begin(), callBackFunctions_.end(), &function), callBackFunctions_.end());
+}
+
+void
+SVfitStandaloneVEGASIntegrator::initializeGrid()
+{
+//--- initialize importance grid to uniform bins
+  for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {
+    double* grid = &grid_[iDimension*(numBins_ + 1)];
+    for ( unsigned iBin = 0; iBin <= numBins_; ++iBin ) {
+      grid[iBin] = iBin/(double)numBins_;
+    }
+  }
+  isGridInitialized_ = true;
+}
+
+void
+SVfitStandaloneVEGASIntegrator::integrate(const double* xMin, const double* xMax, double& integral, double& integralErr, bool resetGrid)
+{
+  if ( !integrand_ ) {
+    std::cerr << "<SVfitStandaloneVEGASIntegrator>:"
+	      << "No integrand set --> ABORTING !!\n";
+    assert(0);
+  }
+
+  ++numIntegrationCalls_;
+
+  volume_ = 1.;
+  for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {
+    xMin_[iDimension] = xMin[iDimension];
+    xMax_[iDimension] = xMax[iDimension];
+    volume_ *= (xMax_[iDimension] - xMin_[iDimension]);
+  }
+
+  bool isWarmStart = !(resetGrid || !isGridInitialized_);
+  if ( !isWarmStart ) initializeGrid();
+
+//--- reset random number generator at the beginning of each integration,
+//    so that the result does not depend on the history of previous integrations
+  rnd_.SetSeed(seed_);
+
+//--- combine integrals computed in the individual iterations,
+//    weighted by their inverse variance (following the GSL implementation)
+  double sumWeights = 0.;
+  double sumWeightedIntegrals = 0.;
+  double sumWeightedIntegrals2 = 0.;
+  unsigned numSamples = 0;
+  integral_ = 0.;
+  integralErr_ = 0.;
+  chi2PerIter_ = 0.;
+  numIterationsDone_ = 0;
+  for ( unsigned iIteration = 0; iIteration < numIterations_; ++iIteration ) {
+    double var = 0.;
+    bool isLastIteration = (iIteration == (numIterations_ - 1));
+    double integral_iteration = runIteration(numCallsPerIteration_, var, isLastIteration && callBackFunctions_.size() > 0);
+
+    double weight = 0.;
+    if      ( var        > 0. ) weight = 1./var;
+    else if ( sumWeights > 0. ) weight = sumWeights/numSamples;
+
+    if ( weight > 0. ) {
+      ++numSamples;
+      sumWeights += weight;
+      sumWeightedIntegrals += integral_iteration*weight;
+      sumWeightedIntegrals2 += square(integral_iteration)*weight;
+      integral_ = sumWeightedIntegrals/sumWeights;
+      integralErr_ = TMath::Sqrt(1./sumWeights);
+      if ( numSamples > 1 ) chi2PerIter_ = (sumWeightedIntegrals2 - sumWeightedIntegrals*integral_)/(numSamples - 1);
+    } else {
+      integral_ += (integral_iteration - integral_)/(iIteration + 1.);
+      integralErr_ = 0.;
+    }
+    if ( verbose_ >= 2 ) {
+      std::cout << "iteration #" << iIteration << ": integral = " << integral_iteration << " +/- " << TMath::Sqrt(var) << ","
+		<< " cumulative = " << integral_ << " +/- " << integralErr_ << " (chi2/iter = " << chi2PerIter_ << ")" << std::endl;
+    }
+
+    ++numIterationsDone_;
+
+    refineGrid();
+
+//--- an importance grid adapted to a similar integrand needs no further warm-up,
+//    so stop as soon as the requested precision is reached
+    if ( isWarmStart && maxRelErr_ > 0. && callBackFunctions_.empty() && numIterationsDone_ >= minIterations_ && integralErr_ <= maxRelErr_*integral_ ) break;
+  }
+
+  integral = integral_;
+  integralErr = integralErr_;
+}
+
+double
+SVfitStandaloneVEGASIntegrator::runIteration(unsigned numCalls, double& var, bool callBack)
+{
+  std::fill(gridSum2_.begin(), gridSum2_.end(), 0.);
+
+  double sum = 0.;
+  double sum2 = 0.;
+  for ( unsigned iCall = 0; iCall < numCalls; iCall += batchSize_ ) {
+    unsigned numPoints = std::min(batchSize_, numCalls - iCall);
+
+//--- draw points according to importance grid:
+//    each coordinate is chosen uniformly within a randomly selected bin,
+//    the Jacobi factor accounts for the (non-uniform) bin widths
+    rnd_.RndmArray(numPoints*numDimensions_, &r_[0]);
+    for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+      double jacobi = 1.;
+      for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {
+	unsigned idx = iPoint*numDimensions_ + iDimension;
+	double z = r_[idx]*numBins_;
+	unsigned iBin = TMath::Min((unsigned)z, numBins_ - 1);
+	const double* grid = &grid_[iDimension*(numBins_ + 1)];
+	double binWidth = grid[iBin + 1] - grid[iBin];
+	double y = grid[iBin] + (z - iBin)*binWidth;
+	x_[idx] = xMin_[iDimension] + y*(xMax_[iDimension] - xMin_[iDimension]);
+	bin_[idx] = iBin;
+	jacobi *= numBins_*binWidth;
+      }
+      jacobi_[iPoint] = jacobi;
+    }
+
+    integrand_->EvalBatch(&x_[0], numPoints, &f_[0]);
+    numIntegrandCalls_ += numPoints;
+
+    for ( unsigned iPoint = 0; iPoint < numPoints; ++iPoint ) {
+      double fValue = f_[iPoint]*jacobi_[iPoint]*volume_;
+      double fValue2 = square(fValue);
+      sum += fValue;
+      sum2 += fValue2;
+      for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {
+	gridSum2_[iDimension*numBins_ + bin_[iPoint*numDimensions_ + iDimension]] += fValue2;
+      }
+      weights_[iPoint] = fValue/numCalls;
+    }
+
+    if ( callBack ) {
+      for ( std::vector<const SVfitStandaloneVEGASCallBackFunction*>::const_iterator callBackFunction = callBackFunctions_.begin();
+	    callBackFunction != callBackFunctions_.end(); ++callBackFunction ) {
+	(*callBackFunction)->EvalCallBack(&x_[0], numPoints, &weights_[0]);
+      }
+    }
+  }
+
+  double integral = sum/numCalls;
+  var = TMath::Max(0., (sum2/numCalls - square(integral))/(numCalls - 1.));
+  return integral;
+}
+
+void
+SVfitStandaloneVEGASIntegrator::refineGrid()
+{
+  if ( alpha_ <= 0. ) return;
+
+  std::vector<double> weights(numBins_);
+  std::vector<double> gridNew(numBins_ + 1);
+  for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {
+    double* d = &gridSum2_[iDimension*numBins_];
+    double* grid = &grid_[iDimension*(numBins_ + 1)];
+
+//--- smooth sum of squared integrand values over neighbouring bins
+    double dOld = d[0];
+    double dNew = d[1];
+    d[0] = 0.5*(dOld + dNew);
+    double dSum = d[0];
+    for ( unsigned iBin = 1; iBin < (numBins_ - 1); ++iBin ) {
+      double dSum_neighbours = dOld + dNew;
+      dOld = dNew;
+      dNew = d[iBin + 1];
+      d[iBin] = (dSum_neighbours + dNew)/3.;
+      dSum += d[iBin];
+    }
+    d[numBins_ - 1] = 0.5*(dNew + dOld);
+    dSum += d[numBins_ - 1];
+    if ( !(dSum > 0.) ) continue;
+
+//--- compute "stiffened" weights according to Eq. (18) of [1]
+    double sumWeights = 0.;
+    for ( unsigned iBin = 0; iBin < numBins_; ++iBin ) {
+      weights[iBin] = 0.;
+      if ( d[iBin] > 0. ) {
+	double r = dSum/d[iBin];
+	weights[iBin] = ( r > 1. ) ? TMath::Power((r - 1.)/(r*TMath::Log(r)), alpha_) : 1.;
+      }
+      sumWeights += weights[iBin];
+    }
+    double weightPerBin = sumWeights/numBins_;
+
+//--- redistribute bin boundaries such that each new bin contains the same weight
+    double xOld = 0.;
+    double xNew = 0.;
+    double dw = 0.;
+    unsigned iBinNew = 1;
+    for ( unsigned iBin = 0; iBin < numBins_; ++iBin ) {
+      dw += weights[iBin];
+      xOld = xNew;
+      xNew = grid[iBin + 1];
+      for ( ; dw > weightPerBin && iBinNew < numBins_; ++iBinNew ) {
+	dw -= weightPerBin;
+	gridNew[iBinNew] = xNew - (xNew - xOld)*dw/weights[iBin];
+      }
+    }
+    gridNew[0] = 0.;
+//--- in rare cases the last bin boundary is missed due to rounding errors,
+//    in which case the remaining bins are distributed uniformly
+    for ( unsigned iBin = iBinNew; iBin < numBins_; ++iBin ) {
+      gridNew[iBin] = gridNew[iBinNew - 1] + (1. - gridNew[iBinNew - 1])*(iBin - iBinNew + 1)/(numBins_ - iBinNew + 1);
+    }
+    for ( unsigned iBin = 1; iBin < numBins_; ++iBin ) {
+      grid[iBin] = gridNew[iBin];
+    }
+    grid[0] = 0.;
+    grid[numBins_] = 1.;
+  }
+}
+
+void
+SVfitStandaloneVEGASIntegrator::print(std::ostream& stream) const
+{
+  stream << "<SVfitStandaloneVEGASIntegrator::print>:" << std::endl;
+  stream << " integral = " << integral_ << " +/- " << integralErr_ << " (chi2/iter = " << chi2PerIter_ << ")" << std::endl;
+  stream << " numIterations = " << numIterationsDone_ << std::endl;
+  stream << " numIntegrationCalls = " << numIntegrationCalls_ << std::endl;
+  stream << " numIntegrandCalls = " << numIntegrandCalls_ << std::endl;
+  if ( verbose_ >= 2 ) {
+    for ( unsigned iDimension = 0; iDimension < numDimensions_; ++iDimension ) {
+      stream << " grid[" << iDimension << "] = {";
+      for ( unsigned iBin = 0; iBin <= numBins_; ++iBin ) {
+	if ( iBin > 0 ) stream << ",";
+	stream << " " << std::setprecision(4) << grid_[iDimension*(numBins_ + 1) + iBin];
+      }
+      stream << " }" << std::endl;
+    }
+  }
+}
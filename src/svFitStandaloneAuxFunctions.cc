@@ -1,4 +1,5 @@
 #include "TauAnalysis/SVfitStandalone/interface/svFitStandaloneAuxFunctions.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneFlatHistogram.h"
 
 #include <TMath.h>
 #include <Math/VectorUtil.h>
@@ -201,5 +202,116 @@ namespace svFitStandalone
       xMean5sigmaWithinMax = 0.;
     }
   }
+
+  HistogramSummary::HistogramSummary()
+    : maximum(0.),
+      maximum_interpol(0.),
+      mean(0.),
+      quantile016(0.),
+      quantile050(0.),
+      quantile084(0.),
+      mean3sigmaWithinMax(0.),
+      mean5sigmaWithinMax(0.),
+      Lmax(0.)
+  {}
+
+  double HistogramSummary::uncertainty() const
+  {
+    return TMath::Sqrt(0.5*(square(quantile084 - maximum) + square(maximum - quantile016)));
+  }
+
+  namespace
+  {
+    // implemented as template, in order to support TH1 as well as FlatHistogram
+    template <typename T>
+    void extractHistogramSummary_impl(const T& histogram, HistogramSummary& summary, int verbosity)
+    {
+      if ( verbosity ) std::cout << "<extractHistogramSummary>:" << std::endl;
+
+      summary = HistogramSummary();
+      summary.mean = histogram.GetMean();
+
+      // first pass: integral and maximum of probability density
+      int numBins = histogram.GetNbinsX();
+      double integral = 0.;
+      int binMaximum = -1;
+      double yMaximum = 0.;
+      for ( int iBin = 1; iBin <= numBins; ++iBin ) {
+        double binContent = histogram.GetBinContent(iBin);
+        integral += binContent;
+        double binDensity = binContent/histogram.GetBinWidth(iBin);
+        if ( binMaximum == -1 || binDensity > yMaximum ) {
+	  binMaximum = iBin;
+	  yMaximum = binDensity;
+        }
+      }
+      if ( !(integral > 0.) ) return;
+      summary.Lmax = yMaximum;
+
+      summary.maximum = histogram.GetBinCenter(binMaximum);
+      double yMaximumErr = ( histogram.GetBinContent(binMaximum) > 0. ) ?      
+        (yMaximum*histogram.GetBinError(binMaximum)/histogram.GetBinContent(binMaximum)) : 0.;
+      if ( verbosity ) std::cout << "yMaximum = " << yMaximum << " +/- " << yMaximumErr << " @ xMaximum = " << summary.maximum << std::endl;
+      if ( binMaximum > 1 && binMaximum < numBins ) {
+        double xMinus = histogram.GetBinCenter(binMaximum - 1) - summary.maximum;
+        double yMinus = histogram.GetBinContent(binMaximum - 1)/histogram.GetBinWidth(binMaximum - 1) - yMaximum;
+        double xPlus  = histogram.GetBinCenter(binMaximum + 1) - summary.maximum;
+        double yPlus  = histogram.GetBinContent(binMaximum + 1)/histogram.GetBinWidth(binMaximum + 1) - yMaximum;
+        summary.maximum_interpol = summary.maximum + 0.5*(yPlus*square(xMinus) - yMinus*square(xPlus))/(yPlus*xMinus - yMinus*xPlus);
+      } else {
+        summary.maximum_interpol = summary.maximum;
+      }
+
+      // second pass: quantiles and mean of bins within 3 and 5 sigma of the maximum.
+      // The quantiles are computed in the same way as by TH1::GetQuantiles, 
+      // by linear interpolation of the cumulative distribution within the bin in which the distribution exceeds the given probability
+      const int numQuantiles = 3;
+      const double probSum[numQuantiles] = { 0.16, 0.50, 0.84 };
+      double* quantiles[numQuantiles] = { &summary.quantile016, &summary.quantile050, &summary.quantile084 };
+      int idxQuantile = 0;
+      double threshold3sigma = yMaximum - 3.*yMaximumErr;
+      double threshold5sigma = yMaximum - 5.*yMaximumErr;
+      double sum3sigma = 0.;
+      double norm3sigma = 0.;
+      double sum5sigma = 0.;
+      double norm5sigma = 0.;
+      double cumulative = 0.;
+      for ( int iBin = 1; iBin <= numBins; ++iBin ) {
+        double binContent = histogram.GetBinContent(iBin);
+        double binWidth = histogram.GetBinWidth(iBin);
+        double cumulative_next = ( iBin < numBins ) ? (cumulative + binContent/integral) : 1.;
+        while ( idxQuantile < numQuantiles && cumulative_next > probSum[idxQuantile] ) {
+	  double dCumulative = cumulative_next - cumulative;
+	  (*quantiles[idxQuantile]) = histogram.GetBinLowEdge(iBin) + binWidth*(probSum[idxQuantile] - cumulative)/dCumulative;
+	  ++idxQuantile;
+        }
+        cumulative = cumulative_next;
+        double binCenter = histogram.GetBinCenter(iBin);
+        double binDensity = binContent/binWidth;
+        if ( binDensity >= threshold3sigma ) {
+	  sum3sigma += (binCenter*binDensity);
+	  norm3sigma += binDensity;
+        }
+        if ( binDensity >= threshold5sigma ) {
+	  sum5sigma += (binCenter*binDensity);
+	  norm5sigma += binDensity;
+        }
+      }
+      summary.mean3sigmaWithinMax = ( norm3sigma > 0. ) ? (sum3sigma/norm3sigma) : 0.;
+      summary.mean5sigmaWithinMax = ( norm5sigma > 0. ) ? (sum5sigma/norm5sigma) : 0.;
+      if ( verbosity ) std::cout << "--> quantiles = { " << summary.quantile016 << ", " << summary.quantile050 << ", " << summary.quantile084 << " }" << std::endl;
+    }
+  }
+
+  void extractHistogramSummary(const TH1* histogram, HistogramSummary& summary, int verbosity)
+  {
+    extractHistogramSummary_impl(*histogram, summary, verbosity);
+  }
+
+  void extractHistogramSummary(const FlatHistogram& histogram, HistogramSummary& summary, int verbosity)
+  {
+    extractHistogramSummary_impl(histogram, summary, verbosity);
+  }
+
   //-----------------------------------------------------------------------------
 }
@@ -0,0 +1,81 @@
+#ifndef TauAnalysis_SVfitStandalone_SVfitStandaloneReferenceEvents_h
+#define TauAnalysis_SVfitStandalone_SVfitStandaloneReferenceEvents_h
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneAlgorithm.h"
+
+#include <TMatrixD.h>
+
+#include <vector>
+
+/**
+   Reference sample shared by benchmarkSVfitStandalone and the unit tests in this directory:
+   events of the eTau, muTau, tauTau and eMu channels, with the hadronic taus reconstructed in different decay modes.
+
+   Whenever the reference sample is modified, kSampleVersion must be increased and the reference values of
+   benchmarkSVfitStandalone must be recomputed by running it with option --update-reference.
+*/
+
+namespace svFitStandaloneReference
+{
+  const int kSampleVersion = 1;
+
+  struct ReferenceEvent
+  {
+    const char* name;
+    double measuredMETx;
+    double measuredMETy;
+    double covMET00, covMET01, covMET10, covMET11;
+    svFitStandalone::kDecayType leg1Type;
+    double leg1Pt, leg1Eta, leg1Phi, leg1Mass;
+    int leg1DecayMode;
+    svFitStandalone::kDecayType leg2Type;
+    double leg2Pt, leg2Eta, leg2Phi, leg2Mass;
+    int leg2DecayMode;
+  };
+
+  // the first event is the one used in testSVfitStandalone
+  const ReferenceEvent referenceEvents[] = {
+    { "eTau_DM0",     11.7491, -51.9172, 787.352, -178.63, -178.63, 179.545,
+      svFitStandalone::kTauToElecDecay, 33.7393, 0.9409, -0.541458, 0.51100e-3, -1,
+      svFitStandalone::kTauToHadDecay, 25.7322, 0.618228, 2.79362, 0.13957, 0 },
+    { "eTau_DM1",     11.7491, -51.9172, 787.352, -178.63, -178.63, 179.545,
+      svFitStandalone::kTauToElecDecay, 33.7393, 0.9409, -0.541458, 0.51100e-3, -1,
+      svFitStandalone::kTauToHadDecay, 25.7322, 0.618228, 2.79362, 0.62, 1 },
+    { "muTau_DM0",    -8.3172, 23.5281, 402.113, 35.71, 35.71, 377.902,
+      svFitStandalone::kTauToMuDecay, 28.4102, -0.3127, 1.20843, 0.10566, -1,
+      svFitStandalone::kTauToHadDecay, 41.0358, 0.5521, -1.88706, 0.13957, 0 },
+    { "muTau_DM10",   -8.3172, 23.5281, 402.113, 35.71, 35.71, 377.902,
+      svFitStandalone::kTauToMuDecay, 28.4102, -0.3127, 1.20843, 0.10566, -1,
+      svFitStandalone::kTauToHadDecay, 41.0358, 0.5521, -1.88706, 1.08, 10 },
+    { "tauTau_DM1_DM10", 20.2914, -8.1136, 298.471, 12.05, 12.05, 310.266,
+      svFitStandalone::kTauToHadDecay, 52.6611, 0.1982, 1.10574, 0.78, 1,
+      svFitStandalone::kTauToHadDecay, 45.1028, -0.6345, -2.03219, 1.21, 10 },
+    { "tauTau_DM0_DM1", -31.0725, 14.9357, 512.837, -64.12, -64.12, 455.019,
+      svFitStandalone::kTauToHadDecay, 61.3306, -1.2051, -0.35512, 0.13957, 0,
+      svFitStandalone::kTauToHadDecay, 48.2213, -0.4112, 2.64018, 0.55, 1 },
+    { "eMu",          -5.0633, 18.2468, 201.594, -19.86, -19.86, 249.731,
+      svFitStandalone::kTauToElecDecay, 28.1297, 1.1045, 0.30127, 0.51100e-3, -1,
+      svFitStandalone::kTauToMuDecay, 22.4430, -0.2268, 2.91043, 0.10566, -1 }
+  };
+  const size_t numReferenceEvents = sizeof(referenceEvents)/sizeof(referenceEvents[0]);
+
+  inline std::vector<svFitStandalone::MeasuredTauLepton> measuredTauLeptons(const ReferenceEvent& event)
+  {
+    std::vector<svFitStandalone::MeasuredTauLepton> measuredTauLeptons;
+    measuredTauLeptons.push_back(svFitStandalone::MeasuredTauLepton(event.leg1Type, event.leg1Pt, event.leg1Eta, event.leg1Phi, event.leg1Mass, event.leg1DecayMode));
+    measuredTauLeptons.push_back(svFitStandalone::MeasuredTauLepton(event.leg2Type, event.leg2Pt, event.leg2Eta, event.leg2Phi, event.leg2Mass, event.leg2DecayMode));
+    return measuredTauLeptons;
+  }
+
+  inline TMatrixD covMET(const ReferenceEvent& event)
+  {
+    TMatrixD covMET(2, 2);
+    covMET[0][0] = event.covMET00;
+    covMET[0][1] = event.covMET01;
+    covMET[1][0] = event.covMET10;
+    covMET[1][1] = event.covMET11;
+    return covMET;
+  }
+}
+
+#endif
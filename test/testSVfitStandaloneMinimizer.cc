@@ -0,0 +1,82 @@
+/**
+   \class testSVfitStandaloneMinimizer testSVfitStandaloneMinimizer.cc "TauAnalysis/SVfitStandalone/test/testSVfitStandaloneMinimizer.cc"
+   \brief Check that the built-in quasi-Newton minimizer reproduces the results of Minuit2 in fit mode
+
+   Each event of the reference sample is fitted with Minuit2 and with the built-in minimizer, without and with the options
+   shiftVisPt, shiftVisMass and marginalizeVisMass. The test fails in case the fitStatus differs, or in case mass or massUncert
+   differ by more than 10% of the mass uncertainty obtained with Minuit2.
+*/
+
+#include "FWCore/ParameterSet/interface/FileInPath.h"
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneAlgorithm.h"
+#include "TauAnalysis/SVfitStandalone/test/SVfitStandaloneReferenceEvents.h"
+
+#include "TH1.h"
+
+#include <iostream>
+#include <string>
+#include <cmath>
+
+using namespace svFitStandaloneReference;
+
+namespace
+{
+  enum Option { kDefault, kShiftVisPt, kShiftVisMass, kMarginalizeVisMass, kNumOptions };
+  const char* optionNames[] = { "default", "shiftVisPt", "shiftVisMass", "marginalizeVisMass" };
+
+  struct Result
+  {
+    int fitStatus;
+    double mass;
+    double massUncert;
+    unsigned numObjFunctionCalls;
+  };
+
+  Result fitEvent(const ReferenceEvent& event, Option option, bool useMinuit, const std::string& inputFileName_visMassAndPtResolution, const std::string& inputFileName_genTauHadMass)
+  {
+    SVfitStandaloneAlgorithm algo(measuredTauLeptons(event), event.measuredMETx, event.measuredMETy, covMET(event), 0);
+    algo.addLogM(true, 1.);
+    algo.useMinuit(useMinuit);
+    if ( option == kShiftVisPt         ) algo.shiftVisPt(true, inputFileName_visMassAndPtResolution);
+    if ( option == kShiftVisMass       ) algo.shiftVisMass(true, inputFileName_visMassAndPtResolution);
+    if ( option == kMarginalizeVisMass ) algo.marginalizeVisMass(true, inputFileName_genTauHadMass);
+    algo.fit();
+    Result result;
+    result.fitStatus = algo.fitStatus();
+    result.mass = algo.mass();
+    result.massUncert = algo.massUncert();
+    result.numObjFunctionCalls = algo.numObjFunctionCalls();
+    return result;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::string inputFileName_visMassAndPtResolution = edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitVisMassAndPtResolutionPDF.root").fullPath();
+  std::string inputFileName_genTauHadMass = edm::FileInPath("TauAnalysis/SVfitStandalone/data/svFitGenTauHadMassPDF.root").fullPath();
+  TH1::AddDirectory(false);
+
+  const double maxRelDelta = 0.1;
+  unsigned numFailures = 0;
+  for ( int iOption = 0; iOption < kNumOptions; ++iOption ) {
+    Option option = (Option)iOption;
+    std::cout << optionNames[option] << ":" << std::endl;
+    for ( size_t idx = 0; idx < numReferenceEvents; ++idx ) {
+      Result resultMinuit = fitEvent(referenceEvents[idx], option, true, inputFileName_visMassAndPtResolution, inputFileName_genTauHadMass);
+      Result resultBFGS = fitEvent(referenceEvents[idx], option, false, inputFileName_visMassAndPtResolution, inputFileName_genTauHadMass);
+      double maxDelta = maxRelDelta*resultMinuit.massUncert;
+      bool isPassed = ( resultBFGS.fitStatus == resultMinuit.fitStatus &&
+			std::fabs(resultBFGS.mass - resultMinuit.mass) <= maxDelta &&
+			std::fabs(resultBFGS.massUncert - resultMinuit.massUncert) <= maxDelta );
+      std::cout << " " << referenceEvents[idx].name << ":"
+		<< " Minuit2: fitStatus = " << resultMinuit.fitStatus << ", mass = " << resultMinuit.mass << " +/- " << resultMinuit.massUncert << ","
+		<< " built-in: fitStatus = " << resultBFGS.fitStatus << ", mass = " << resultBFGS.mass << " +/- " << resultBFGS.massUncert
+		<< " (#calls = " << resultMinuit.numObjFunctionCalls << ", " << resultBFGS.numObjFunctionCalls << ")"
+		<< ( isPassed ? "" : " --> FAILED" ) << std::endl;
+      if ( !isPassed ) ++numFailures;
+    }
+  }
+  std::cout << numFailures << " of " << kNumOptions*numReferenceEvents << " fits differ between Minuit2 and the built-in minimizer" << std::endl;
+  return ( numFailures == 0 ) ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+/**
+   \class testSVfitStandaloneOutputSink testSVfitStandaloneOutputSink.cc "TauAnalysis/SVfitStandalone/test/testSVfitStandaloneOutputSink.cc"
+   \brief Write the output of the reference events through SVfitStandaloneOutputSink and read it back with SVfitStandaloneOutputReader
+
+   The likelihood curves (VEGAS integration) and histograms (Markov Chain integration) of all reference events are written
+   to a file and read back. The test fails in case any graph or histogram read back differs from the one written by the algorithm.
+   The check is repeated after truncating the last index entry, as left behind by a job that is killed while writing:
+   the reader is expected to ignore the truncated entry and to return all other events unchanged.
+*/
+
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneAlgorithm.h"
+#include "TauAnalysis/SVfitStandalone/interface/SVfitStandaloneOutputSink.h"
+#include "TauAnalysis/SVfitStandalone/test/SVfitStandaloneReferenceEvents.h"
+
+#include "TH1.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace svFitStandaloneReference;
+
+namespace
+{
+  bool isEqual(const svFitStandalone::OutputEvent& event1, const svFitStandalone::OutputEvent& event2)
+  {
+    if ( event1.run != event2.run || event1.lumi != event2.lumi || event1.event != event2.event ) return false;
+    if ( event1.graphs.size() != event2.graphs.size() || event1.histograms.size() != event2.histograms.size() ) return false;
+    for ( size_t iGraph = 0; iGraph < event1.graphs.size(); ++iGraph ) {
+      const svFitStandalone::OutputGraph& graph1 = event1.graphs[iGraph];
+      const svFitStandalone::OutputGraph& graph2 = event2.graphs[iGraph];
+      if ( graph1.name != graph2.name || graph1.x != graph2.x || graph1.y != graph2.y || graph1.xErr != graph2.xErr || graph1.yErr != graph2.yErr ) return false;
+    }
+    for ( size_t iHistogram = 0; iHistogram < event1.histograms.size(); ++iHistogram ) {
+      const svFitStandalone::OutputHistogram& histogram1 = event1.histograms[iHistogram];
+      const svFitStandalone::OutputHistogram& histogram2 = event2.histograms[iHistogram];
+      if ( histogram1.name != histogram2.name || histogram1.binEdges != histogram2.binEdges ||
+	   histogram1.binContents != histogram2.binContents || histogram1.binErrors != histogram2.binErrors ) return false;
+    }
+    return true;
+  }
+
+  /// number of events in expectedEvents that are not found in the file or differ from the events read back
+  unsigned compareOutputFile(const std::string& fileName, const std::vector<svFitStandalone::OutputEvent>& expectedEvents)
+  {
+    SVfitStandaloneOutputReader reader(fileName);
+    unsigned numMismatches = 0;
+    svFitStandalone::OutputEvent event;
+    for ( std::vector<svFitStandalone::OutputEvent>::const_iterator expectedEvent = expectedEvents.begin();
+	  expectedEvent != expectedEvents.end(); ++expectedEvent ) {
+      long idx = reader.find(expectedEvent->run, expectedEvent->lumi, expectedEvent->event);
+      if ( idx < 0 ) {
+	std::cout << " event = " << expectedEvent->event << " not found in file = " << fileName << std::endl;
+	++numMismatches;
+	continue;
+      }
+      reader.read(idx, event);
+      if ( !isEqual(event, *expectedEvent) ) {
+	std::cout << " event = " << expectedEvent->event << " read from file = " << fileName << " differs from event written" << std::endl;
+	++numMismatches;
+      }
+    }
+    return numMismatches;
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  std::string fileName = ( argc > 1 ) ? argv[1] : "testSVfitStandaloneOutputSink.dat";
+  TH1::AddDirectory(false);
+
+  std::vector<svFitStandalone::OutputEvent> expectedEvents;
+  {
+    SVfitStandaloneOutputSink outputSink(fileName);
+    for ( int iMode = 0; iMode < 2; ++iMode ) {
+      for ( size_t idx = 0; idx < numReferenceEvents; ++idx ) {
+	const ReferenceEvent& event = referenceEvents[idx];
+	SVfitStandaloneAlgorithm algo(measuredTauLeptons(event), event.measuredMETx, event.measuredMETy, covMET(event), 0);
+	algo.addLogM(true, 1.);
+	algo.outputSink(&outputSink);
+	algo.eventId(kSampleVersion, 1, expectedEvents.size() + 1);
+	if ( iMode == 0 ) algo.integrateVEGAS();
+	else algo.integrateMarkovChain();
+	expectedEvents.push_back(algo.outputEvent());
+      }
+    }
+    outputSink.flush();
+    if ( outputSink.failed() ) {
+      std::cout << "Failed to write file = " << fileName << std::endl;
+      return 1;
+    }
+  }
+  unsigned numMismatches = compareOutputFile(fileName, expectedEvents);
+  std::cout << expectedEvents.size() << " events written, " << numMismatches << " mismatches" << std::endl;
+
+  // simulate a job that was killed while writing the last index entry
+  std::string indexFileName = fileName + ".idx";
+  struct stat fileStatus;
+  if ( stat(indexFileName.data(), &fileStatus) != 0 || truncate(indexFileName.data(), fileStatus.st_size - 1) != 0 ) {
+    std::cout << "Failed to truncate file = " << indexFileName << std::endl;
+    return 1;
+  }
+  size_t numEventsTruncated = SVfitStandaloneOutputReader(fileName).numEvents();
+  std::vector<svFitStandalone::OutputEvent> expectedEventsTruncated(expectedEvents.begin(), expectedEvents.end() - 1);
+  unsigned numMismatchesTruncated = compareOutputFile(fileName, expectedEventsTruncated);
+  std::cout << "after truncating the index file: " << numEventsTruncated << " events, " << numMismatchesTruncated << " mismatches" << std::endl;
+
+  remove(fileName.data());
+  remove(indexFileName.data());
+  bool isPassed = ( numMismatches == 0 && numEventsTruncated == expectedEventsTruncated.size() && numMismatchesTruncated == 0 );
+  return ( isPassed ) ? 0 : 1;
+}